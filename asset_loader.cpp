@@ -0,0 +1,360 @@
+// asset_loader.cpp
+
+#include "asset_loader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+#include "stb_image.h"
+
+using namespace std;
+
+// -------------------- payloads --------------------
+void hashUploadBlocks(const void* data, size_t size, vector<uint64_t>& out) {
+    out.clear();
+    for (size_t offset = 0; offset < size; offset += kUploadBlockBytes)
+        out.push_back(hashBytes((const char*)data + offset, min(kUploadBlockBytes, size - offset)));
+}
+
+// Package vertices are CompactVertex already: the compact format takes them as they are, the split
+// one only moves attributes around, float formats dequantize.
+static bool unpackMeshPackage(VertexFormatId format, MeshPayload& out) {
+    MeshPackage& pkg = out.package;
+    out.view = pkg.view;
+    PositionDequant dq = positionDequant(out.view.bounds);
+    if (format == VertexFormatCompact) out.packed.swap(pkg.vertices);
+    else if (isQuantizedFormat(format)) repackVertices(VertexFormatCompact, format, pkg.vertices.data(), out.view.vertexCount, out.packed);
+    else {
+        dequantizeVertices((const CompactVertex*)pkg.vertices.data(), out.view.vertexCount, dq, out.data.vertices);
+        out.view.vertices = out.data.vertices.data();
+        if (format != VertexFormatFloat) packVertices(format, out.view.vertices, out.view.vertexCount, out.dequant, out.packed);
+    }
+    if (isQuantizedFormat(format)) out.dequant = dq;
+    out.vertices = format == VertexFormatFloat ? (const void*)out.view.vertices : (const void*)out.packed.data();
+    hashUploadBlocks(out.vertexBytes(), out.vertexByteSize(), out.vertexBlocks);
+    hashUploadBlocks(out.view.indices, out.indexByteSize(), out.indexBlocks);
+    out.ok = true;
+    return true;
+}
+
+bool loadMeshPayload(const string& path, const MeshImportOptions& opt, VertexFormatId format, MeshPayload& out) {
+    out.path = path;
+    out.format = format;
+    string cachePath = meshCachePath(path);
+    uint64_t hash = hashMeshSources(path, opt, format);
+    if (!hash && readMeshPackage(meshPackagePath(path), out.package)) return unpackMeshPackage(format, out);
+    // the cache holds the vertices already packed into format, so a hit uploads straight from the mapping
+    if (hash && openMeshCache(cachePath, hash, out.cached)) {
+        out.view = out.cached.view;
+        out.vertices = out.cached.vertices;
+    }
+    else {
+        if (!importObj(path, out.data, opt)) return false;
+        if (hash && writeMeshCache(cachePath, out.data, format, hash) && openMeshCache(cachePath, hash, out.cached)) {
+            out.view = out.cached.view;
+            out.vertices = out.cached.vertices;
+            out.data = MeshData();   // the mapped cache holds everything now
+        }
+        else out.view = makeMeshView(out.data, out.scratch);
+    }
+    if (isQuantizedFormat(format)) out.dequant = positionDequant(out.view.bounds);
+    if (!out.vertices) {   // no cache to write: pack in memory
+        if (format != VertexFormatFloat) packVertices(format, out.view.vertices, out.view.vertexCount, out.dequant, out.packed);
+        out.vertices = format == VertexFormatFloat ? (const void*)out.view.vertices : (const void*)out.packed.data();
+    }
+    hashUploadBlocks(out.vertexBytes(), out.vertexByteSize(), out.vertexBlocks);
+    hashUploadBlocks(out.view.indices, out.indexByteSize(), out.indexBlocks);
+    out.ok = true;
+    return true;
+}
+
+// Opens the tile file of a virtual texture, cutting the image into it first when it is missing or stale.
+static bool loadVirtualPayload(const string& path, bool flip, TextureCodec codec, const MipOptions& mips, ImagePayload& out,
+                               const ContentClaim& claim) {
+    string tilesPath = virtualTilesPath(path, codec);
+    uint64_t hash = hashVirtualSource(path, codec, mips, flip);
+    out.contentHash = hash;
+    if (hash && claim && !claim(hash)) {
+        out.duplicate = true;
+        return true;
+    }
+    shared_ptr<VirtualTextureFile> file = make_shared<VirtualTextureFile>();
+    if (!hash || !openVirtualTiles(tilesPath, hash, *file)) {
+        stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
+        int channels = 0;
+        unsigned char* data = stbi_load(path.c_str(), &out.width, &out.height, &channels, 4);
+        if (!data) {
+            cerr << "Failed to load texture: " << path << "\n";
+            return false;
+        }
+        bool written = writeVirtualTiles(tilesPath, data, out.width, out.height, codec, mips, hash, 2);
+        stbi_image_free(data);
+        if (!written || !openVirtualTiles(tilesPath, hash, *file)) return false;
+        cout << "Cut " << path << " into " << textureCodecName(codec) << " virtual texture tiles: " << file->file.size() / 1024 << " KB, "
+             << file->levelCount << " levels\n";
+    }
+    out.width = file->width;
+    out.height = file->height;
+    out.channels = 4;
+    out.tiles = file;
+    return true;
+}
+
+bool loadImagePayload(const string& path, bool flip, TextureCodec codec, const MipOptions& mips, ImagePayload& out, int virtualMinSize,
+                      const ContentClaim& claim) {
+    out.path = path;
+    int width, height, channels;
+    bool tileCodec = (codec == TextureBC1 || codec == TextureBC7 || codec == TextureRGBA8);
+    if (virtualMinSize > 0 && tileCodec && stbi_info(path.c_str(), &width, &height, &channels) &&
+        max(width, height) >= virtualMinSize) return loadVirtualPayload(path, flip, codec, mips, out, claim);
+    string cachePath = codec != TextureRaw ? textureCachePath(path, codec) : string();
+    uint64_t hash = hashTextureSource(path, codec, mips, flip);
+    out.contentHash = hash;
+    if (hash && claim && !claim(hash)) {
+        out.duplicate = true;
+        return true;
+    }
+    if (hash && codec != TextureRaw && openTextureCache(cachePath, hash, out.compressed)) {
+        out.width = out.compressed.levels[0].width;
+        out.height = out.compressed.levels[0].height;
+        return true;
+    }
+    stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
+    unsigned char* data = stbi_load(path.c_str(), &out.width, &out.height, &out.channels, 0);
+    if (!data) {
+        cerr << "Failed to load texture: " << path << "\n";
+        return false;
+    }
+    if (codec == TextureRaw) out.pixels.assign(data, data + (size_t)out.width * out.height * out.channels);
+    else {
+        // this is a worker thread already; the encoder takes one more core at most
+        compressTexture(data, out.width, out.height, out.channels, codec, mips, out.compressed, 2);
+        if (hash) writeTextureCache(cachePath, out.compressed, hash);
+        size_t raw = (size_t)out.width * out.height * 4 * 4 / 3;
+        cout << "Compressed " << path << " to " << textureCodecName(codec) << ": " << out.compressed.data.size() / 1024 << " KB with "
+             << mipFilterName(mips.filter) << " mips (RGBA8 " << raw / 1024 << " KB)\n";
+    }
+    stbi_image_free(data);
+    return true;
+}
+
+// -------------------- ORM packing --------------------
+string ormKey(const OrmSources& src) {
+    string key = "orm";
+    for (int c = 0; c < kOrmChannelCount; c++) key += "|" + src.paths[c] + "|" + src.fallbacks[c];
+    return key;
+}
+
+// One channel of an 8-bit image, bilinearly resampled to width x height, into every third byte of out.
+static void resampleChannel(const unsigned char* pixels, int w, int h, int channels, int width, int height, unsigned char* out) {
+    for (int y = 0; y < height; y++) {
+        float fy = max((y + 0.5f) * h / height - 0.5f, 0.0f);
+        int y0 = min((int)fy, h - 1), y1 = min(y0 + 1, h - 1);
+        float ty = fy - y0;
+        for (int x = 0; x < width; x++) {
+            float fx = max((x + 0.5f) * w / width - 0.5f, 0.0f);
+            int x0 = min((int)fx, w - 1), x1 = min(x0 + 1, w - 1);
+            float tx = fx - x0;
+            float top = pixels[((size_t)y0 * w + x0) * channels] * (1.0f - tx) + pixels[((size_t)y0 * w + x1) * channels] * tx;
+            float bottom = pixels[((size_t)y1 * w + x0) * channels] * (1.0f - tx) + pixels[((size_t)y1 * w + x1) * channels] * tx;
+            out[((size_t)y * width + x) * 3] = (unsigned char)(top + (bottom - top) * ty + 0.5f);
+        }
+    }
+}
+
+bool loadOrmPayload(const OrmSources& src, bool flip, TextureCodec codec, const MipOptions& mips, ImagePayload& out, const ContentClaim& claim) {
+    out.path = ormKey(src);
+    // the map each channel will use: its own, else the fallback, else none
+    string used[kOrmChannelCount];
+    uint64_t hash = hashBytes("ORM", 3, kTextureCacheVersion);
+    string dir;
+    for (int c = 0; c < kOrmChannelCount; c++) {
+        uint64_t h = 0;
+        for (const string* p : { &src.paths[c], &src.fallbacks[c] })
+            if (used[c].empty() && !p->empty() && (h = hashTextureSource(*p, codec, mips, flip)) != 0) used[c] = *p;
+        hash = hashBytes(&h, sizeof(h), hash);
+        if (dir.empty() && !used[c].empty()) dir = used[c].substr(0, used[c].find_last_of("/\\") + 1);
+    }
+    if (used[OrmOcclusion].empty() && used[OrmRoughness].empty() && used[OrmMetallic].empty()) {
+        cerr << "Failed to load texture: " << out.path << "\n";
+        return false;
+    }
+    out.contentHash = hash;
+    if (claim && !claim(hash)) {
+        out.duplicate = true;
+        return true;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "orm_%016llx", (unsigned long long)hashBytes(out.path.data(), out.path.size()));
+    string cachePath = codec != TextureRaw ? textureCachePath(dir + name, codec) : string();
+    if (codec != TextureRaw && openTextureCache(cachePath, hash, out.compressed)) {
+        out.width = out.compressed.levels[0].width;
+        out.height = out.compressed.levels[0].height;
+        return true;
+    }
+
+    struct Source { unsigned char* pixels = nullptr; int width = 0, height = 0, channels = 0; } maps[kOrmChannelCount];
+    stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
+    out.width = out.height = 1;
+    for (int c = 0; c < kOrmChannelCount; c++) {
+        Source& m = maps[c];
+        for (const string* p : { &src.paths[c], &src.fallbacks[c] }) {
+            if (m.pixels || p->empty()) continue;
+            m.pixels = stbi_load(p->c_str(), &m.width, &m.height, &m.channels, 0);
+            if (!m.pixels) cerr << "Failed to load texture: " << *p << "\n";
+        }
+        if (!m.pixels) continue;
+        out.width = max(out.width, m.width);
+        out.height = max(out.height, m.height);
+    }
+    out.channels = 3;
+    vector<unsigned char> packed((size_t)out.width * out.height * 3, 255);
+    for (int c = 0; c < kOrmChannelCount; c++) {
+        if (!maps[c].pixels) continue;
+        resampleChannel(maps[c].pixels, maps[c].width, maps[c].height, maps[c].channels, out.width, out.height, &packed[c]);
+        stbi_image_free(maps[c].pixels);
+    }
+    if (codec == TextureRaw) out.pixels.swap(packed);
+    else {
+        compressTexture(packed.data(), out.width, out.height, 3, codec, mips, out.compressed, 2);
+        writeTextureCache(cachePath, out.compressed, hash);
+        cout << "Packed " << out.path << " to " << textureCodecName(codec) << ": " << out.compressed.data.size() / 1024 << " KB with "
+             << mipFilterName(mips.filter) << " mips\n";
+    }
+    return true;
+}
+
+// -------------------- worker pool --------------------
+AssetLoader::AssetLoader(unsigned threads) {
+    if (threads == 0) threads = max(2u, thread::hardware_concurrency()) - 1;   // leave a core to the render thread
+    for (unsigned i = 0; i < threads; i++) workers.emplace_back([this] { run(); });
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+        jobs.clear();
+    }
+    wake.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+void AssetLoader::submit(function<void()> job) {
+    {
+        lock_guard<mutex> guard(lock);
+        jobs.push_back(std::move(job));
+        outstanding++;
+    }
+    wake.notify_one();
+}
+
+void AssetLoader::run() {
+    while (true) {
+        function<void()> job;
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [this] { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+uint32_t AssetLoader::loadMesh(const string& path, const MeshImportOptions& opt, VertexFormatId format) {
+    uint32_t ticket;
+    { lock_guard<mutex> guard(lock); ticket = nextTicket++; }
+    submit([this, ticket, path, opt, format] {
+        unique_ptr<MeshPayload> p(new MeshPayload());
+        p->ticket = ticket;
+        loadMeshPayload(path, opt, format, *p);
+        lock_guard<mutex> guard(lock);
+        doneMeshes.push_back(std::move(p));
+    });
+    return ticket;
+}
+
+uint32_t AssetLoader::loadImage(const string& path, bool flip, TextureCodec codec, const MipOptions& mips, int virtualMinSize) {
+    uint32_t ticket;
+    { lock_guard<mutex> guard(lock); ticket = nextTicket++; }
+    submit([this, ticket, path, flip, codec, mips, virtualMinSize] {
+        unique_ptr<ImagePayload> p(new ImagePayload());
+        p->ticket = ticket;
+        loadImagePayload(path, flip, codec, mips, *p, virtualMinSize, [this](uint64_t hash) { return claimContent(hash); });
+        lock_guard<mutex> guard(lock);
+        doneImages.push_back(std::move(p));
+    });
+    return ticket;
+}
+
+uint32_t AssetLoader::loadOrm(const OrmSources& src, bool flip, TextureCodec codec, const MipOptions& mips) {
+    uint32_t ticket;
+    { lock_guard<mutex> guard(lock); ticket = nextTicket++; }
+    submit([this, ticket, src, flip, codec, mips] {
+        unique_ptr<ImagePayload> p(new ImagePayload());
+        p->ticket = ticket;
+        loadOrmPayload(src, flip, codec, mips, *p, [this](uint64_t hash) { return claimContent(hash); });
+        lock_guard<mutex> guard(lock);
+        doneImages.push_back(std::move(p));
+    });
+    return ticket;
+}
+
+uint32_t AssetLoader::loadTile(shared_ptr<const VirtualTextureFile> file, uint32_t tile) {
+    uint32_t ticket;
+    { lock_guard<mutex> guard(lock); ticket = nextTicket++; }
+    submit([this, ticket, file, tile] {
+        unique_ptr<TilePayload> p(new TilePayload());
+        p->ticket = ticket;
+        p->tile = tile;
+        const unsigned char* data = file->tile(tile);
+        if (data) p->data.assign(data, data + file->tileBytes);
+        lock_guard<mutex> guard(lock);
+        doneTiles.push_back(std::move(p));
+    });
+    return ticket;
+}
+
+void AssetLoader::takeMeshes(vector<unique_ptr<MeshPayload>>& out) {
+    lock_guard<mutex> guard(lock);
+    for (auto& p : doneMeshes) out.push_back(std::move(p));
+    outstanding -= doneMeshes.size();
+    doneMeshes.clear();
+}
+
+void AssetLoader::takeImages(vector<unique_ptr<ImagePayload>>& out) {
+    lock_guard<mutex> guard(lock);
+    for (auto& p : doneImages) out.push_back(std::move(p));
+    outstanding -= doneImages.size();
+    doneImages.clear();
+}
+
+void AssetLoader::takeTiles(vector<unique_ptr<TilePayload>>& out) {
+    lock_guard<mutex> guard(lock);
+    for (auto& p : doneTiles) out.push_back(std::move(p));
+    outstanding -= doneTiles.size();
+    doneTiles.clear();
+}
+
+bool AssetLoader::claimContent(uint64_t contentHash) {
+    lock_guard<mutex> guard(lock);
+    return claimedContent.insert(contentHash).second;
+}
+
+void AssetLoader::releaseContent(uint64_t contentHash) {
+    lock_guard<mutex> guard(lock);
+    claimedContent.erase(contentHash);
+}
+
+bool AssetLoader::contentClaimed(uint64_t contentHash) const {
+    lock_guard<mutex> guard(lock);
+    return claimedContent.count(contentHash) != 0;
+}
+
+size_t AssetLoader::pending() const {
+    lock_guard<mutex> guard(lock);
+    return outstanding;
+}
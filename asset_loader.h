@@ -0,0 +1,158 @@
+// asset_loader.h
+// Background loading of meshes and images. The CPU work (OBJ import or cache mapping, vertex
+// packing, image decoding) runs on worker threads; the render thread collects finished payloads
+// once per frame and uploads them to GL itself, so nothing here touches GL.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mesh_cache.h"
+#include "mesh_codec.h"
+#include "mesh_import.h"
+#include "mesh_quantize.h"
+#include "texture_cache.h"
+#include "texture_compress.h"
+#include "vertex_format.h"
+#include "virtual_texture.h"
+
+// Granularity of the change detection used to update GPU buffers in place on reload.
+const size_t kUploadBlockBytes = 64u << 10;
+
+// Content hash per kUploadBlockBytes block of data (the last block may be shorter).
+void hashUploadBlocks(const void* data, size_t size, std::vector<uint64_t>& out);
+
+// A mesh ready for upload: view points into the mapped cache, into data or into package, vertex
+// bytes are in the upload format (vertex_format.h); the float format uploads the view's vertices as
+// they are.
+struct MeshPayload {
+    uint32_t ticket = 0;
+    std::string path;
+    bool ok = false;
+    VertexFormatId format = VertexFormatFloat;
+    CachedMesh cached;
+    MeshData data;
+    MeshPackage package;   // when only the OBJ's mesh package was there
+    std::vector<uint16_t> scratch;
+    MeshView view;   // view.vertices is only set for float vertices
+    std::vector<unsigned char> packed;   // formats converted here rather than read from the cache
+    const void* vertices = nullptr;   // upload bytes in format: the mapped cache, packed or view.vertices
+    PositionDequant dequant;   // identity for float vertices
+    std::vector<uint64_t> vertexBlocks, indexBlocks;   // hashUploadBlocks of the upload bytes
+
+    const void* vertexBytes() const { return vertices; }
+    size_t vertexByteSize() const { return view.vertexCount * vertexFormatBytes(format); }
+    size_t indexByteSize() const { return view.indexCount * view.indexSize; }
+};
+
+// 8-bit image, 1 to 4 channels, or its block-compressed mip chain when a codec was asked for (then
+// pixels stays empty), or the tiles of a virtual texture for images past the virtual size; all are
+// empty when decoding failed or when the image is a duplicate.
+struct ImagePayload {
+    uint32_t ticket = 0;
+    std::string path;
+    int width = 0, height = 0, channels = 0;
+    std::vector<unsigned char> pixels;
+    CompressedTexture compressed;
+    std::shared_ptr<const VirtualTextureFile> tiles;
+    uint64_t contentHash = 0;   // source bytes and import settings; 0 when unreadable
+    bool duplicate = false;     // another load claimed contentHash first, nothing was decoded
+
+    bool empty() const { return pixels.empty() && compressed.levels.empty() && !tiles; }
+};
+
+// One tile of a virtual texture, copied out of its tile file (the copy is what pages it in).
+struct TilePayload {
+    uint32_t ticket = 0;
+    uint32_t tile = 0;   // virtualTile
+    std::vector<unsigned char> data;   // empty when the tile is not in the file
+};
+
+// Called with the content hash before decoding; false means the content is already being loaded
+// elsewhere and the payload comes back as a duplicate.
+typedef std::function<bool(uint64_t contentHash)> ContentClaim;
+
+// Loads through the binary mesh cache next to the OBJ; a missing or stale cache is rebuilt. Without
+// the OBJ, its mesh package (mesh_codec.h) is decoded instead.
+bool loadMeshPayload(const std::string& path, const MeshImportOptions& opt, VertexFormatId format, MeshPayload& out);
+
+// With a codec, loads through the texture cache next to the image (texture_cache.h); a missing or
+// stale cache is decoded, mipped, compressed and rewritten. TextureRaw leaves the mips to GL.
+// Images with a side of at least virtualMinSize (0 = never) are opened as virtual textures instead,
+// through their tile file (virtual_texture.h), built the same way when missing or stale.
+bool loadImagePayload(const std::string& path, bool flip, TextureCodec codec, const MipOptions& mips, ImagePayload& out,
+                      int virtualMinSize = 0, const ContentClaim& claim = nullptr);
+
+// Occlusion, roughness and metallic maps packed into the R, G and B channels of one texture, which
+// the shader reads with a single fetch.
+enum OrmChannel { OrmOcclusion, OrmRoughness, OrmMetallic, kOrmChannelCount };
+struct OrmSources {
+    std::string paths[kOrmChannelCount];       // empty: the channel is 1
+    std::string fallbacks[kOrmChannelCount];   // loaded instead when the map in paths fails
+};
+
+// Identifies the packed texture for sharing between materials.
+std::string ormKey(const OrmSources& src);
+
+// The maps are resampled (bilinear) to the largest of their sizes. Channels whose map and fallback
+// both fail are 1, so the payload only comes back empty when there is nothing to pack at all.
+// With a codec it loads through the texture cache like loadImagePayload, keyed on all sources.
+bool loadOrmPayload(const OrmSources& src, bool flip, TextureCodec codec, const MipOptions& mips, ImagePayload& out,
+                    const ContentClaim& claim = nullptr);
+
+// Fixed pool of worker threads running load requests in FIFO order.
+struct AssetLoader {
+    explicit AssetLoader(unsigned threads = 0);   // 0 = hardware_concurrency - 1, at least 1
+    ~AssetLoader();                               // waits for running requests, drops queued ones
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // Both return a ticket that comes back in the payload.
+    uint32_t loadMesh(const std::string& path, const MeshImportOptions& opt, VertexFormatId format);
+    uint32_t loadImage(const std::string& path, bool flip = true, TextureCodec codec = TextureRaw, const MipOptions& mips = MipOptions(),
+                       int virtualMinSize = 0);
+    uint32_t loadOrm(const OrmSources& src, bool flip = true, TextureCodec codec = TextureRaw, const MipOptions& mips = MipOptions());
+    // file stays alive until the tile is copied
+    uint32_t loadTile(std::shared_ptr<const VirtualTextureFile> file, uint32_t tile);
+
+    // Moves out the payloads finished since the last call, in completion order.
+    void takeMeshes(std::vector<std::unique_ptr<MeshPayload>>& out);
+    void takeImages(std::vector<std::unique_ptr<ImagePayload>>& out);
+    void takeTiles(std::vector<std::unique_ptr<TilePayload>>& out);
+
+    // Image loads claim their content hash; a second load of the same content (by another path) comes
+    // back as a duplicate without decoding. The owner releases the claim when the texture goes away.
+    bool claimContent(uint64_t contentHash);
+    void releaseContent(uint64_t contentHash);
+    // False once the load that claimed it failed or went away: a duplicate has nothing to wait for.
+    bool contentClaimed(uint64_t contentHash) const;
+
+    // Requests submitted but not taken yet.
+    size_t pending() const;
+
+private:
+    void submit(std::function<void()> job);
+    void run();
+
+    mutable std::mutex lock;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> jobs;
+    std::vector<std::unique_ptr<MeshPayload>> doneMeshes;
+    std::vector<std::unique_ptr<ImagePayload>> doneImages;
+    std::vector<std::unique_ptr<TilePayload>> doneTiles;
+    std::set<uint64_t> claimedContent;
+    std::vector<std::thread> workers;
+    uint32_t nextTicket = 1;
+    size_t outstanding = 0;
+    bool stopping = false;
+};
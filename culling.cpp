@@ -0,0 +1,151 @@
+// culling.cpp
+
+#include "culling.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULL_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULL_SSE 1
+#endif
+
+using namespace std;
+
+// -------------------- frustum --------------------
+// Gribb/Hartmann: each plane is the 4th row of the clip matrix plus or minus one of the others.
+Frustum extractFrustum(const float* m) {
+    Frustum f;
+    for (int i = 0; i < 3; i++) {
+        for (int k = 0; k < 4; k++) {
+            float row = m[k * 4 + i], w = m[k * 4 + 3];
+            f.planes[2 * i][k] = w + row;
+            f.planes[2 * i + 1][k] = w - row;
+        }
+    }
+    return f;
+}
+
+bool sphereInFrustum(const Frustum& f, const float* c, float radius) {
+    for (int i = 0; i < 6; i++) {
+        const float* p = f.planes[i];
+        float len = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        if (p[0] * c[0] + p[1] * c[1] + p[2] * c[2] + p[3] < -radius * len) return false;
+    }
+    return true;
+}
+
+// -------------------- object batches --------------------
+void ObjectBoundsSoA::clear() {
+    for (vector<float>* v : { &boxX, &boxY, &boxZ, &extentX, &extentY, &extentZ, &sphereX, &sphereY, &sphereZ, &radius }) v->clear();
+}
+
+void ObjectBoundsSoA::add(const float* boxMin, const float* boxMax, const float* sphereCenter, float sphereRadius) {
+    boxX.push_back(0.5f * (boxMin[0] + boxMax[0]));
+    boxY.push_back(0.5f * (boxMin[1] + boxMax[1]));
+    boxZ.push_back(0.5f * (boxMin[2] + boxMax[2]));
+    extentX.push_back(0.5f * (boxMax[0] - boxMin[0]));
+    extentY.push_back(0.5f * (boxMax[1] - boxMin[1]));
+    extentZ.push_back(0.5f * (boxMax[2] - boxMin[2]));
+    sphereX.push_back(sphereCenter[0]);
+    sphereY.push_back(sphereCenter[1]);
+    sphereZ.push_back(sphereCenter[2]);
+    radius.push_back(sphereRadius);
+}
+
+// One object against normalized planes; also handles the tail the SIMD loop leaves over.
+static bool objectVisible(const float (*planes)[4], const ObjectBoundsSoA& o, size_t i) {
+    for (int k = 0; k < 6; k++) {
+        const float* p = planes[k];
+        float box = p[0] * o.boxX[i] + p[1] * o.boxY[i] + p[2] * o.boxZ[i] + p[3];
+        float reach = fabsf(p[0]) * o.extentX[i] + fabsf(p[1]) * o.extentY[i] + fabsf(p[2]) * o.extentZ[i];
+        float sphere = p[0] * o.sphereX[i] + p[1] * o.sphereY[i] + p[2] * o.sphereZ[i] + p[3];
+        if (box < -reach || sphere < -o.radius[i]) return false;
+    }
+    return true;
+}
+
+void cullObjects(const Frustum& frustum, const ObjectBoundsSoA& o, vector<uint32_t>& visible) {
+    visible.clear();
+    // normalized so that plane distances compare against radii
+    float planes[6][4];
+    for (int k = 0; k < 6; k++) {
+        const float* p = frustum.planes[k];
+        float len = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        float inv = len > 0.0f ? 1.0f / len : 0.0f;
+        for (int c = 0; c < 4; c++) planes[k][c] = p[c] * inv;
+    }
+    size_t count = o.size(), i = 0;
+#if CULL_AVX
+    for (; i + 8 <= count; i += 8) {
+        __m256 bx = _mm256_loadu_ps(&o.boxX[i]), by = _mm256_loadu_ps(&o.boxY[i]), bz = _mm256_loadu_ps(&o.boxZ[i]);
+        __m256 ex = _mm256_loadu_ps(&o.extentX[i]), ey = _mm256_loadu_ps(&o.extentY[i]), ez = _mm256_loadu_ps(&o.extentZ[i]);
+        __m256 sx = _mm256_loadu_ps(&o.sphereX[i]), sy = _mm256_loadu_ps(&o.sphereY[i]), sz = _mm256_loadu_ps(&o.sphereZ[i]);
+        __m256 nr = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&o.radius[i]));
+        __m256 outside = _mm256_setzero_ps();
+        for (int k = 0; k < 6; k++) {
+            const float* p = planes[k];
+            __m256 a = _mm256_set1_ps(p[0]), b = _mm256_set1_ps(p[1]), c = _mm256_set1_ps(p[2]), d = _mm256_set1_ps(p[3]);
+            __m256 box = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, bx), _mm256_mul_ps(b, by)), _mm256_add_ps(_mm256_mul_ps(c, bz), d));
+            __m256 reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(fabsf(p[0])), ex), _mm256_mul_ps(_mm256_set1_ps(fabsf(p[1])), ey)),
+                                         _mm256_mul_ps(_mm256_set1_ps(fabsf(p[2])), ez));
+            __m256 sphere = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, sx), _mm256_mul_ps(b, sy)), _mm256_add_ps(_mm256_mul_ps(c, sz), d));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(box, reach), _mm256_setzero_ps(), _CMP_LT_OQ));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(sphere, nr, _CMP_LT_OQ));
+        }
+        int mask = ~_mm256_movemask_ps(outside) & 0xFF;
+        for (int bit = 0; bit < 8; bit++)
+            if (mask & (1 << bit)) visible.push_back((uint32_t)(i + bit));
+    }
+#elif CULL_SSE
+    for (; i + 4 <= count; i += 4) {
+        __m128 bx = _mm_loadu_ps(&o.boxX[i]), by = _mm_loadu_ps(&o.boxY[i]), bz = _mm_loadu_ps(&o.boxZ[i]);
+        __m128 ex = _mm_loadu_ps(&o.extentX[i]), ey = _mm_loadu_ps(&o.extentY[i]), ez = _mm_loadu_ps(&o.extentZ[i]);
+        __m128 sx = _mm_loadu_ps(&o.sphereX[i]), sy = _mm_loadu_ps(&o.sphereY[i]), sz = _mm_loadu_ps(&o.sphereZ[i]);
+        __m128 nr = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&o.radius[i]));
+        __m128 outside = _mm_setzero_ps();
+        for (int k = 0; k < 6; k++) {
+            const float* p = planes[k];
+            __m128 a = _mm_set1_ps(p[0]), b = _mm_set1_ps(p[1]), c = _mm_set1_ps(p[2]), d = _mm_set1_ps(p[3]);
+            __m128 box = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, bx), _mm_mul_ps(b, by)), _mm_add_ps(_mm_mul_ps(c, bz), d));
+            __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(fabsf(p[0])), ex), _mm_mul_ps(_mm_set1_ps(fabsf(p[1])), ey)),
+                                      _mm_mul_ps(_mm_set1_ps(fabsf(p[2])), ez));
+            __m128 sphere = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, sx), _mm_mul_ps(b, sy)), _mm_add_ps(_mm_mul_ps(c, sz), d));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(box, reach), _mm_setzero_ps()));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(sphere, nr));
+        }
+        int mask = ~_mm_movemask_ps(outside) & 0xF;
+        for (int bit = 0; bit < 4; bit++)
+            if (mask & (1 << bit)) visible.push_back((uint32_t)(i + bit));
+    }
+#endif
+    for (; i < count; i++)
+        if (objectVisible(planes, o, i)) visible.push_back((uint32_t)i);
+}
+
+// -------------------- backface cone --------------------
+bool meshletBackfacing(const Meshlet& m, const float* eye) {
+    if (m.coneCutoff >= 1.0f) return false;
+    float d[3] = { m.center[0] - eye[0], m.center[1] - eye[1], m.center[2] - eye[2] };
+    float dist = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    return d[0] * m.coneAxis[0] + d[1] * m.coneAxis[1] + d[2] * m.coneAxis[2] >= m.coneCutoff * dist + m.radius;
+}
+
+// -------------------- meshlets --------------------
+void cullMeshlets(const Meshlet* meshlets, size_t count, const Frustum& frustum, const float* eye,
+                  vector<uint32_t>& firsts, vector<uint32_t>& counts, ClusterCullStats* stats) {
+    firsts.clear();
+    counts.clear();
+    ClusterCullStats local;
+    local.total = count;
+    for (size_t i = 0; i < count; i++) {
+        const Meshlet& m = meshlets[i];
+        if (!sphereInFrustum(frustum, m.center, m.radius)) { local.frustumCulled++; continue; }
+        if (meshletBackfacing(m, eye)) { local.backfaceCulled++; continue; }
+        if (!firsts.empty() && firsts.back() + counts.back() == m.indexOffset) counts.back() += m.indexCount;
+        else { firsts.push_back(m.indexOffset); counts.push_back(m.indexCount); }
+    }
+    if (stats) *stats = local;
+}
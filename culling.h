@@ -0,0 +1,48 @@
+// culling.h
+// CPU visibility tests: frustum planes from a clip matrix, sphere and backface-cone tests,
+// batched SIMD object culling, and meshlet culling that emits merged index ranges for glMultiDrawElements.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "meshlet.h"
+
+// Inside when a*x + b*y + c*z + d >= 0 for all six planes (not normalized).
+struct Frustum {
+    float planes[6][4];
+};
+
+// Planes of a column-major (OpenGL/glm) clip matrix; pass projection * view * model to get them in model space.
+Frustum extractFrustum(const float* clip);
+
+bool sphereInFrustum(const Frustum& f, const float* center, float radius);
+
+// True when every triangle of the meshlet faces away from a viewer at eye (same space as the meshlet).
+bool meshletBackfacing(const Meshlet& m, const float* eye);
+
+struct ClusterCullStats {
+    size_t total = 0, frustumCulled = 0, backfaceCulled = 0;
+};
+
+// Visible meshlets as index ranges (first index, index count); neighbouring ranges are merged.
+void cullMeshlets(const Meshlet* meshlets, size_t count, const Frustum& frustum, const float* eye,
+                  std::vector<uint32_t>& firsts, std::vector<uint32_t>& counts, ClusterCullStats* stats = nullptr);
+
+// World-space bounds of many objects, structure-of-arrays so cullObjects can test 4 or 8 at a time.
+// Each object has an AABB (center and half extent) and a bounding sphere; it is culled when either
+// lies fully outside one plane.
+struct ObjectBoundsSoA {
+    std::vector<float> boxX, boxY, boxZ, extentX, extentY, extentZ;
+    std::vector<float> sphereX, sphereY, sphereZ, radius;
+
+    size_t size() const { return boxX.size(); }
+    void clear();
+    void add(const float* boxMin, const float* boxMax, const float* sphereCenter, float sphereRadius);
+};
+
+// Indices of the objects that intersect the frustum (use projection * view for world-space bounds).
+// SSE by default, AVX when the compiler targets it.
+void cullObjects(const Frustum& frustum, const ObjectBoundsSoA& objects, std::vector<uint32_t>& visible);
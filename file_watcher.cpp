@@ -0,0 +1,62 @@
+// file_watcher.cpp
+
+#include "file_watcher.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+using namespace std;
+
+// Modification time at the file system's full resolution and size, false when the file does not
+// exist. Whole seconds would miss a second save within the same second as the first.
+static bool statFile(const string& path, int64_t& time, int64_t& size) {
+#ifdef _WIN32
+    // _stat64 only carries whole seconds; the attributes have the 100 ns FILETIME
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attr)) return false;
+    time = (int64_t)(((uint64_t)attr.ftLastWriteTime.dwHighDateTime << 32) | attr.ftLastWriteTime.dwLowDateTime);
+    size = (int64_t)(((uint64_t)attr.nFileSizeHigh << 32) | attr.nFileSizeLow);
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+#ifdef __APPLE__
+    time = (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    time = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    size = (int64_t)st.st_size;
+#endif
+    return true;
+}
+
+void FileWatcher::watch(const string& path) {
+    for (const Entry& e : entries)
+        if (e.path == path) return;
+    Entry e;
+    e.path = path;
+    statFile(path, e.time, e.size);
+    e.seenTime = e.time;
+    e.seenSize = e.size;
+    entries.push_back(e);
+}
+
+void FileWatcher::poll(vector<string>& changed) {
+    for (Entry& e : entries) {
+        int64_t time = 0, size = -1;
+        if (!statFile(e.path, time, size)) { e.seenSize = -1; continue; }   // mid-save (delete + rename)
+        bool settled = (time == e.seenTime && size == e.seenSize);
+        e.seenTime = time;
+        e.seenSize = size;
+        if (settled && (time != e.time || size != e.size)) {
+            e.time = time;
+            e.size = size;
+            changed.push_back(e.path);
+        }
+    }
+}
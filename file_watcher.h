@@ -0,0 +1,26 @@
+// file_watcher.h
+// Change notification for asset files by polling their modification time and size. Portable
+// (no inotify / ReadDirectoryChangesW) and cheap for the handful of files a scene watches.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct FileWatcher {
+    void watch(const std::string& path);   // no-op when already watched
+
+    // Appends the files that changed since the last report. A change is reported once the file
+    // has looked the same for two polls in a row, so a save in progress is not picked up half-written.
+    // Files that disappear are reported when they come back.
+    void poll(std::vector<std::string>& changed);
+
+private:
+    struct Entry {
+        std::string path;
+        int64_t time = 0, size = -1;          // last reported state
+        int64_t seenTime = 0, seenSize = -1;  // state at the previous poll
+    };
+    std::vector<Entry> entries;
+};
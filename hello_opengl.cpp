@@ -8,9 +8,15 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <cstdint>
 #include <fstream>
 #include <sstream>
 #include <cmath>
+#include <algorithm>
+#include <cstring>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -18,8 +24,14 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
+#include "mesh_import.h"
+#include "mesh_cache.h"
+#include "mesh_quantize.h"
+#include "culling.h"
+#include "asset_loader.h"
+#include "file_watcher.h"
+#include "texture_registry.h"
+#include "virtual_texture.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -65,27 +77,97 @@ static GLuint createProgram(const char* vsSrc, const char* fsSrc) {
     return p;
 }
 
-// -------------------- load texture (stb_image) --------------------
-static GLuint loadTexture(const string& path, bool srgb = false, bool flip = true) {
-    if (flip) stbi_set_flip_vertically_on_load(1);
-    int w, h, c;
-    unsigned char* data = stbi_load(path.c_str(), &w, &h, &c, 0);
-    if (!data) {
-        cerr << "Failed to load texture: " << path << "\n";
-        return 0;
-    }
-    GLenum internal = (c == 4) ? (srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8) : (srgb ? GL_SRGB8 : GL_RGB8);
-    GLenum format = (c == 4) ? GL_RGBA : GL_RGB;
+// -------------------- textures --------------------
+static GLuint createSolidTexture(unsigned char r, unsigned char g, unsigned char b) {
+    unsigned char texel[3] = { r, g, b };
     GLuint tex; glGenTextures(1, &tex);
     glBindTexture(GL_TEXTURE_2D, tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, internal, w, h, 0, format, GL_UNSIGNED_BYTE, data);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, texel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return tex;
+}
+
+// Decoded image (asset_loader.h) into tex, uploaded in bands of rows; rowsDone carries the progress
+// between calls and budget is reduced by the bytes sent. Returns true once the texture is complete.
+static bool uploadImageSlice(GLuint tex, const ImagePayload& img, int& rowsDone, size_t& budget, bool srgb = false) {
+    GLenum internals[4] = { GL_R8, GL_RG8, GLenum(srgb ? GL_SRGB8 : GL_RGB8), GLenum(srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8) };
+    GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    GLenum format = formats[img.channels - 1];
+    size_t rowBytes = (size_t)img.width * img.channels;
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (rowsDone == 0)
+        glTexImage2D(GL_TEXTURE_2D, 0, internals[img.channels - 1], img.width, img.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    int rows = (int)min((size_t)(img.height - rowsDone), max(budget / rowBytes, (size_t)1));
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, rowsDone, img.width, rows, format, GL_UNSIGNED_BYTE, &img.pixels[rowsDone * rowBytes]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    rowsDone += rows;
+    budget -= min(budget, rows * rowBytes);
+    if (rowsDone < img.height) return false;
     glGenerateMipmap(GL_TEXTURE_2D);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    stbi_image_free(data);
-    return tex;
+    return true;
+}
+
+// from EXT_texture_compression_s3tc, EXT_texture_sRGB and ARB_texture_compression_bptc, which
+// glad may not declare
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
+static bool hasGlExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+        if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0) return true;
+    return false;
+}
+
+static GLenum codecInternalFormat(TextureCodec codec, bool srgb) {
+    return codec == TextureBC1 ? GLenum(srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+         : codec == TextureBC4 ? GL_COMPRESSED_RED_RGTC1 : codec == TextureBC5 ? GL_COMPRESSED_RG_RGTC2
+         : codec == TextureBC7 ? GLenum(srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM)
+         : GLenum(srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8);
+}
+
+// Precomputed mip chain (block-compressed or RGBA8) into tex, smallest level first: each call sends
+// levels until budget runs out (at least one) and moves the base level down to the newest, so the
+// texture is complete and sharpens as it streams. levelsDone carries the progress between calls.
+static bool uploadCompressedLevels(GLuint tex, const ImagePayload& img, int& levelsDone, size_t& budget) {
+    const CompressedTexture& c = img.compressed;
+    GLenum internal = codecInternalFormat(c.codec, c.srgb);
+    int count = (int)c.levels.size();
+    glBindTexture(GL_TEXTURE_2D, tex);
+    do {
+        int level = count - 1 - levelsDone;
+        const CompressedLevel& l = c.levels[level];
+        if (c.codec == TextureRGBA8)
+            glTexImage2D(GL_TEXTURE_2D, level, internal, l.width, l.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &c.data[l.offset]);
+        else
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, internal, l.width, l.height, 0, (GLsizei)l.size, &c.data[l.offset]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, count - 1);
+        budget -= min(budget, l.size);
+        levelsDone++;
+    } while (budget && levelsDone < count);
+    if (levelsDone < count) return false;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return true;
 }
 
 // -------------------- simple camera --------------------
@@ -116,70 +198,1062 @@ struct Camera {
     glm::mat4 viewMatrix() { return glm::lookAt(pos, pos + front, up); }
 };
 
+// -------------------- materials --------------------
+// Scene-wide material table; meshes refer to it by index. Textures are shared by request and by
+// content through the registry; every material slot (and ORM texture) holds one reference.
+struct GpuMaterial {
+    GLuint textures[kMaterialTextureCount] = {};
+    GLuint orm = 0;   // packed AO / roughness / metallic (kPackOrmMaps); the three textures above are unused then
+    glm::vec3 baseColor = glm::vec3(1.0f);   // multiplied into the albedo map
+    float metallic = 1.0f, roughness = 1.0f;
+};
+struct MaterialTable {
+    vector<GpuMaterial> materials;
+    vector<uint32_t> freeMaterials;   // entries a reload left unused, taken before the table grows
+    TextureRegistry textures;
+    GLuint defaults[kMaterialTextureCount] = {};   // resources/*.png, used when a named map is missing
+    string defaultPaths[kMaterialTextureCount];     // their files, for packing ORM textures
+    GLuint white = 0;                          // 1x1 white, used when a map is not named at all
+    GLuint flatNormal = 0;                     // 1x1 (0, 0, 1) tangent-space normal
+};
+
 // -------------------- model loading (tinyobj) --------------------
 struct Mesh {
     GLuint vao = 0, vbo = 0, ebo = 0;
-    GLsizei count = 0;
+    GLuint depthVao = 0;       // position attribute only, for depth-only passes
+    GLenum indexType = GL_UNSIGNED_INT;
+    GLenum primitive = GL_TRIANGLES;   // GL_TRIANGLE_STRIP restarts at the all-ones index
+    vector<MeshLod> lods;      // index ranges in ebo, lods[0] = full detail
+    vector<MeshSubmesh> submeshes;   // per-material ranges, grouped per LOD
+    vector<Meshlet> meshlets;  // culling clusters, ranged per submesh
+    vector<uint32_t> materials;      // mesh material index -> MaterialTable index
+    glm::vec3 boxMin = glm::vec3(0.0f), boxMax = glm::vec3(0.0f);   // mesh space AABB
+    glm::vec3 center = glm::vec3(0.0f);   // bounding sphere, mesh space
+    float radius = 0.0f;
+    PositionDequant dequant;   // identity for float vertices
+    VertexFormatId format = VertexFormatFloat;   // layout of vbo, see vertex_format.h
+    size_t vertexCount = 0;    // locates the streams of a split format
+    bool ready = false;        // buffers complete; before that only the bounds may be set
+    size_t vertexCapacity = 0, indexCapacity = 0;      // allocated bytes in vbo / ebo
+    vector<uint64_t> vertexBlocks, indexBlocks;        // hashUploadBlocks of the current contents
 };
-static bool loadObjToMesh(const string& path, Mesh& mesh) {
-    tinyobj::attrib_t attrib;
-    vector<tinyobj::shape_t> shapes;
-    vector<tinyobj::material_t> materials;
-    string warn, err;
-    string base = path.substr(0, path.find_last_of("/\\") + 1);
-    bool ok = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), base.c_str());
-    if (!warn.empty()) cerr << "WARN: " << warn << "\n";
-    if (!err.empty()) cerr << "ERR: " << err << "\n";
-    if (!ok) return false;
-    vector<float> data;
-    vector<unsigned int> idx;
-    unsigned int index = 0;
-    for (auto& shape : shapes) {
-        for (auto& f : shape.mesh.indices) {
-            int vi = f.vertex_index;
-            int ni = f.normal_index;
-            int ti = f.texcoord_index;
-            // position
-            data.push_back(attrib.vertices[3 * vi + 0]);
-            data.push_back(attrib.vertices[3 * vi + 1]);
-            data.push_back(attrib.vertices[3 * vi + 2]);
-            // normal
-            if (ni >= 0) {
-                data.push_back(attrib.normals[3 * ni + 0]);
-                data.push_back(attrib.normals[3 * ni + 1]);
-                data.push_back(attrib.normals[3 * ni + 2]);
-            }
-            else {
-                data.push_back(0); data.push_back(1); data.push_back(0);
-            }
-            // uv
-            if (ti >= 0) {
-                data.push_back(attrib.texcoords[2 * ti + 0]);
-                data.push_back(attrib.texcoords[2 * ti + 1]);
+
+// -------------------- async assets --------------------
+// GL side of AssetLoader. Textures are handed out at once as 1x1 placeholders and filled in when
+// their image arrives. Meshes are uploaded into staging buffers and swapped into their Mesh only
+// when complete, so until then the previous contents (or a bounding-box proxy) keep drawing.
+// A reloaded mesh that still fits its buffers is instead patched in place, block by block.
+// Both share a per-frame upload budget.
+const size_t kUploadBytesPerFrame = 4u << 20;
+// Filter of the CPU-built mip chains (texture_mips.h).
+const MipFilter kMipFilter = MipKaiser;
+// Metallic, roughness and AO reach the shader as one packed texture (pbr.fs with PACKED_ORM), one
+// fetch instead of three; false keeps the three single-channel maps.
+const bool kPackOrmMaps = true;
+// Albedo maps with a side of at least this many texels stream as virtual textures: only the tiles a
+// feedback pass sees get loaded, into an atlas of kVirtualAtlasSlots squared tiles shared by all of
+// them. 0 loads every map whole.
+const int kVirtualAlbedoMinSize = 8192;
+const int kVirtualAtlasSlots = 32;        // 4352 texels per side
+const int kVirtualFeedbackScale = 8;      // feedback buffer is the screen size divided by this
+const size_t kVirtualTilesLoading = 64;   // tile loads under way at once
+
+struct TextureUpload {
+    unique_ptr<ImagePayload> image;
+    GLuint texture = 0;
+    int slot = 0;            // MaterialTexture
+    bool isDefault = false;  // scene default: keeps its placeholder when the file is missing
+    function<uint32_t()> load;   // submits the load (again); returns its ticket
+    int rowsDone = 0;        // decoded images
+    int levelsDone = 0;      // compressed ones
+};
+// Bytes [done, end) of src still to be copied to the same offsets of buffer.
+struct BufferRange {
+    GLuint buffer = 0;
+    const void* src = nullptr;
+    size_t done = 0, end = 0;
+};
+struct MeshUpload {
+    unique_ptr<MeshPayload> payload;
+    Mesh* target = nullptr;
+    vector<uint32_t> materials;   // MaterialTable ids of the payload's materials
+    bool started = false;
+    bool reload = false;          // target already had buffers
+    bool inPlace = false;         // writing into target's buffers instead of staging
+    size_t bytes = 0;             // total to upload
+    Mesh staging;                 // new buffers, swapped into target when done
+    vector<BufferRange> ranges;
+    size_t nextRange = 0;
+};
+// GL side of virtual_texture.h. A virtual albedo keeps the placeholder texture its materials hold, so
+// the registry shares and releases it like any other, and adds a page table texture.
+struct VirtualAlbedo {
+    shared_ptr<const VirtualTextureFile> file;
+    int id = 0;              // residency and feedback id, 1..255
+    GLuint pageTable = 0;    // RGBA8, one mip per level (VirtualPageTable)
+};
+struct VirtualTextures {
+    VirtualTextureResidency residency;
+    map<GLuint, VirtualAlbedo> textures;   // placeholder -> virtual texture
+    GLuint owners[256] = {};               // id -> placeholder
+    map<uint32_t, uint64_t> pendingTiles;  // ticket -> residency tile
+    GLuint atlas = 0;
+    TextureCodec codec = TextureRaw;       // of the atlas and every tile file
+    uint32_t frame = 0;
+    // feedback buffer, read back through PBOs kReadbacks - 1 frames later so the CPU does not stall
+    static const int kReadbacks = 3;
+    GLuint fbo = 0;
+    GLuint pbos[kReadbacks] = {};
+    bool issued[kReadbacks] = {};
+    int next = 0;
+    int width = 0, height = 0;
+    vector<uint64_t> seen, load;
+};
+struct WatchedMesh {
+    Mesh* mesh = nullptr;
+    VertexFormatId format = VertexFormatCompact;
+    MeshImportOptions opt;
+};
+struct AssetStreamer {
+    AssetLoader loader;
+    map<uint32_t, TextureUpload> pendingTextures;   // ticket -> texture waiting for its image
+    map<uint32_t, Mesh*> pendingMeshes;             // ticket -> mesh waiting for its payload
+    deque<TextureUpload> textureQueue;
+    map<uint64_t, vector<TextureUpload>> duplicates;   // content hash -> loads waiting for the first one of that content
+    deque<MeshUpload> meshQueue;
+    FileWatcher watcher;
+    map<string, WatchedMesh> meshFiles;             // OBJ path -> mesh reloaded when it changes
+    TextureCodec codecs[kMaterialTextureCount] = {};   // per MaterialTexture, see chooseTextureCodecs
+    TextureCodec ormCodec = TextureRaw;
+    VirtualTextures virtualTextures;
+};
+
+// Albedo as BC7 (BC1 without BPTC), normals as BC5 (x, y; the shader rebuilds z), the scalar maps as
+// BC4 and packed ORM as BC7 (BC1 would mix its three unrelated channels); RGBA8 where the driver
+// lacks the format. RGTC is core since GL 3.0.
+static void chooseTextureCodecs(AssetStreamer& streamer) {
+    bool bptc = hasGlExtension("GL_ARB_texture_compression_bptc");
+    bool s3tc = hasGlExtension("GL_EXT_texture_compression_s3tc") && hasGlExtension("GL_EXT_texture_sRGB");
+    streamer.codecs[MaterialAlbedo] = bptc ? TextureBC7 : s3tc ? TextureBC1 : TextureRGBA8;
+    streamer.codecs[MaterialNormal] = TextureBC5;
+    streamer.codecs[MaterialMetallic] = streamer.codecs[MaterialRoughness] = streamer.codecs[MaterialAO] = TextureBC4;
+    streamer.ormCodec = bptc ? TextureBC7 : TextureRGBA8;
+    cout << "Texture codecs: albedo " << textureCodecName(streamer.codecs[MaterialAlbedo]) << ", normal BC5, scalar maps BC4\n";
+}
+
+// Albedo is sRGB (filtered in linear light and sampled through an sRGB format), normals renormalize.
+static MipOptions textureMipOptions(int slot) {
+    MipOptions mips;
+    mips.filter = kMipFilter;
+    mips.srgb = (slot == MaterialAlbedo);
+    mips.normalMap = (slot == MaterialNormal);
+    return mips;
+}
+
+// -------------------- virtual textures --------------------
+// Feedback buffer (tile ids, and depth so hidden surfaces request nothing) and its readback buffers.
+static void initVirtualFeedback(VirtualTextures& vt, int width, int height) {
+    vt.width = max(width, 1);
+    vt.height = max(height, 1);
+    GLuint rbos[2];
+    glGenRenderbuffers(2, rbos);
+    glBindRenderbuffer(GL_RENDERBUFFER, rbos[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, vt.width, vt.height);
+    glBindRenderbuffer(GL_RENDERBUFFER, rbos[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, vt.width, vt.height);
+    glGenFramebuffers(1, &vt.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, vt.fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbos[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbos[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) cerr << "Feedback framebuffer not complete!\n";
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glGenBuffers(VirtualTextures::kReadbacks, vt.pbos);
+    for (GLuint pbo : vt.pbos) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)vt.width * vt.height * 4, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+// Every tile file uses the albedo codec; the atlas is allocated with the first virtual texture.
+static void createVirtualAtlas(VirtualTextures& vt, TextureCodec codec) {
+    int size = kVirtualAtlasSlots * kVirtualTileStride;
+    GLenum internal = codecInternalFormat(codec, true);
+    vt.residency.init(kVirtualAtlasSlots);
+    vt.codec = codec;
+    glGenTextures(1, &vt.atlas);
+    glBindTexture(GL_TEXTURE_2D, vt.atlas);
+    if (codec == TextureRGBA8) glTexImage2D(GL_TEXTURE_2D, 0, internal, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    else glCompressedTexImage2D(GL_TEXTURE_2D, 0, internal, size, size, 0, (GLsizei)compressedLevelBytes(codec, size, size), nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+static void loadVirtualTiles(VirtualTextures& vt, AssetLoader& loader, const vector<uint64_t>& tiles) {
+    for (uint64_t t : tiles) {
+        auto it = vt.textures.find(vt.owners[t >> 32]);
+        if (it == vt.textures.end()) vt.residency.cancel(t);
+        else vt.pendingTiles[loader.loadTile(it->second.file, (uint32_t)t)] = t;
+    }
+}
+
+// The tile file of texture's image is open: from now on its materials sample through the page table
+// (bindMaterial). The placeholder stays white for anything that reads it directly.
+static void addVirtualTexture(VirtualTextures& vt, AssetLoader& loader, GLuint texture, const shared_ptr<const VirtualTextureFile>& file) {
+    if (!vt.atlas) createVirtualAtlas(vt, file->codec);
+    int id = 1;
+    while (id < 256 && vt.owners[id]) id++;
+    if (id == 256 || file->codec != vt.codec) {
+        cerr << "Cannot stream another virtual texture, keeping it white\n";
+        return;
+    }
+    VirtualAlbedo& v = vt.textures[texture];
+    v.file = file;
+    v.id = id;
+    vt.owners[id] = texture;
+    vector<uint64_t> load;
+    vt.residency.addTexture(id, file->levelCount, load);
+    const VirtualPageTable& table = *vt.residency.pageTable(id);
+    glGenTextures(1, &v.pageTable);
+    glBindTexture(GL_TEXTURE_2D, v.pageTable);
+    for (int l = 0; l < table.levelCount(); l++)
+        glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, table.levelSize(l), table.levelSize(l), 0, GL_RGBA, GL_UNSIGNED_BYTE, table.texels(l));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, table.levelCount() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    loadVirtualTiles(vt, loader, load);
+    cout << "Streaming " << file->width << "x" << file->height << " albedo as a virtual texture (" << file->levelCount << " levels)\n";
+}
+
+static void removeVirtualTexture(VirtualTextures& vt, GLuint texture) {
+    auto it = vt.textures.find(texture);
+    if (it == vt.textures.end()) return;
+    int id = it->second.id;
+    for (auto t = vt.pendingTiles.begin(); t != vt.pendingTiles.end();) {
+        if ((int)(t->second >> 32) != id) { ++t; continue; }
+        vt.residency.cancel(t->second);
+        t = vt.pendingTiles.erase(t);
+    }
+    vt.residency.removeTexture(id);
+    vt.owners[id] = 0;
+    glDeleteTextures(1, &it->second.pageTable);
+    vt.textures.erase(it);
+}
+
+// Arrived tiles go into the atlas (they are small, and each is worth a sharper screen, so they go
+// ahead of the other uploads) and changed page tables are re-sent.
+static void uploadVirtualTiles(VirtualTextures& vt, AssetLoader& loader, size_t& budget) {
+    vector<unique_ptr<TilePayload>> tiles;
+    loader.takeTiles(tiles);
+    if (tiles.empty()) return;
+    GLenum internal = codecInternalFormat(vt.codec, true);
+    glBindTexture(GL_TEXTURE_2D, vt.atlas);
+    for (auto& p : tiles) {
+        auto it = vt.pendingTiles.find(p->ticket);
+        if (it == vt.pendingTiles.end()) continue;   // its texture went away
+        uint64_t tile = it->second;
+        vt.pendingTiles.erase(it);
+        if (p->data.empty()) { vt.residency.cancel(tile); continue; }
+        int slot = vt.residency.place(tile, vt.frame);
+        if (slot < 0) continue;
+        int x = slot % kVirtualAtlasSlots * kVirtualTileStride, y = slot / kVirtualAtlasSlots * kVirtualTileStride;
+        if (vt.codec == TextureRGBA8)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, kVirtualTileStride, kVirtualTileStride, GL_RGBA, GL_UNSIGNED_BYTE, p->data.data());
+        else
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, x, y, kVirtualTileStride, kVirtualTileStride, internal, (GLsizei)p->data.size(), p->data.data());
+        budget -= min(budget, p->data.size());
+    }
+    for (auto& entry : vt.textures) {
+        VirtualPageTable& table = *vt.residency.pageTable(entry.second.id);
+        if (!table.update()) continue;
+        glBindTexture(GL_TEXTURE_2D, entry.second.pageTable);
+        for (int l = 0; l < table.levelCount(); l++)
+            glTexSubImage2D(GL_TEXTURE_2D, l, 0, 0, table.levelSize(l), table.levelSize(l), GL_RGBA, GL_UNSIGNED_BYTE, table.texels(l));
+    }
+}
+
+// Uniforms of the virtual texture behind albedo, read by pbr.fs and vt_feedback.fs; vtId 0 and
+// virtualAlbedo false for an ordinary texture. Returns the virtual texture, or nullptr.
+static const VirtualAlbedo* setVirtualUniforms(GLuint program, const VirtualTextures& vt, GLuint albedo) {
+    auto it = vt.textures.find(albedo);
+    const VirtualAlbedo* v = (it == vt.textures.end()) ? nullptr : &it->second;
+    glUniform1i(glGetUniformLocation(program, "vtId"), v ? v->id : 0);
+    glUniform1i(glGetUniformLocation(program, "virtualAlbedo"), v ? 1 : 0);
+    if (!v) return nullptr;
+    const VirtualTextureFile& f = *v->file;
+    glUniform2f(glGetUniformLocation(program, "vtScale"), (float)f.width / f.size, (float)f.height / f.size);
+    glUniform1f(glGetUniformLocation(program, "vtSize"), (float)f.size);
+    glUniform1i(glGetUniformLocation(program, "vtLevelCount"), f.levelCount);
+    return v;
+}
+
+// Returns the texture with a reference added, or 0 when the file failed to load before.
+static GLuint requestTexture(AssetStreamer& streamer, MaterialTable& table, const string& path, int slot, bool isDefault = false) {
+    string key = textureKey(path, streamer.codecs[slot], textureMipOptions(slot));
+    GLuint tex;
+    if (table.textures.acquire(key, tex)) return tex;
+    TextureUpload up;
+    up.texture = (slot == MaterialNormal) ? createSolidTexture(128, 128, 255) : createSolidTexture(255, 255, 255);
+    up.slot = slot;
+    up.isDefault = isDefault;
+    tex = up.texture;
+    int virtualMinSize = (slot == MaterialAlbedo) ? kVirtualAlbedoMinSize : 0;
+    AssetLoader& loader = streamer.loader;
+    TextureCodec codec = streamer.codecs[slot];
+    up.load = [&loader, path, codec, slot, virtualMinSize]() { return loader.loadImage(path, true, codec, textureMipOptions(slot), virtualMinSize); };
+    uint32_t ticket = up.load();
+    streamer.pendingTextures[ticket] = std::move(up);
+    table.textures.add(key, tex);
+    return tex;
+}
+
+// Packed AO / roughness / metallic, shared by every material with the same sources. Same contract as
+// requestTexture: 0 when the sources failed to load before.
+static GLuint requestOrmTexture(AssetStreamer& streamer, MaterialTable& table, const OrmSources& src) {
+    string key = textureKey(ormKey(src), streamer.ormCodec, textureMipOptions(MaterialAO));
+    GLuint tex;
+    if (table.textures.acquire(key, tex)) return tex;
+    TextureUpload up;
+    up.texture = createSolidTexture(255, 255, 255);
+    up.slot = MaterialAO;
+    tex = up.texture;
+    AssetLoader& loader = streamer.loader;
+    TextureCodec codec = streamer.ormCodec;
+    up.load = [&loader, src, codec]() { return loader.loadOrm(src, true, codec, textureMipOptions(MaterialAO)); };
+    uint32_t ticket = up.load();
+    streamer.pendingTextures[ticket] = std::move(up);
+    table.textures.add(key, tex);
+    return tex;
+}
+
+static bool isOrmSlot(int t) {
+    return t == MaterialAO || t == MaterialRoughness || t == MaterialMetallic;
+}
+
+// A named map that loads replaces the MTL constant (exporters write Kd 0.8 next to map_Kd);
+// a named map that fails falls back to the scene default texture; an unnamed map leaves the constant
+// on a white texture. Normal and AO have no constant and always fall back to the scene default.
+static GpuMaterial makeMaterial(AssetStreamer& streamer, MaterialTable& table, const MeshMaterial& m, const string& baseDir) {
+    GpuMaterial g;
+    float* factors[kMaterialTextureCount] = { nullptr, nullptr, &g.metallic, &g.roughness, nullptr };
+    for (int t = 0; t < kMaterialTextureCount; t++) {
+        bool scalar = (t == MaterialAlbedo || factors[t]);
+        if (m.textures[t][0]) {
+            if (kPackOrmMaps && isOrmSlot(t)) continue;
+            GLuint tex = requestTexture(streamer, table, baseDir + m.textures[t], t);
+            if (!tex) table.textures.addRef(table.defaults[t]);
+            g.textures[t] = tex ? tex : table.defaults[t];
+        }
+        else {
+            g.textures[t] = scalar ? table.white : table.defaults[t];
+            table.textures.addRef(g.textures[t]);
+            if (t == MaterialAlbedo) g.baseColor = glm::make_vec3(m.baseColor);
+            if (factors[t]) *factors[t] = (t == MaterialMetallic) ? m.metallic : m.roughness;
+        }
+    }
+    // same rules per channel: a missing map falls back to the scene default, an unnamed scalar map is 1
+    if (kPackOrmMaps) {
+        const int slots[kOrmChannelCount] = { MaterialAO, MaterialRoughness, MaterialMetallic };
+        OrmSources src;
+        for (int c = 0; c < kOrmChannelCount; c++) {
+            int t = slots[c];
+            src.fallbacks[c] = table.defaultPaths[t];
+            if (m.textures[t][0]) src.paths[c] = baseDir + m.textures[t];
+            else if (!factors[t]) src.paths[c] = table.defaultPaths[t];
+        }
+        g.orm = requestOrmTexture(streamer, table, src);
+        if (!g.orm) {
+            g.orm = table.white;
+            table.textures.addRef(g.orm);
+        }
+    }
+    return g;
+}
+
+// Texture that failed to decode: materials go back to the scene defaults, as if it were never found.
+static void dropTexture(MaterialTable& table, const TextureUpload& up) {
+    for (GpuMaterial& m : table.materials) {
+        for (int t = 0; t < kMaterialTextureCount; t++)
+            if (m.textures[t] == up.texture) {
+                m.textures[t] = table.defaults[t];
+                table.textures.addRef(m.textures[t]);
             }
-            else { data.push_back(0.0f); data.push_back(0.0f); }
-            idx.push_back(index++);
+        if (m.orm == up.texture) {
+            m.orm = table.white;
+            table.textures.addRef(m.orm);
         }
     }
-    // upload to GL
-    glGenVertexArrays(1, &mesh.vao);
-    glBindVertexArray(mesh.vao);
+    table.textures.fail(up.texture);
+    glDeleteTextures(1, &up.texture);
+}
+
+// Texture whose content turned out to be loaded already as shared: its users and references move
+// over and its placeholder goes away without anything being decoded or uploaded.
+static void mergeTexture(MaterialTable& table, const TextureUpload& up, GLuint shared) {
+    for (GpuMaterial& m : table.materials) {
+        for (GLuint& tex : m.textures)
+            if (tex == up.texture) tex = shared;
+        if (m.orm == up.texture) m.orm = shared;
+    }
+    for (GLuint& tex : table.defaults)
+        if (tex == up.texture) tex = shared;
+    table.textures.merge(up.texture, shared);
+    cout << "Texture " << up.image->path << " has the content of a loaded one, sharing it\n";
+    glDeleteTextures(1, &up.texture);
+}
+
+// Drops one reference; the last one deletes the texture and forgets any load still under way.
+static void releaseTexture(AssetStreamer& streamer, MaterialTable& table, GLuint tex) {
+    uint64_t content = 0;
+    if (!table.textures.release(tex, &content)) return;
+    if (content) streamer.loader.releaseContent(content);
+    for (auto it = streamer.pendingTextures.begin(); it != streamer.pendingTextures.end();)
+        it = (it->second.texture == tex) ? streamer.pendingTextures.erase(it) : next(it);
+    auto queued = [tex](const TextureUpload& up) { return up.texture == tex; };
+    streamer.textureQueue.erase(remove_if(streamer.textureQueue.begin(), streamer.textureQueue.end(), queued), streamer.textureQueue.end());
+    for (auto& d : streamer.duplicates) d.second.erase(remove_if(d.second.begin(), d.second.end(), queued), d.second.end());
+    removeVirtualTexture(streamer.virtualTextures, tex);
+    glDeleteTextures(1, &tex);
+}
+
+static void releaseMaterial(AssetStreamer& streamer, MaterialTable& table, GpuMaterial& m) {
+    for (GLuint& tex : m.textures) {
+        releaseTexture(streamer, table, tex);
+        tex = table.white;
+    }
+    if (m.orm) releaseTexture(streamer, table, m.orm);
+    m.orm = 0;
+}
+
+// Stores g in a free entry of the table, else in a new one; returns its index.
+static uint32_t addMaterial(MaterialTable& table, const GpuMaterial& g) {
+    if (table.freeMaterials.empty()) {
+        table.materials.push_back(g);
+        return (uint32_t)table.materials.size() - 1;
+    }
+    uint32_t index = table.freeMaterials.back();
+    table.freeMaterials.pop_back();
+    table.materials[index] = g;
+    return index;
+}
+
+// A decoded image: queued for upload, and loads of the same content that were waiting share it.
+static void acceptTexture(AssetStreamer& streamer, MaterialTable& table, TextureUpload up) {
+    uint64_t content = up.image->contentHash;
+    if (content) table.textures.setContent(up.texture, content);
+    GLuint shared = up.texture;
+    if (up.image->tiles) addVirtualTexture(streamer.virtualTextures, streamer.loader, up.texture, up.image->tiles);
+    else streamer.textureQueue.push_back(std::move(up));
+    auto waiting = streamer.duplicates.find(content);
+    if (!content || waiting == streamer.duplicates.end()) return;
+    for (const TextureUpload& d : waiting->second) mergeTexture(table, d, shared);
+    streamer.duplicates.erase(waiting);
+}
+
+// A duplicate by content: shares the loaded texture, or waits for the load that claimed the content.
+// When that load has failed or gone away in the meantime nothing would wake it, so it loads the file
+// itself after all (and fails the usual way if the content is broken).
+static void acceptDuplicate(AssetStreamer& streamer, MaterialTable& table, TextureUpload up) {
+    uint64_t content = up.image->contentHash;
+    GLuint shared = table.textures.findContent(content);
+    if (shared) mergeTexture(table, up, shared);
+    else if (streamer.loader.contentClaimed(content)) streamer.duplicates[content].push_back(std::move(up));
+    else {
+        up.image.reset();
+        uint32_t ticket = up.load();
+        streamer.pendingTextures[ticket] = std::move(up);
+    }
+}
+
+// Copies at most budget bytes of the range. Returns true when it is complete.
+static bool uploadBufferSlice(BufferRange& r, size_t& budget) {
+    size_t bytes = min(r.end - r.done, budget);
+    if (bytes) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, r.buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)r.done, (GLsizeiptr)bytes, (const char*)r.src + r.done);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        r.done += bytes;
+        budget -= bytes;
+    }
+    return r.done == r.end;
+}
+
+// Ranges covering the blocks of src that differ from the previous contents (adjacent blocks merged).
+static void addChangedRanges(GLuint buffer, const void* src, size_t size, const vector<uint64_t>& blocks,
+                             const vector<uint64_t>& previous, vector<BufferRange>& ranges) {
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (i < previous.size() && blocks[i] == previous[i]) continue;
+        size_t begin = i * kUploadBlockBytes, end = min(size, begin + kUploadBlockBytes);
+        if (!ranges.empty() && ranges.back().buffer == buffer && ranges.back().end == begin) ranges.back().end = end;
+        else {
+            BufferRange r;
+            r.buffer = buffer; r.src = src; r.done = begin; r.end = end;
+            ranges.push_back(r);
+        }
+    }
+}
+
+// Chooses between patching the target in place and a fresh staging Mesh; run when the upload
+// reaches the front of the queue, so earlier updates of the same mesh have landed.
+static void beginMeshUpload(MeshUpload& up) {
+    const MeshPayload& p = *up.payload;
+    const Mesh& target = *up.target;
+    GLenum indexType = (p.view.indexSize == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    GLenum primitive = p.view.strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+    up.started = true;
+    up.reload = target.ready;
+    // split formats place their streams by vertex count, so that has to stay the same
+    up.inPlace = target.ready && target.format == p.format && target.indexType == indexType && target.primitive == primitive &&
+                 p.vertexByteSize() <= target.vertexCapacity && p.indexByteSize() <= target.indexCapacity &&
+                 (vertexFormatStreamCount(p.format) == 1 || target.vertexCount == p.view.vertexCount);
+    if (up.inPlace) {
+        addChangedRanges(target.vbo, p.vertexBytes(), p.vertexByteSize(), p.vertexBlocks, target.vertexBlocks, up.ranges);
+        addChangedRanges(target.ebo, p.view.indices, p.indexByteSize(), p.indexBlocks, target.indexBlocks, up.ranges);
+        for (const BufferRange& r : up.ranges) up.bytes += r.end - r.done;
+        return;
+    }
+    Mesh& mesh = up.staging;
+    mesh.vertexCapacity = p.vertexByteSize();
+    mesh.indexCapacity = p.indexByteSize();
     glGenBuffers(1, &mesh.vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
-    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mesh.vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, mesh.vertexCapacity, nullptr, GL_STATIC_DRAW);
     glGenBuffers(1, &mesh.ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(unsigned int), idx.data(), GL_STATIC_DRAW);
-    // format: pos(3), norm(3), uv(2) => stride = 8 floats
-    GLsizei stride = 8 * sizeof(float);
-    glEnableVertexAttribArray(0); glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-    glEnableVertexAttribArray(1); glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2); glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
-    glBindVertexArray(0);
-    mesh.count = (GLsizei)idx.size();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mesh.ebo);
+    glBufferData(GL_COPY_WRITE_BUFFER, mesh.indexCapacity, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    BufferRange r;
+    r.buffer = mesh.vbo; r.src = p.vertexBytes(); r.end = mesh.vertexCapacity;
+    up.ranges.push_back(r);
+    r.buffer = mesh.ebo; r.src = p.view.indices; r.end = mesh.indexCapacity;
+    up.ranges.push_back(r);
+    up.bytes = mesh.vertexCapacity + mesh.indexCapacity;
+}
+
+static bool continueMeshUpload(MeshUpload& up, size_t& budget) {
+    for (; up.nextRange < up.ranges.size(); up.nextRange++)
+        if (!uploadBufferSlice(up.ranges[up.nextRange], budget)) return false;
     return true;
 }
 
+// Attribute setup expanded from the mesh's vertex format; the depth VAO gets the position alone, which
+// split formats keep in a stream of its own (8 or 12 bytes per vertex for z-prepass / shadows).
+static_assert(ComponentUByte == GL_UNSIGNED_BYTE && ComponentUShort == GL_UNSIGNED_SHORT && ComponentFloat == GL_FLOAT &&
+              ComponentHalf == GL_HALF_FLOAT && ComponentInt2101010Rev == GL_INT_2_10_10_10_REV, "ComponentType must hold GL enums");
+static void createMeshVao(Mesh& mesh) {
+    glGenVertexArrays(1, &mesh.vao);
+    glGenVertexArrays(1, &mesh.depthVao);
+    GLuint vaos[2] = { mesh.vao, mesh.depthVao };
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    visitVertexFormat(mesh.format, [&](auto format) {
+        decltype(format)::forEachAttribute(mesh.vertexCount, [&](size_t, size_t stride, size_t start, VertexSemantic semantic,
+                                                                 ComponentType type, int count, bool normalized, size_t offset) {
+            for (int i = 0; i < (semantic == SemanticPosition ? 2 : 1); i++) {
+                glBindVertexArray(vaos[i]);
+                glEnableVertexAttribArray(semantic);
+                glVertexAttribPointer(semantic, count, type, normalized ? GL_TRUE : GL_FALSE, (GLsizei)stride, (void*)(start + offset));
+            }
+        });
+    });
+    for (GLuint vao : vaos) {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+    }
+    glBindVertexArray(0);
+}
+
+// Buffers are complete: the draw ranges and bounds switch over together. For a fresh Mesh the
+// target's previous buffers go away only now.
+static void finishMeshUpload(MeshUpload& up) {
+    const MeshPayload& p = *up.payload;
+    Mesh& target = *up.target;
+    if (!up.inPlace) {
+        Mesh& mesh = up.staging;
+        mesh.format = p.format;
+        mesh.vertexCount = p.view.vertexCount;
+        mesh.indexType = (p.view.indexSize == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        mesh.primitive = p.view.strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+        createMeshVao(mesh);
+        mesh.ready = true;
+        glDeleteVertexArrays(1, &target.vao);
+        glDeleteVertexArrays(1, &target.depthVao);
+        glDeleteBuffers(1, &target.vbo);
+        glDeleteBuffers(1, &target.ebo);
+        target = std::move(mesh);
+    }
+    target.dequant = p.dequant;
+    target.lods.assign(p.view.lods, p.view.lods + p.view.lodCount);
+    target.submeshes.assign(p.view.submeshes, p.view.submeshes + p.view.submeshCount);
+    target.meshlets.assign(p.view.meshlets, p.view.meshlets + p.view.meshletCount);
+    target.materials = up.materials;
+    target.boxMin = glm::make_vec3(p.view.bounds.min);
+    target.boxMax = glm::make_vec3(p.view.bounds.max);
+    target.center = glm::make_vec3(p.view.bounds.center);
+    target.radius = p.view.bounds.radius;
+    target.vertexBlocks = p.vertexBlocks;
+    target.indexBlocks = p.indexBlocks;
+}
+
+// Mesh payload into a complete Mesh in one go (for small generated meshes).
+static void uploadMeshNow(unique_ptr<MeshPayload> payload, Mesh& target, const vector<uint32_t>& materials) {
+    MeshUpload up;
+    up.payload = std::move(payload);
+    up.target = &target;
+    up.materials = materials;
+    beginMeshUpload(up);
+    size_t budget = SIZE_MAX;
+    continueMeshUpload(up, budget);
+    finishMeshUpload(up);
+}
+
+// Starts loading an OBJ into mesh in the background and reloads it whenever the file changes;
+// see pumpAssets.
+static void requestMesh(AssetStreamer& streamer, const string& path, Mesh& mesh, VertexFormatId format = VertexFormatCompact,
+                        const MeshImportOptions& opt = MeshImportOptions()) {
+    WatchedMesh& w = streamer.meshFiles[path];
+    w.mesh = &mesh;
+    w.format = format;
+    w.opt = opt;
+    streamer.watcher.watch(path);
+    streamer.pendingMeshes[streamer.loader.loadMesh(path, opt, format)] = &mesh;
+}
+
+// Re-imports the watched meshes whose OBJ changed on disk. Cheap; call a couple of times a second.
+static void reloadChangedMeshes(AssetStreamer& streamer) {
+    vector<string> changed;
+    streamer.watcher.poll(changed);
+    for (const string& path : changed) {
+        const WatchedMesh& w = streamer.meshFiles[path];
+        cout << "Reloading " << path << "\n";
+        streamer.pendingMeshes[streamer.loader.loadMesh(path, w.opt, w.format)] = w.mesh;
+    }
+}
+
+// Once per frame: collect finished loads and spend at most kUploadBytesPerFrame on uploads.
+// Returns the number of assets still loading or uploading.
+static size_t pumpAssets(AssetStreamer& streamer, MaterialTable& table) {
+    vector<unique_ptr<ImagePayload>> images;
+    streamer.loader.takeImages(images);
+    for (auto& img : images) {
+        auto it = streamer.pendingTextures.find(img->ticket);
+        uint64_t content = img->contentHash;
+        if (it == streamer.pendingTextures.end()) {
+            // released while loading: a load waiting on its content takes it over, else the claim goes
+            auto waiting = streamer.duplicates.find(content);
+            if (img->duplicate || !content) continue;
+            if (waiting == streamer.duplicates.end() || waiting->second.empty() || img->empty()) {
+                streamer.loader.releaseContent(content);
+                continue;
+            }
+            TextureUpload up = std::move(waiting->second.front());
+            waiting->second.erase(waiting->second.begin());
+            up.image = std::move(img);
+            acceptTexture(streamer, table, std::move(up));
+            continue;
+        }
+        TextureUpload up = std::move(it->second);
+        streamer.pendingTextures.erase(it);
+        up.image = std::move(img);
+        if (up.image->duplicate) acceptDuplicate(streamer, table, std::move(up));
+        else if (!up.image->empty()) acceptTexture(streamer, table, std::move(up));
+        else {
+            // the same content fails for everyone waiting on it
+            if (content) streamer.loader.releaseContent(content);
+            auto waiting = streamer.duplicates.find(content);
+            if (content && waiting != streamer.duplicates.end()) {
+                for (const TextureUpload& d : waiting->second)
+                    if (!d.isDefault) dropTexture(table, d);
+                streamer.duplicates.erase(waiting);
+            }
+            if (!up.isDefault) dropTexture(table, up);
+        }
+    }
+    vector<unique_ptr<MeshPayload>> meshes;
+    streamer.loader.takeMeshes(meshes);
+    for (auto& payload : meshes) {
+        auto it = streamer.pendingMeshes.find(payload->ticket);
+        if (it == streamer.pendingMeshes.end()) continue;
+        Mesh* target = it->second;
+        streamer.pendingMeshes.erase(it);
+        // a failed reload (say, a half-saved OBJ) keeps the mesh as it was
+        if (!payload->ok) { cerr << "Failed to load model: " << payload->path << "\n"; continue; }
+        MeshUpload up;
+        up.payload = std::move(payload);
+        up.target = target;
+        // textures start decoding now, while the buffers upload; a reload with the same number of
+        // materials overwrites the mesh's table entries, any other takes free or new ones
+        const MeshPayload& p = *up.payload;
+        string baseDir = p.path.substr(0, p.path.find_last_of("/\\") + 1);
+        bool reuse = (target->materials.size() == p.view.materialCount);
+        for (size_t i = 0; i < p.view.materialCount; i++) {
+            GpuMaterial g = makeMaterial(streamer, table, p.view.materials[i], baseDir);
+            if (reuse) {
+                // the new material holds its references already, so textures both use stay alive
+                releaseMaterial(streamer, table, table.materials[target->materials[i]]);
+                table.materials[target->materials[i]] = g;
+            }
+            else up.materials.push_back(addMaterial(table, g));
+        }
+        if (reuse) up.materials = target->materials;
+        // first load: the bounds are enough to draw a proxy meanwhile
+        if (!target->ready) {
+            target->boxMin = glm::make_vec3(p.view.bounds.min);
+            target->boxMax = glm::make_vec3(p.view.bounds.max);
+            target->center = glm::make_vec3(p.view.bounds.center);
+            target->radius = p.view.bounds.radius;
+        }
+        streamer.meshQueue.push_back(std::move(up));
+    }
+
+    size_t budget = kUploadBytesPerFrame;
+    uploadVirtualTiles(streamer.virtualTextures, streamer.loader, budget);
+    while (budget && !streamer.textureQueue.empty()) {
+        TextureUpload& up = streamer.textureQueue.front();
+        bool done = up.image->compressed.levels.empty() ? uploadImageSlice(up.texture, *up.image, up.rowsDone, budget, up.slot == MaterialAlbedo)
+                                                        : uploadCompressedLevels(up.texture, *up.image, up.levelsDone, budget);
+        if (!done) break;
+        streamer.textureQueue.pop_front();
+    }
+    // An in-place update spanning several frames draws a mix of old and new blocks until it is
+    // done; edits usually touch a few blocks, which fit in one frame.
+    while (budget && !streamer.meshQueue.empty()) {
+        MeshUpload& up = streamer.meshQueue.front();
+        if (!up.started) beginMeshUpload(up);
+        if (!continueMeshUpload(up, budget)) break;
+        if (up.reload) {
+            const MeshPayload& p = *up.payload;
+            cout << "Reloaded " << p.path << ": " << (up.inPlace ? "in place, " : "new buffers, ") << up.bytes / 1024 << " of "
+                 << (p.vertexByteSize() + p.indexByteSize()) / 1024 << " KB uploaded\n";
+        }
+        // a reload into new table entries leaves the old ones free for the next
+        if (up.reload && up.materials != up.target->materials)
+            for (uint32_t m : up.target->materials) {
+                releaseMaterial(streamer, table, table.materials[m]);
+                table.freeMaterials.push_back(m);
+            }
+        finishMeshUpload(up);
+        streamer.meshQueue.pop_front();
+    }
+    size_t waiting = 0;
+    for (const auto& d : streamer.duplicates) waiting += d.second.size();
+    return streamer.loader.pending() + streamer.textureQueue.size() + streamer.meshQueue.size() + waiting;
+}
+
+// Unit box (-1..1) in the float vertex format, drawn scaled to a mesh's AABB while it loads.
+static unique_ptr<MeshPayload> makeBoxPayload() {
+    unique_ptr<MeshPayload> p(new MeshPayload());
+    MeshData& d = p->data;
+    for (int axis = 0; axis < 3; axis++) {
+        for (int side = -1; side <= 1; side += 2) {
+            float n[3] = { 0, 0, 0 }, u[3] = { 0, 0, 0 }, v[3] = { 0, 0, 0 };
+            n[axis] = (float)side;
+            u[(axis + 1) % 3] = 1.0f;
+            v[(axis + 2) % 3] = (float)side;   // u x v = n, so the corners below wind counter-clockwise
+            uint32_t base = (uint32_t)d.vertexCount();
+            for (int c = 0; c < 4; c++) {
+                float su = (c == 1 || c == 2) ? 1.0f : -1.0f, sv = (c >= 2) ? 1.0f : -1.0f;
+                float vert[kMeshVertexFloats] = {};
+                for (int k = 0; k < 3; k++) { vert[k] = n[k] + su * u[k] + sv * v[k]; vert[3 + k] = n[k]; vert[8 + k] = u[k]; }
+                vert[6] = 0.5f + 0.5f * su; vert[7] = 0.5f + 0.5f * sv; vert[11] = 1.0f;
+                d.vertices.insert(d.vertices.end(), vert, vert + kMeshVertexFloats);
+            }
+            uint32_t quad[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+            d.indices.insert(d.indices.end(), quad, quad + 6);
+        }
+    }
+    d.bounds = computeBounds(d.vertices, kMeshVertexFloats);
+    d.lods.assign(1, MeshLod());
+    d.lods[0].indexCount = (uint32_t)d.indices.size();
+    d.lods[0].submeshCount = 1;
+    d.lods[0].triangleCount = 12;
+    d.submeshes.assign(1, MeshSubmesh());
+    d.submeshes[0].indexCount = (uint32_t)d.indices.size();
+    p->view = makeMeshView(d, p->scratch);
+    p->ok = true;
+    return p;
+}
+
+// -------------------- object culling --------------------
+// Runs before anything is queued: every instance's bounds go to world space into one SoA batch,
+// which is tested against the camera frustum in a single SIMD pass.
+struct MeshInstance {
+    const Mesh* mesh = nullptr;
+    glm::mat4 model = glm::mat4(1.0f);
+};
+
+static float maxAxisScale(const glm::mat4& m) {
+    return max(glm::length(glm::vec3(m[0])), max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+}
+
+static void cullInstances(const vector<MeshInstance>& instances, const glm::mat4& viewProj, ObjectBoundsSoA& bounds, vector<uint32_t>& visible) {
+    bounds.clear();
+    for (const MeshInstance& inst : instances) {
+        const Mesh& mesh = *inst.mesh;
+        const glm::mat4& m = inst.model;
+        // AABB under an affine transform (Arvo): new half extent = |linear part| * old half extent
+        glm::vec3 center = glm::vec3(m * glm::vec4(0.5f * (mesh.boxMin + mesh.boxMax), 1.0f));
+        glm::vec3 extent = 0.5f * (mesh.boxMax - mesh.boxMin), worldExtent(0.0f);
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++) worldExtent[i] += fabsf(m[j][i]) * extent[j];
+        glm::vec3 boxMin = center - worldExtent, boxMax = center + worldExtent;
+        glm::vec3 sphere = glm::vec3(m * glm::vec4(mesh.center, 1.0f));
+        bounds.add(glm::value_ptr(boxMin), glm::value_ptr(boxMax), glm::value_ptr(sphere), mesh.radius * maxAxisScale(m));
+    }
+    cullObjects(extractFrustum(glm::value_ptr(viewProj)), bounds, visible);
+}
+
+// -------------------- LOD selection --------------------
+// Coarsest LOD whose simplification error stays below maxPixelError once the model is projected:
+// the bounding sphere's screen size (at its nearest point) scales the error relative to its diameter.
+static size_t selectLod(const Mesh& mesh, const glm::mat4& model, const Camera& cam, int screenHeight, float maxPixelError = 1.0f) {
+    if (mesh.lods.size() <= 1 || mesh.radius <= 0.0f) return 0;
+    float scale = maxAxisScale(model);
+    glm::vec3 center = glm::vec3(model * glm::vec4(mesh.center, 1.0f));
+    float radius = mesh.radius * scale;
+    float distance = max(glm::length(center - cam.pos) - radius, 0.1f);   // near plane
+    float screenSize = 2.0f * radius / (2.0f * distance * tan(glm::radians(cam.fov) * 0.5f)) * screenHeight;   // pixels
+    size_t lod = 0;
+    for (size_t i = 1; i < mesh.lods.size(); i++)
+        if (mesh.lods[i].error / (2.0f * mesh.radius) * screenSize <= maxPixelError) lod = i;
+    return lod;
+}
+
+// -------------------- cluster-culled draw --------------------
+// Meshlets of one submesh outside the frustum or facing away from the camera are skipped; the rest
+// are drawn as merged index ranges with one glMultiDrawElements. eye is the camera position in mesh
+// space. Culling stats are added to list.stats. The mesh VAO and its restart index must be bound.
+struct ClusterDrawList {
+    vector<uint32_t> firsts, counts;
+    vector<GLsizei> drawCounts;
+    vector<const void*> drawOffsets;
+    ClusterCullStats stats;
+};
+static void drawSubmeshCulled(const Mesh& mesh, const MeshSubmesh& sub, const Frustum& frustum, const glm::vec3& eye, ClusterDrawList& list) {
+    size_t indexBytes = (mesh.indexType == GL_UNSIGNED_SHORT) ? 2 : 4;
+    if (sub.meshletCount == 0) {
+        glDrawElements(mesh.primitive, (GLsizei)sub.indexCount, mesh.indexType, (void*)(sub.indexOffset * indexBytes));
+        return;
+    }
+    ClusterCullStats stats;
+    cullMeshlets(&mesh.meshlets[sub.meshletOffset], sub.meshletCount, frustum, glm::value_ptr(eye), list.firsts, list.counts, &stats);
+    list.stats.total += stats.total;
+    list.stats.frustumCulled += stats.frustumCulled;
+    list.stats.backfaceCulled += stats.backfaceCulled;
+    list.drawCounts.resize(list.counts.size());
+    list.drawOffsets.resize(list.firsts.size());
+    for (size_t i = 0; i < list.firsts.size(); i++) {
+        list.drawCounts[i] = (GLsizei)list.counts[i];
+        list.drawOffsets[i] = (const void*)(list.firsts[i] * indexBytes);
+    }
+    if (!list.firsts.empty())
+        glMultiDrawElements(mesh.primitive, list.drawCounts.data(), mesh.indexType, list.drawOffsets.data(), (GLsizei)list.firsts.size());
+}
+
+// Strip meshes end every strip with the largest value of their index type (kStripRestartIndex at
+// upload width); list meshes never reach it, so restart stays enabled for all of them.
+static GLuint restartIndex(GLenum indexType) {
+    return indexType == GL_UNSIGNED_SHORT ? 0xFFFFu : 0xFFFFFFFFu;
+}
+
+// -------------------- sorted draw submission --------------------
+// One item per visible submesh. The key orders by program, then material, then view depth
+// (front to back), so program switches and texture rebinds happen once per run of equal keys:
+//   bits 56..63 program (truncated, only affects order), 32..55 material, 0..31 depth as float bits
+struct DrawItem {
+    uint64_t key = 0;
+    GLuint program = 0;
+    uint32_t material = 0;
+    const Mesh* mesh = nullptr;
+    const MeshSubmesh* submesh = nullptr;
+    glm::mat4 model = glm::mat4(1.0f);
+};
+
+static uint64_t drawKey(GLuint program, uint32_t material, float depth) {
+    uint32_t depthBits;
+    depth = max(depth, 0.0f);   // non-negative floats order like their bit patterns
+    memcpy(&depthBits, &depth, sizeof(depthBits));
+    return ((uint64_t)(program & 0xFF) << 56) | ((uint64_t)(material & 0xFFFFFF) << 32) | depthBits;
+}
+
+// Queues every submesh of the LOD chosen for this instance.
+static void queueMesh(const Mesh& mesh, GLuint program, const glm::mat4& model, const glm::mat4& view, const Camera& cam,
+                      int screenHeight, vector<DrawItem>& items) {
+    if (mesh.lods.empty()) return;
+    const MeshLod& lod = mesh.lods[selectLod(mesh, model, cam, screenHeight)];
+    float depth = -(view * model * glm::vec4(mesh.center, 1.0f)).z;
+    for (uint32_t i = 0; i < lod.submeshCount; i++) {
+        DrawItem item;
+        item.program = program;
+        item.mesh = &mesh;
+        item.submesh = &mesh.submeshes[lod.submeshOffset + i];
+        item.material = mesh.materials[item.submesh->material];
+        item.model = model;
+        item.key = drawKey(program, item.material, depth);
+        items.push_back(item);
+    }
+}
+
+// Units 0-4 hold the material maps, 5 and 6 the atlas and page table of a virtual albedo.
+static void bindMaterial(GLuint program, const GpuMaterial& m, const VirtualTextures& vt) {
+    for (int t = 0; t < kMaterialTextureCount; t++) {
+        if (m.orm && t > MaterialMetallic) break;
+        glActiveTexture(GL_TEXTURE0 + t);
+        glBindTexture(GL_TEXTURE_2D, m.orm && t == MaterialMetallic ? m.orm : m.textures[t]);
+    }
+    if (const VirtualAlbedo* v = setVirtualUniforms(program, vt, m.textures[MaterialAlbedo])) {
+        glActiveTexture(GL_TEXTURE5);
+        glBindTexture(GL_TEXTURE_2D, vt.atlas);
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_2D, v->pageTable);
+    }
+    glUniform3fv(glGetUniformLocation(program, "baseColorFactor"), 1, glm::value_ptr(m.baseColor));
+    glUniform1f(glGetUniformLocation(program, "metallicFactor"), m.metallic);
+    glUniform1f(glGetUniformLocation(program, "roughnessFactor"), m.roughness);
+}
+
+// Mesh and instance state of one pass over the queue; bindMeshState sends only what differs from the
+// previous item.
+struct MeshDrawState {
+    const Mesh* mesh = nullptr;
+    const float* model = nullptr;
+    Frustum frustum;   // mesh space, for cluster culling
+    glm::vec3 eye;
+};
+
+// VAO (the position-only one for depth passes), restart index, dequantization and model uniforms of
+// item, and the frustum and eye its clusters are culled with.
+static void bindMeshState(MeshDrawState& state, GLuint program, const DrawItem& item, bool depthOnly, const glm::mat4& viewProj,
+                          const glm::vec3& camPos) {
+    const Mesh* mesh = state.mesh;
+    if (item.mesh != mesh) {
+        GLuint vao = depthOnly ? item.mesh->depthVao : item.mesh->vao;
+        if (!mesh || (depthOnly ? mesh->depthVao : mesh->vao) != vao) glBindVertexArray(vao);
+        if (!mesh || mesh->indexType != item.mesh->indexType) glPrimitiveRestartIndex(restartIndex(item.mesh->indexType));
+        if (!mesh || memcmp(&mesh->dequant, &item.mesh->dequant, sizeof(PositionDequant)) != 0) {
+            glUniform3fv(glGetUniformLocation(program, "posOffset"), 1, item.mesh->dequant.offset);
+            glUniform3fv(glGetUniformLocation(program, "posScale"), 1, item.mesh->dequant.scale);
+        }
+        if (!depthOnly && (!mesh || isQuantizedFormat(mesh->format) != isQuantizedFormat(item.mesh->format)))
+            glUniform1i(glGetUniformLocation(program, "octTangents"), isQuantizedFormat(item.mesh->format) ? 1 : 0);
+        state.mesh = item.mesh;
+    }
+    if (!state.model || memcmp(state.model, glm::value_ptr(item.model), sizeof(glm::mat4)) != 0) {
+        state.model = glm::value_ptr(item.model);
+        glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, state.model);
+        state.frustum = extractFrustum(glm::value_ptr(viewProj * item.model));
+        state.eye = glm::vec3(glm::inverse(item.model) * glm::vec4(camPos, 1.0f));
+    }
+}
+
+// Sorts and submits the queue; per-frame uniforms must already be set on each program.
+static void submitDraws(vector<DrawItem>& items, const MaterialTable& materials, const VirtualTextures& virtualTextures,
+                        const glm::mat4& viewProj, const glm::vec3& camPos, ClusterDrawList& list) {
+    sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+    list.stats = ClusterCullStats();
+    GLuint program = 0;
+    uint32_t material = UINT32_MAX;
+    MeshDrawState state;
+    for (const DrawItem& item : items) {
+        bool programChanged = item.program != program;
+        if (programChanged) { program = item.program; glUseProgram(program); material = UINT32_MAX; state = MeshDrawState(); }
+        if (item.material != material) { material = item.material; bindMaterial(program, materials.materials[material], virtualTextures); }
+        bindMeshState(state, program, item, false, viewProj, camPos);
+        drawSubmeshCulled(*item.mesh, *item.submesh, state.frustum, state.eye, list);
+    }
+    glBindVertexArray(0);
+    items.clear();
+}
+
+// Depth-only pass over the queue (z-prepass; shadow maps would use it with a light's matrices):
+// position-only VAOs, no material binds, the same LOD and cluster culling. Leaves items as they are
+// for submitDraws; program needs projection and view set.
+static void submitDepthDraws(const vector<DrawItem>& items, GLuint program, const glm::mat4& viewProj, const glm::vec3& camPos,
+                             ClusterDrawList& list) {
+    glUseProgram(program);
+    MeshDrawState state;
+    for (const DrawItem& item : items) {
+        bindMeshState(state, program, item, true, viewProj, camPos);
+        drawSubmeshCulled(*item.mesh, *item.submesh, state.frustum, state.eye, list);
+    }
+    glBindVertexArray(0);
+}
+
+// -------------------- virtual texture feedback --------------------
+// The queue drawn again into the feedback buffer with program (pbr.vs + vt_feedback.fs), through the
+// full VAOs for the texture coordinates; materials without a virtual albedo only occlude. Then the
+// buffer starts reading back, and the read issued kReadbacks - 1 frames ago becomes tile loads.
+// Leaves items as they are; program needs projection and view set. Binds the default framebuffer.
+static void runVirtualFeedback(AssetStreamer& streamer, const vector<DrawItem>& items, const MaterialTable& materials, GLuint program,
+                               const glm::mat4& viewProj, const glm::vec3& camPos, ClusterDrawList& list) {
+    VirtualTextures& vt = streamer.virtualTextures;
+    vt.frame++;
+    glBindFramebuffer(GL_FRAMEBUFFER, vt.fbo);
+    glViewport(0, 0, vt.width, vt.height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glUseProgram(program);
+    uint32_t material = UINT32_MAX;
+    MeshDrawState state;
+    for (const DrawItem& item : items) {
+        if (item.material != material) {
+            material = item.material;
+            setVirtualUniforms(program, vt, materials.materials[material].textures[MaterialAlbedo]);
+        }
+        bindMeshState(state, program, item, false, viewProj, camPos);
+        drawSubmeshCulled(*item.mesh, *item.submesh, state.frustum, state.eye, list);
+    }
+    glBindVertexArray(0);
+
+    size_t bytes = (size_t)vt.width * vt.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, vt.pbos[vt.next]);
+    glReadPixels(0, 0, vt.width, vt.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    vt.issued[vt.next] = true;
+    vt.next = (vt.next + 1) % VirtualTextures::kReadbacks;
+    if (vt.issued[vt.next]) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, vt.pbos[vt.next]);
+        const unsigned char* texels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_READ_BIT);
+        if (texels) collectFeedback(texels, bytes / 4, vt.seen);
+        else vt.seen.clear();
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        vt.issued[vt.next] = false;
+        vt.load.clear();
+        vt.residency.request(vt.seen, vt.frame, kVirtualTilesLoading, vt.load);
+        loadVirtualTiles(vt, streamer.loader, vt.load);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// -------------------- GPU timing --------------------
+// GL_TIME_ELAPSED around a pass. Each query is read back kQueries frames after it was issued, when the
+// GPU is long done with it, so the CPU does not stall; ms is a running average of the results.
+struct GpuTimer {
+    static const int kQueries = 4;
+    GLuint queries[kQueries] = {};
+    bool issued[kQueries] = {};
+    int next = 0;
+    float ms = 0.0f;
+};
+
+static void beginGpuTimer(GpuTimer& t) {
+    if (!t.queries[0]) glGenQueries(GpuTimer::kQueries, t.queries);
+    if (t.issued[t.next]) {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(t.queries[t.next], GL_QUERY_RESULT, &ns);
+        float ms = (float)(ns * 1e-6);
+        t.ms = (t.ms == 0.0f) ? ms : 0.9f * t.ms + 0.1f * ms;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, t.queries[t.next]);
+}
+
+static void endGpuTimer(GpuTimer& t) {
+    glEndQuery(GL_TIME_ELAPSED);
+    t.issued[t.next] = true;
+    t.next = (t.next + 1) % GpuTimer::kQueries;
+}
+
 // -------------------- screen quad for postprocess --------------------
 static GLuint quadVAO = 0;
 static void initQuad() {
@@ -211,6 +1285,13 @@ string loadShaderText(const string& name) {
     return s;
 }
 
+// Shader variant: "#define name" right after the #version line.
+static string withDefine(const string& src, const char* name) {
+    size_t eol = src.find('\n');
+    if (eol == string::npos) return src;
+    return src.substr(0, eol + 1) + "#define " + name + "\n" + src.substr(eol + 1);
+}
+
 // -------------------- main --------------------
 int SCR_W = 2560, SCR_H = 1440;
 
@@ -222,9 +1303,13 @@ const float walkAxis = 0.0f;     // 行走高度（Y轴，避免模型贴地或
 Camera camera;
 float lastFrame = 0.0f;
 bool keys[1024];
+bool zPrepass = true;   // Z toggles; the PBR pass then shades each pixel once
+bool triangleStrips = false;   // T toggles; the model is re-imported as strips or lists to compare
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) glfwSetWindowShouldClose(window, 1);
+    if (key == GLFW_KEY_Z && action == GLFW_PRESS) zPrepass = !zPrepass;
+    if (key == GLFW_KEY_T && action == GLFW_PRESS) triangleStrips = !triangleStrips;
     if (key >= 0 && key < 1024) {
         if (action == GLFW_PRESS) keys[key] = true;
         else if (action == GLFW_RELEASE) keys[key] = false;
@@ -321,6 +1406,9 @@ int main() {
 
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
+    // strip meshes rely on it; the index is set per index type at draw time (restartIndex).
+    // GL_PRIMITIVE_RESTART_FIXED_INDEX would do both but needs GL 4.3
+    glEnable(GL_PRIMITIVE_RESTART);
 
     // callbacks
     glfwSetKeyCallback(window, key_callback);
@@ -331,47 +1419,86 @@ int main() {
     // load shaders from files
     string pbr_vs = loadShaderText("pbr.vs");
     string pbr_fs = loadShaderText("pbr.fs");
+    string depth_vs = loadShaderText("depth.vs");
+    string depth_fs = loadShaderText("depth.fs");
     string quad_vs = loadShaderText("quad.vs");
     string bright_fs = loadShaderText("bright_extract.fs");
     string blur_fs = loadShaderText("gaussian_blur.fs");
     string combine_fs = loadShaderText("bloom_combine.fs");
+    string feedback_fs = loadShaderText("vt_feedback.fs");
 
+    if (kPackOrmMaps) pbr_fs = withDefine(pbr_fs, "PACKED_ORM");
     GLuint pbrProg = createProgram(pbr_vs.c_str(), pbr_fs.c_str());
+    GLuint depthProg = createProgram(depth_vs.c_str(), depth_fs.c_str());
+    GLuint feedbackProg = createProgram(pbr_vs.c_str(), feedback_fs.c_str());
     GLuint brightProg = createProgram(quad_vs.c_str(), bright_fs.c_str());
     GLuint blurProg = createProgram(quad_vs.c_str(), blur_fs.c_str());
     GLuint combineProg = createProgram(quad_vs.c_str(), combine_fs.c_str());
 
-    // load model (replace with your model path)
+    // default textures (if missing, create 1x1 white); materials fall back to these
+    MaterialTable materials;
+    {
+        unsigned char texels[2][3] = { { 255,255,255 }, { 128,128,255 } };
+        GLuint* targets[2] = { &materials.white, &materials.flatNormal };
+        for (int i = 0; i < 2; i++) {
+            glGenTextures(1, targets[i]); glBindTexture(GL_TEXTURE_2D, *targets[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, texels[i]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+    }
+    const char* defaultTextures[kMaterialTextureCount] = { "resources/albedo.png", "resources/normal.png", "resources/metallic.png",
+                                                           "resources/roughness.png", "resources/ao.png" };
+    // everything below loads in the background; the first frame does not wait for it
+    double startTime = glfwGetTime();
+    AssetStreamer streamer;
+    chooseTextureCodecs(streamer);
+    for (int t = 0; t < kMaterialTextureCount; t++) {
+        materials.defaultPaths[t] = defaultTextures[t];
+        if (kPackOrmMaps && isOrmSlot(t)) continue;   // only ever read through packed textures
+        materials.defaults[t] = requestTexture(streamer, materials, defaultTextures[t], t, true);
+    }
+
+    // load model (replace with your model path); a grey box of its bounds stands in until it is uploaded
+    const char* modelPath = "resources/model.obj";
+    MeshImportOptions modelOpt;
+    modelOpt.triangleStrips = triangleStrips;
     Mesh mesh;
-    bool ok = loadObjToMesh("resources/model.obj", mesh);
-    if (!ok) { cerr << "Failed to load model.obj\n"; /* still continue to show something */ }
-
-    // default textures (if missing, create 1x1 white)
-    GLuint texAlbedo = loadTexture("resources/albedo.png");
-    if (!texAlbedo) {
-        unsigned char white[3] = { 255,255,255 };
-        glGenTextures(1, &texAlbedo); glBindTexture(GL_TEXTURE_2D, texAlbedo);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, white);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    }
-    GLuint texNormal = loadTexture("resources/normal.png");
-    GLuint texMetallic = loadTexture("resources/metallic.png");
-    GLuint texRoughness = loadTexture("resources/roughness.png");
-    GLuint texAO = loadTexture("resources/ao.png");
+    requestMesh(streamer, modelPath, mesh, VertexFormatCompactSplit, modelOpt);
+    Mesh proxy;
+    {
+        GpuMaterial grey;
+        for (int t = 0; t < kMaterialTextureCount; t++) grey.textures[t] = materials.white;
+        grey.textures[MaterialNormal] = materials.flatNormal;
+        grey.baseColor = glm::vec3(0.5f);
+        grey.metallic = 0.0f;
+        grey.roughness = 0.8f;
+        materials.materials.push_back(grey);
+        uploadMeshNow(makeBoxPayload(), proxy, vector<uint32_t>(1, (uint32_t)materials.materials.size() - 1));
+    }
 
     // screen quad
     initQuad();
 
     // build bloom FBOs
     bloomFBO.init(SCR_W, SCR_H);
+    initVirtualFeedback(streamer.virtualTextures, SCR_W / kVirtualFeedbackScale, SCR_H / kVirtualFeedbackScale);
 
     // default uniforms binding
     glUseProgram(pbrProg);
     glUniform1i(glGetUniformLocation(pbrProg, "albedoMap"), 0);
     glUniform1i(glGetUniformLocation(pbrProg, "normalMap"), 1);
     glUniform1i(glGetUniformLocation(pbrProg, "metallicMap"), 2);
+    glUniform1i(glGetUniformLocation(pbrProg, "ormMap"), 2);   // PACKED_ORM
     glUniform1i(glGetUniformLocation(pbrProg, "roughnessMap"), 3);
     glUniform1i(glGetUniformLocation(pbrProg, "aoMap"), 4);
+    glUniform1i(glGetUniformLocation(pbrProg, "vtAtlas"), 5);
+    glUniform1i(glGetUniformLocation(pbrProg, "vtPageTable"), 6);
+    glUniform3f(glGetUniformLocation(pbrProg, "vtTile"), (float)kVirtualTileSize, (float)kVirtualTileBorder, (float)kVirtualTileStride);
+    float atlasTexel = 1.0f / (kVirtualAtlasSlots * kVirtualTileStride);
+    glUniform2f(glGetUniformLocation(pbrProg, "vtAtlasTexel"), atlasTexel, atlasTexel);
+    glUseProgram(feedbackProg);
+    glUniform1f(glGetUniformLocation(feedbackProg, "vtTileSize"), (float)kVirtualTileSize);
+    glUniform1f(glGetUniformLocation(feedbackProg, "lodBias"), log2f((float)kVirtualFeedbackScale));
 
     glUseProgram(brightProg); glUniform1i(glGetUniformLocation(brightProg, "scene"), 0);
     glUseProgram(blurProg); glUniform1i(glGetUniformLocation(blurProg, "image"), 0);
@@ -380,8 +1507,29 @@ int main() {
 
     // time loop
     float time = 0.0f;
+    ClusterDrawList clusterList;
+    vector<DrawItem> drawItems;
+    vector<MeshInstance> instances;
+    ObjectBoundsSoA instanceBounds;
+    vector<uint32_t> visibleInstances;
+    float lastTitleUpdate = 0.0f;
+    size_t frameCount = 0;
+    float lastReloadCheck = 0.0f;
+    GpuTimer sceneTimer;
     while (!glfwWindowShouldClose(window)) {
         float currentFrame = (float)glfwGetTime();
+        bool wasReady = mesh.ready;
+        if (triangleStrips != modelOpt.triangleStrips) {
+            // the current buffers keep drawing until the other index mode is uploaded
+            modelOpt.triangleStrips = triangleStrips;
+            requestMesh(streamer, modelPath, mesh, VertexFormatCompactSplit, modelOpt);
+        }
+        if (currentFrame - lastReloadCheck > 0.5f) {
+            lastReloadCheck = currentFrame;
+            reloadChangedMeshes(streamer);
+        }
+        size_t loading = pumpAssets(streamer, materials);
+        if (!wasReady && mesh.ready) cout << "model ready after " << (glfwGetTime() - startTime) * 1000.0 << " ms\n";
         float delta = currentFrame - lastFrame;
         lastFrame = currentFrame;
         processKeyboard(delta);
@@ -390,6 +1538,7 @@ int main() {
         // 1. render scene into floating point framebuffer (HDR)
         glBindFramebuffer(GL_FRAMEBUFFER, bloomFBO.hdrFBO);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        beginGpuTimer(sceneTimer);
         // set viewport
         glViewport(0, 0, SCR_W, SCR_H);
 
@@ -413,7 +1562,6 @@ int main() {
         // uniforms
         glUniformMatrix4fv(glGetUniformLocation(pbrProg, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
         glUniformMatrix4fv(glGetUniformLocation(pbrProg, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(pbrProg, "model"), 1, GL_FALSE, glm::value_ptr(model_m));
         glUniform3fv(glGetUniformLocation(pbrProg, "camPos"), 1, glm::value_ptr(camera.pos));
         glUniform1f(glGetUniformLocation(pbrProg, "time"), time);
 
@@ -427,21 +1575,43 @@ int main() {
         glUniform3fv(glGetUniformLocation(pbrProg, "lightPosB"), 1, glm::value_ptr(lightPosB));
         glUniform3fv(glGetUniformLocation(pbrProg, "lightColorB"), 1, glm::value_ptr(lightColB));
 
-        // bind textures
-        glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, texAlbedo);
-        glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_2D, texNormal ? texNormal : texAlbedo);
-        glActiveTexture(GL_TEXTURE2); glBindTexture(GL_TEXTURE_2D, texMetallic ? texMetallic : texAlbedo);
-        glActiveTexture(GL_TEXTURE3); glBindTexture(GL_TEXTURE_2D, texRoughness ? texRoughness : texAlbedo);
-        glActiveTexture(GL_TEXTURE4); glBindTexture(GL_TEXTURE_2D, texAO ? texAO : texAlbedo);
-
-        if (mesh.vao) {
-            glBindVertexArray(mesh.vao);
-            glDrawElements(GL_TRIANGLES, mesh.count, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
+        // cull instances against the frustum, queue the submeshes of the visible ones,
+        // then draw them sorted by program / material / depth
+        instances.clear();
+        if (mesh.ready) { MeshInstance inst; inst.mesh = &mesh; inst.model = model_m; instances.push_back(inst); }
+        else if (mesh.radius > 0.0f) {
+            MeshInstance inst;
+            inst.mesh = &proxy;
+            inst.model = glm::scale(glm::translate(model_m, 0.5f * (mesh.boxMin + mesh.boxMax)), 0.5f * (mesh.boxMax - mesh.boxMin));
+            instances.push_back(inst);
         }
-        else {
-            // fallback: draw a simple cube using immediate mode fallback (not ideal)
+        cullInstances(instances, proj * view, instanceBounds, visibleInstances);
+        for (uint32_t i : visibleInstances)
+            queueMesh(*instances[i].mesh, pbrProg, instances[i].model, view, camera, SCR_H, drawItems);
+        // virtual textures: which tiles this frame samples, from a small rendering of the same queue
+        if (!streamer.virtualTextures.textures.empty()) {
+            glUseProgram(feedbackProg);
+            glUniformMatrix4fv(glGetUniformLocation(feedbackProg, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+            glUniformMatrix4fv(glGetUniformLocation(feedbackProg, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            runVirtualFeedback(streamer, drawItems, materials, feedbackProg, proj * view, camera.pos, clusterList);
+            glBindFramebuffer(GL_FRAMEBUFFER, bloomFBO.hdrFBO);
+            glViewport(0, 0, SCR_W, SCR_H);
         }
+        if (zPrepass) {
+            glUseProgram(depthProg);
+            glUniformMatrix4fv(glGetUniformLocation(depthProg, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+            glUniformMatrix4fv(glGetUniformLocation(depthProg, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            submitDepthDraws(drawItems, depthProg, proj * view, camera.pos, clusterList);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            // depth is final: only the front surface passes, nothing left to write
+            glDepthFunc(GL_LEQUAL);
+            glDepthMask(GL_FALSE);
+        }
+        submitDraws(drawItems, materials, streamer.virtualTextures, proj * view, camera.pos, clusterList);
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+        endGpuTimer(sceneTimer);
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
@@ -486,8 +1656,29 @@ int main() {
         glBindVertexArray(quadVAO);
         glDrawArrays(GL_TRIANGLES, 0, 6);
 
+        // cluster culling result in the title, twice a second
+        if (currentFrame - lastTitleUpdate > 0.5f) {
+            lastTitleUpdate = currentFrame;
+            const ClusterCullStats& cs = clusterList.stats;
+            string title = "PBR + Bloom + Model + Camera (GLAD+GLFW) | objects " + to_string(visibleInstances.size()) + "/" + to_string(instances.size())
+                         + ", clusters " + to_string(cs.total - cs.frustumCulled - cs.backfaceCulled)
+                         + "/" + to_string(cs.total) + " (frustum -" + to_string(cs.frustumCulled) + ", backface -" + to_string(cs.backfaceCulled) + ")";
+            title += zPrepass ? " | z-prepass" : "";
+            ostringstream scene;
+            scene.setf(ios::fixed);
+            scene.precision(2);
+            scene << " | scene " << sceneTimer.ms << " ms, " << (mesh.primitive == GL_TRIANGLE_STRIP ? "strips" : "lists");
+            title += scene.str();
+            if (loading) title += " | loading " + to_string(loading);
+            const VirtualTextures& vt = streamer.virtualTextures;
+            if (!vt.textures.empty())
+                title += " | virtual tiles " + to_string(vt.residency.residentCount()) + "/" + to_string(kVirtualAtlasSlots * kVirtualAtlasSlots);
+            glfwSetWindowTitle(window, title.c_str());
+        }
+
         // swap
         glfwSwapBuffers(window);
+        if (frameCount++ == 0) cout << "first frame after " << (glfwGetTime() - startTime) * 1000.0 << " ms\n";
         glfwPollEvents();
     }
 
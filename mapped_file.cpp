@@ -0,0 +1,115 @@
+// mapped_file.cpp
+
+#include "mapped_file.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// -------------------- memory mapping --------------------
+MappedFile& MappedFile::operator=(MappedFile&& o) {
+    if (this == &o) return *this;
+    close();
+    ptr = o.ptr; length = o.length; opened = o.opened;
+#ifdef _WIN32
+    fileHandle = o.fileHandle; mappingHandle = o.mappingHandle;
+    o.fileHandle = nullptr; o.mappingHandle = nullptr;
+#endif
+    o.ptr = nullptr; o.length = 0; o.opened = false;
+    return *this;
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const string& path) {
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) { CloseHandle(file); return false; }
+    fileHandle = file;
+    opened = true;
+    length = (size_t)size.QuadPart;
+    if (length == 0) return true;   // empty files cannot be mapped
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) { close(); return false; }
+    mappingHandle = mapping;
+    ptr = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!ptr) { close(); return false; }
+    return true;
+}
+
+void MappedFile::close() {
+    if (ptr) UnmapViewOfFile(ptr);
+    if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+    if (fileHandle) CloseHandle((HANDLE)fileHandle);
+    ptr = nullptr; mappingHandle = nullptr; fileHandle = nullptr;
+    length = 0; opened = false;
+}
+#else
+bool MappedFile::open(const string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) { ::close(fd); return false; }
+    length = (size_t)st.st_size;
+    opened = true;
+    if (length > 0) {
+        void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) { ::close(fd); length = 0; opened = false; return false; }
+        madvise(p, length, MADV_SEQUENTIAL);
+        ptr = (const char*)p;
+    }
+    ::close(fd);   // the mapping keeps its own reference
+    return true;
+}
+
+void MappedFile::close() {
+    if (ptr) munmap((void*)ptr, length);
+    ptr = nullptr; length = 0; opened = false;
+}
+#endif
+
+// -------------------- content hash --------------------
+// 8 bytes per step with a multiply-xorshift mix; fast enough to hash a large OBJ on every startup.
+static inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33; h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33; h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = seed ^ (size * 0x9E3779B97F4A7C15ull);
+    // four independent lanes keep the multiplies pipelined
+    uint64_t lane[4] = { h, h + 1, h + 2, h + 3 };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int k = 0; k < 4; k++) {
+            uint64_t w; memcpy(&w, p + i + 8 * k, 8);
+            lane[k] = (lane[k] ^ w) * 0x9E3779B97F4A7C15ull;
+            lane[k] ^= lane[k] >> 29;
+        }
+    }
+    h = mix64(lane[0]) ^ mix64(lane[1] + 0x1234567ull) ^ mix64(lane[2] + 0x89ABCDEull) ^ mix64(lane[3] + 0xFEDCBAull);
+    for (; i + 8 <= size; i += 8) {
+        uint64_t w; memcpy(&w, p + i, 8);
+        h = mix64(h ^ w);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + i, size - i);
+    return mix64(h ^ tail ^ (uint64_t)(size - i) << 56);
+}
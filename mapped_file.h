@@ -0,0 +1,36 @@
+// mapped_file.h
+// Read-only memory-mapped files (Win32 file mapping / POSIX mmap) and a fast 64-bit content hash.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+struct MappedFile {
+    MappedFile() {}
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& o) { *this = std::move(o); }
+    MappedFile& operator=(MappedFile&& o);
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return opened; }
+    const char* data() const { return ptr; }
+    size_t size() const { return length; }
+
+private:
+    const char* ptr = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// 64-bit non-cryptographic hash, used to key caches on file contents.
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
@@ -0,0 +1,27 @@
+// material.h
+// Material table entry as imported from an MTL file (including the PBR extension keys Pm/Pr,
+// map_Pm/map_Pr and norm). Plain data with fixed-size strings so it can live in the mesh cache.
+
+#pragma once
+
+const int kMaterialNameMax = 64;    // including the terminating zero; longer names are truncated
+const int kMaterialPathMax = 192;
+
+// texture slots, also the texture units bound by the PBR shader
+enum MaterialTexture {
+    MaterialAlbedo,      // map_Kd
+    MaterialNormal,      // norm, else map_Bump / bump
+    MaterialMetallic,    // map_Pm
+    MaterialRoughness,   // map_Pr
+    MaterialAO,          // map_Ka
+    kMaterialTextureCount
+};
+
+struct MeshMaterial {
+    char name[kMaterialNameMax] = {};
+    float baseColor[3] = { 1, 1, 1 };   // Kd
+    float metallic = 0.0f;              // Pm
+    float roughness = 0.5f;             // Pr
+    // relative to the OBJ directory; empty = not set
+    char textures[kMaterialTextureCount][kMaterialPathMax] = {};
+};
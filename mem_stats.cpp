@@ -0,0 +1,77 @@
+// mem_stats.cpp
+
+#include "mem_stats.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif
+
+// -------------------- allocation counters --------------------
+static std::atomic<size_t> allocationCount(0), allocationBytes(0);
+
+AllocationCounters allocationCounters() {
+    AllocationCounters c;
+    c.count = allocationCount.load(std::memory_order_relaxed);
+    c.bytes = allocationBytes.load(std::memory_order_relaxed);
+    return c;
+}
+
+void countAllocation(size_t bytes) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+// -------------------- Windows --------------------
+#ifdef _WIN32
+size_t currentRssBytes() {
+    PROCESS_MEMORY_COUNTERS pmc;
+    return GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) ? (size_t)pmc.WorkingSetSize : 0;
+}
+
+size_t peakRssBytes() {
+    PROCESS_MEMORY_COUNTERS pmc;
+    return GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) ? (size_t)pmc.PeakWorkingSetSize : 0;
+}
+
+bool resetPeakRss() {
+    return false;
+}
+
+// -------------------- Linux (/proc) --------------------
+#else
+static size_t readStatusKb(const char* field) {
+    FILE* f = fopen("/proc/self/status", "r");
+    if (!f) return 0;
+    char line[256];
+    size_t kb = 0, n = strlen(field);
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, field, n) == 0) { sscanf(line + n, " %zu", &kb); break; }
+    }
+    fclose(f);
+    return kb;
+}
+
+size_t currentRssBytes() {
+    return readStatusKb("VmRSS:") * 1024;
+}
+
+size_t peakRssBytes() {
+    return readStatusKb("VmHWM:") * 1024;
+}
+
+bool resetPeakRss() {
+    // "5" resets the peak RSS counter (Linux >= 4.0)
+    FILE* f = fopen("/proc/self/clear_refs", "w");
+    if (!f) return false;
+    bool ok = fputs("5", f) >= 0;
+    return fclose(f) == 0 && ok;
+}
+#endif
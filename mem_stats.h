@@ -0,0 +1,25 @@
+// mem_stats.h
+// Process memory figures for import reports and benchmarks.
+
+#pragma once
+
+#include <cstddef>
+
+// Resident set size of the process in bytes (0 if unavailable).
+size_t currentRssBytes();
+
+// High-water mark of the resident set size in bytes (0 if unavailable).
+size_t peakRssBytes();
+
+// Reset the high-water mark to the current RSS where the OS allows it (Linux);
+// returns false when peakRssBytes() keeps counting from process start.
+bool resetPeakRss();
+
+// Heap allocation totals since process start. They only move in programs whose global operator new
+// calls countAllocation (mesh_bench does); elsewhere they stay 0.
+struct AllocationCounters {
+    size_t count = 0;
+    size_t bytes = 0;
+};
+AllocationCounters allocationCounters();
+void countAllocation(size_t bytes);
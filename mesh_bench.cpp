@@ -0,0 +1,542 @@
+// mesh_bench.cpp
+// Standalone mesh import benchmark (no GL context needed).
+// Compares tinyobj::LoadObj against parseObjParallel on the given OBJ files and on generated grids.
+//
+// usage: mesh_bench [--tris N]... [--threads N] [--import full|stream] [--stages [--strips] [--json out.json]] [--codec]
+//                   [file.obj]...
+//   no arguments: resources/model.obj plus a synthetic 10M-triangle OBJ
+//   --import: run importObj in that mode instead of the parser comparison and report its peak
+//             RSS (one mode per process, memory freed by an earlier run stays resident)
+//   --stages: run the full default importObj pipeline and write time, MB/s, triangles/s, peak RSS
+//             and allocations of every stage as JSON (default mesh_bench_stages.json); without
+//             inputs: resources/model.obj plus synthetic OBJs from 10k to 20M triangles
+//   --strips: with --stages, also convert to triangle strips (adds the "strips" stage)
+//   --codec:  import, write the mesh package next to the OBJ (mesh_codec.h) and report its size,
+//             decode speed against memcpy of the decoded bytes and the quantization error; built
+//             with zlib, also deflate -9 of the encoded vertices against deflate -9 of the raw ones
+//   --check:  only run the self-checks (BC1/BC4/BC5/BC7 and vertex codec round trips, texture
+//             registry reference counting); exit code 1 when one fails
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mem_stats.h"
+#include "mesh_codec.h"
+#include "mesh_import.h"
+#include "mesh_quantize.h"
+#include "obj_parser.h"
+#include "texture_compress.h"
+#include "texture_registry.h"
+
+// zlib is optional, only for the deflate comparison of --codec
+#if defined(__has_include)
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#define BENCH_ZLIB 1
+#ifdef _MSC_VER
+#pragma comment(lib, "zlib")
+#endif
+#endif
+#endif
+
+using namespace std;
+
+// -------------------- allocation counting --------------------
+// Every heap allocation of the process goes through here, so importObj can report them per stage.
+void* operator new(size_t size) {
+    countAllocation(size);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+// -------------------- synthetic input --------------------
+// A square grid of shared vertices with one v/vt/vn per grid point, two triangles per cell.
+static bool writeSyntheticObj(const string& path, size_t triangles) {
+    size_t n = 1;
+    while (2 * n * n < triangles) n++;
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) { cerr << "Failed to write: " << path << "\n"; return false; }
+    vector<char> buf(1 << 20);
+    setvbuf(f, buf.data(), _IOFBF, buf.size());
+    fprintf(f, "# synthetic grid, %zu triangles\no grid\n", 2 * n * n);
+    for (size_t j = 0; j <= n; j++)
+        for (size_t i = 0; i <= n; i++)
+            fprintf(f, "v %.6f %.6f %.6f\n", (double)i / n, 0.05 * sin(i * 0.3) * cos(j * 0.3), (double)j / n);
+    for (size_t j = 0; j <= n; j++)
+        for (size_t i = 0; i <= n; i++)
+            fprintf(f, "vt %.6f %.6f\n", (double)i / n, (double)j / n);
+    for (size_t j = 0; j <= n; j++)
+        for (size_t i = 0; i <= n; i++)
+            fprintf(f, "vn %.4f %.4f %.4f\n", 0.0, 1.0, 0.0);
+    for (size_t j = 0; j < n; j++) {
+        for (size_t i = 0; i < n; i++) {
+            size_t a = j * (n + 1) + i + 1, b = a + 1, c = a + n + 1, d = c + 1;
+            fprintf(f, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, c, c, c, b, b, b);
+            fprintf(f, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", b, b, b, c, c, c, d, d, d);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// -------------------- timing --------------------
+static double nowMs() {
+    return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t fileSize(const string& path) {
+    ifstream in(path, ios::binary | ios::ate);
+    return in ? (size_t)in.tellg() : 0;
+}
+
+struct ParseResult {
+    double ms = 0.0;
+    size_t vertices = 0, triangles = 0;
+    bool ok = false;
+};
+
+static ParseResult runParser(const string& path, bool parallel, unsigned threads) {
+    tinyobj::attrib_t attrib;
+    vector<tinyobj::shape_t> shapes;
+    vector<tinyobj::material_t> materials;
+    string warn, err;
+    string base = path.substr(0, path.find_last_of("/\\") + 1);
+    ParseResult r;
+    double t0 = nowMs();
+    r.ok = parallel ? parseObjParallel(path, attrib, shapes, materials, warn, err, base, threads)
+                    : tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), base.c_str());
+    r.ms = nowMs() - t0;
+    r.vertices = attrib.vertices.size() / 3;
+    for (auto& s : shapes) r.triangles += s.mesh.indices.size() / 3;
+    if (!err.empty()) cerr << "ERR: " << err << "\n";
+    return r;
+}
+
+static void benchParse(const string& path, unsigned threads) {
+    size_t bytes = fileSize(path);
+    double mb = bytes / (1024.0 * 1024.0);
+    // small inputs are repeated so the numbers are not dominated by timer noise
+    int reps = bytes < (16u << 20) ? 5 : 1;
+    ParseResult best[2];
+    for (int p = 0; p < 2; p++) {
+        for (int i = 0; i < reps; i++) {
+            ParseResult r = runParser(path, p == 1, threads);
+            if (i == 0 || r.ms < best[p].ms) best[p] = r;
+        }
+    }
+    cout << path << " (" << mb << " MB)\n";
+    const char* names[2] = { "tinyobj::LoadObj", "parseObjParallel" };
+    for (int p = 0; p < 2; p++) {
+        cout << "  " << names[p] << ": " << best[p].ms << " ms, " << mb / (best[p].ms / 1000.0) << " MB/s, "
+             << best[p].triangles / (best[p].ms / 1000.0) / 1e6 << " Mtri/s" << (best[p].ok ? "" : " (FAILED)") << "\n";
+    }
+    bool same = best[0].vertices == best[1].vertices && best[0].triangles == best[1].triangles;
+    cout << "  speedup " << best[0].ms / best[1].ms << "x, " << best[1].vertices << " vertices, "
+         << best[1].triangles << " triangles" << (same ? "" : " (COUNT MISMATCH)") << "\n";
+}
+
+// importObj prints the parse+weld peak RSS itself; optimization passes are skipped
+static void benchImport(const string& path, bool streaming) {
+    MeshImportOptions opt;
+    opt.streaming = streaming;
+    opt.optimizeVertexCache = opt.optimizeOverdraw = opt.optimizeVertexFetch = false;
+    MeshData mesh;
+    double t0 = nowMs();
+    bool ok = importObj(path, mesh, opt);
+    cout << "  " << (streaming ? "streaming" : "full") << " import: " << nowMs() - t0 << " ms"
+         << (ok ? "" : " (FAILED)") << "\n";
+}
+
+// -------------------- per-stage JSON --------------------
+static double perSecond(double amount, double ms) {
+    return ms > 0.0 ? amount / (ms / 1000.0) : 0.0;
+}
+
+// Imports path with opt and appends its JSON object to json.
+static bool benchStages(const string& path, const MeshImportOptions& opt, FILE* json, bool first) {
+    size_t bytes = fileSize(path);
+    MeshData mesh;
+    vector<MeshImportStage> stages;
+    double t0 = nowMs();
+    bool ok = importObj(path, mesh, opt, &stages);
+    double total = nowMs() - t0;
+    if (!ok) { cerr << "Failed to import: " << path << "\n"; return false; }
+    double mb = bytes / (1024.0 * 1024.0);
+    size_t triangles = mesh.triangleCount();
+    cout << path << ": " << total << " ms, " << perSecond(mb, total) << " MB/s, " << perSecond((double)triangles, total) / 1e6
+         << " Mtri/s, peak RSS " << peakRssBytes() / (1024.0 * 1024.0) << " MB\n";
+
+    fprintf(json, "%s\n    {\n      \"file\": \"%s\",\n      \"bytes\": %zu,\n      \"triangles\": %zu,\n      \"vertices\": %zu,\n"
+                  "      \"totalMs\": %.3f,\n      \"mbPerSec\": %.2f,\n      \"trianglesPerSec\": %.0f,\n      \"stages\": [",
+            first ? "" : ",", path.c_str(), bytes, triangles, mesh.vertexCount(), total, perSecond(mb, total),
+            perSecond((double)triangles, total));
+    for (size_t i = 0; i < stages.size(); i++) {
+        const MeshImportStage& s = stages[i];
+        fprintf(json, "%s\n        { \"name\": \"%s\", \"ms\": %.3f, \"mbPerSec\": %.2f, \"trianglesPerSec\": %.0f, "
+                      "\"peakRssBytes\": %zu, \"allocations\": %zu, \"allocatedBytes\": %zu }",
+                i ? "," : "", s.name, s.ms, perSecond(mb, s.ms), perSecond((double)triangles, s.ms), s.peakRssBytes,
+                s.allocations, s.allocatedBytes);
+    }
+    fprintf(json, "\n      ]\n    }");
+    return true;
+}
+
+// -------------------- mesh package codec --------------------
+// Best of repeated runs over at least 200 ms.
+template <typename F>
+static double bestMs(F&& f) {
+    double best = 1e30, start = nowMs();
+    do {
+        double t0 = nowMs();
+        f();
+        best = min(best, nowMs() - t0);
+    } while (nowMs() - start < 200.0);
+    return best;
+}
+
+static double gbPerSec(size_t bytes, double ms) {
+    return perSecond(bytes / 1e9, ms);
+}
+
+#if BENCH_ZLIB
+// size of data after deflate -9, 0 on failure
+static size_t deflatedSize(const void* data, size_t size) {
+    uLongf bytes = compressBound((uLong)size);
+    vector<unsigned char> out(bytes);
+    if (compress2(out.data(), &bytes, (const Bytef*)data, (uLong)size, 9) != Z_OK) return 0;
+    return bytes;
+}
+#endif
+
+static bool benchCodec(const string& path) {
+    MeshData mesh;
+    if (!importObj(path, mesh)) { cerr << "Failed to import: " << path << "\n"; return false; }
+    string packagePath = meshPackagePath(path);
+    if (!writeMeshPackage(packagePath, mesh)) return false;
+
+    vector<CompactVertex> compact;
+    PositionDequant dq = positionDequant(mesh.bounds);
+    quantizeVertices(mesh.vertices.data(), mesh.vertexCount(), dq, compact);
+    QuantizationError err = measureQuantizationError(mesh.vertices.data(), compact, dq);
+    vector<unsigned char> vertexData, indexData;
+    encodeVertexBuffer(compact.data(), compact.size(), sizeof(CompactVertex), kCompactDeltaWords, vertexData);
+    encodeIndexBuffer(mesh.indices.data(), mesh.indices.size(), indexData);
+    int indexSize = mesh.fitsShortIndices() ? 2 : 4;
+    size_t vertexBytes = compact.size() * sizeof(CompactVertex), indexBytes = mesh.indices.size() * indexSize;
+    vector<unsigned char> vertices(vertexBytes), indices(indexBytes), copy(vertexBytes);
+
+    bool ok = true;
+    double vertexMs = bestMs([&] { ok &= decodeVertexBuffer(vertices.data(), compact.size(), sizeof(CompactVertex), kCompactDeltaWords, vertexData.data(), vertexData.size()); });
+    double indexMs = bestMs([&] { ok &= decodeIndexBuffer(indices.data(), mesh.indices.size(), indexSize, indexData.data(), indexData.size()); });
+    double copyMs = bestMs([&] { memcpy(copy.data(), compact.data(), vertexBytes); });
+    ok = ok && memcmp(vertices.data(), compact.data(), vertexBytes) == 0;
+    for (size_t i = 0; ok && i < mesh.indices.size(); i++) {
+        uint32_t v = indexSize == 2 ? ((const uint16_t*)indices.data())[i] : ((const uint32_t*)indices.data())[i];
+        ok = v == (indexSize == 2 ? (uint16_t)mesh.indices[i] : mesh.indices[i]);
+    }
+    MeshPackage package;
+    double readMs = bestMs([&] { ok &= readMeshPackage(packagePath, package); });
+
+    const double mb = 1024.0 * 1024.0;
+    size_t packageBytes = fileSize(packagePath);
+    cout << path << ": OBJ " << fileSize(path) / mb << " MB, package " << packageBytes / mb << " MB ("
+         << (double)fileSize(path) / max(packageBytes, (size_t)1) << "x smaller), round trip " << (ok ? "exact" : "MISMATCH") << "\n";
+    cout << "  vertices: " << compact.size() << " x " << sizeof(CompactVertex) << " B = " << vertexBytes / mb << " MB -> "
+         << vertexData.size() / mb << " MB (" << 100.0 * vertexData.size() / max(vertexBytes, (size_t)1) << "%), decode "
+         << gbPerSec(vertexBytes, vertexMs) << " GB/s (memcpy " << gbPerSec(vertexBytes, copyMs) << " GB/s)\n";
+#if BENCH_ZLIB
+    // the encoding is also meant to help a general-purpose compressor on top, not to work against it
+    size_t rawDeflated = deflatedSize(compact.data(), vertexBytes), encodedDeflated = deflatedSize(vertexData.data(), vertexData.size());
+    cout << "  deflate -9: raw vertices " << rawDeflated / mb << " MB, encoded " << encodedDeflated / mb << " MB ("
+         << 100.0 * encodedDeflated / max(rawDeflated, (size_t)1) << "% of raw)"
+         << (encodedDeflated > rawDeflated ? ", WORSE than deflating the raw vertices" : "") << "\n";
+#else
+    cout << "  deflate comparison skipped: built without zlib\n";
+#endif
+    cout << "  quantization error: position max " << err.maxPosition << " mean " << err.meanPosition << ", normal max "
+         << err.maxNormalDeg << " mean " << err.meanNormalDeg << " deg, tangent max " << err.maxTangentDeg << " mean "
+         << err.meanTangentDeg << " deg (" << err.tangentSignErrors << " sign errors), uv max " << err.maxUv << "\n";
+    cout << "  indices: " << mesh.indices.size() << " x " << indexSize << " B = " << indexBytes / mb << " MB -> "
+         << indexData.size() / mb << " MB (" << (double)indexData.size() / max(mesh.triangleCount(), (size_t)1)
+         << " B/triangle), decode " << gbPerSec(indexBytes, indexMs) << " GB/s\n";
+    cout << "  readMeshPackage: " << readMs << " ms, wrote " << packagePath << "\n";
+    return ok;
+}
+
+// -------------------- self-checks --------------------
+// The BC blocks are decoded by minimal decoders written from the format description, separate from
+// the encoders, so a bit layout error on both sides does not cancel out.
+static int checkFailures = 0;
+
+static void check(bool ok, const string& what) {
+    if (ok) return;
+    cerr << "check failed: " << what << "\n";
+    checkFailures++;
+}
+
+static void expand565(uint16_t c, int* rgb) {
+    int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = r << 3 | r >> 2;
+    rgb[1] = g << 2 | g >> 4;
+    rgb[2] = b << 3 | b >> 2;
+}
+
+static void decodeBC1(const unsigned char* block, unsigned char* rgba) {
+    uint16_t c0 = (uint16_t)(block[0] | block[1] << 8), c1 = (uint16_t)(block[2] | block[3] << 8);
+    int palette[4][4];
+    expand565(c0, palette[0]);
+    expand565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = c0 > c1 ? (2 * palette[0][c] + palette[1][c]) / 3 : (palette[0][c] + palette[1][c]) / 2;
+        palette[3][c] = c0 > c1 ? (palette[0][c] + 2 * palette[1][c]) / 3 : 0;
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = c0 > c1 ? 255 : 0;
+    uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | (uint32_t)block[7] << 24;
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++) rgba[4 * i + c] = (unsigned char)palette[(indices >> (2 * i)) & 3][c];
+}
+
+// one channel into every step-th byte of out
+static void decodeBC4(const unsigned char* block, unsigned char* out, int step) {
+    int a = block[0], b = block[1], palette[8] = { a, b };
+    if (a > b)
+        for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a + i * b) / 7;
+    else {
+        for (int i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a + i * b) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) indices |= (uint64_t)block[2 + i] << (8 * i);
+    for (int i = 0; i < 16; i++) out[i * step] = (unsigned char)palette[(indices >> (3 * i)) & 7];
+}
+
+// false for modes other than 6, the only one the encoder writes
+static bool decodeBC7(const unsigned char* block, unsigned char* rgba) {
+    static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    int pos = 0;
+    auto bits = [&](int count) {
+        int v = 0;
+        for (int k = 0; k < count; k++, pos++) v |= ((block[pos / 8] >> (pos % 8)) & 1) << k;
+        return v;
+    };
+    if (bits(7) != 1 << 6) return false;
+    int e[2][4];
+    for (int c = 0; c < 4; c++) {
+        e[0][c] = bits(7) << 1;
+        e[1][c] = bits(7) << 1;
+    }
+    int p0 = bits(1), p1 = bits(1);
+    for (int c = 0; c < 4; c++) {
+        e[0][c] |= p0;
+        e[1][c] |= p1;
+    }
+    for (int i = 0; i < 16; i++) {
+        int w = weights[bits(i == 0 ? 3 : 4)];   // the anchor index drops its high bit
+        for (int c = 0; c < 4; c++) rgba[4 * i + c] = (unsigned char)(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+    }
+    return true;
+}
+
+// Solid, gradient and two-colour 4x4 blocks, the kinds every BC format represents closely.
+static void testBlock(unsigned kind, uint32_t& seed, unsigned char* rgba) {
+    auto next = [&]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+    unsigned char a[4], b[4];
+    for (int c = 0; c < 4; c++) {
+        a[c] = (unsigned char)next();
+        b[c] = (unsigned char)next();
+    }
+    int dx = (int)(next() % 3), dy = (int)(next() % 3);
+    for (int i = 0; i < 16; i++) {
+        int t = kind == 0 ? 0 : kind == 1 ? (dx * (i % 4) + dy * (i / 4)) * 255 / max(3 * (dx + dy), 1) : (next() & 1) * 255;
+        for (int c = 0; c < 4; c++) rgba[4 * i + c] = (unsigned char)((a[c] * (255 - t) + b[c] * t + 127) / 255);
+    }
+}
+
+static void checkBlockCodecs() {
+    // worst channel error allowed per codec over the test blocks: half a palette step of a full-range
+    // gradient (4, 8, 8 and 16 entries) plus endpoint rounding, and for BC1 the 1/16 endpoint inset
+    const int maxError[4] = { 48, 20, 20, 12 };   // BC1, BC4, BC5, BC7
+    const char* names[4] = { "BC1", "BC4", "BC5", "BC7" };
+    int worst[4] = {};
+    uint32_t seed = 1;
+    for (int n = 0; n < 3000; n++) {
+        unsigned char src[64], block[16], out[64];
+        testBlock(n % 3, seed, src);
+        for (int codec = 0; codec < 4; codec++) {
+            int channels = codec == 0 ? 3 : codec == 1 ? 1 : codec == 2 ? 2 : 4;
+            memcpy(out, src, sizeof(out));
+            if (codec == 0) {
+                encodeBlockBC1(src, block);
+                decodeBC1(block, out);
+            }
+            else if (codec == 1) {
+                encodeBlockBC4(src, 0, block);
+                decodeBC4(block, out, 4);
+            }
+            else if (codec == 2) {
+                encodeBlockBC5(src, block);
+                decodeBC4(block, out, 4);
+                decodeBC4(block + 8, out + 1, 4);
+            }
+            else {
+                encodeBlockBC7(src, block);
+                check(decodeBC7(block, out), "BC7 block is mode 6");
+            }
+            for (int i = 0; i < 16; i++)
+                for (int c = 0; c < channels; c++) worst[codec] = max(worst[codec], abs(out[4 * i + c] - src[4 * i + c]));
+        }
+    }
+    for (int codec = 0; codec < 4; codec++) {
+        cout << "  " << names[codec] << " round trip: max error " << worst[codec] << "\n";
+        check(worst[codec] <= maxError[codec], string(names[codec]) + " round trip error " + to_string(worst[codec]));
+    }
+}
+
+static void checkVertexCodec() {
+    uint32_t seed = 7;
+    auto next = [&]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+    for (int n = 0; n < 200; n++) {
+        size_t stride = 4 * (1 + next() % 16), count = next() % 1000;
+        uint32_t deltaWords = next() | next() << 24;
+        vector<unsigned char> src(count * stride), encoded, out(count * stride);
+        // smooth ramps, repeats and noise, so coded and raw blocks both occur
+        unsigned mode = next() % 3;
+        for (size_t i = 0; i < src.size(); i++)
+            src[i] = (unsigned char)(mode == 0 ? next() : mode == 1 ? i / stride + i % stride : (i / stride / 6) * 31 + i % stride);
+        encodeVertexBuffer(src.data(), count, stride, deltaWords, encoded);
+        bool ok = decodeVertexBuffer(out.data(), count, stride, deltaWords, encoded.data(), encoded.size()) && out == src;
+        check(ok, "vertex codec round trip, stride " + to_string(stride) + ", " + to_string(count) + " vertices");
+        if (!encoded.empty())
+            check(!decodeVertexBuffer(out.data(), count, stride, deltaWords, encoded.data(), encoded.size() - 1), "vertex codec rejects truncated data");
+    }
+}
+
+static void checkTextureRegistry() {
+    TextureRegistry reg;
+    uint32_t t = 0;
+    uint64_t hash = 0;
+    check(!reg.acquire("a", t), "registry: unknown key");
+    reg.add("a", 1);
+    check(reg.acquire("a", t) && t == 1 && reg.refs(1) == 2, "registry: acquire adds a reference");
+    reg.add("b", 2);
+    check(reg.setContent(1, 100) == 0 && reg.setContent(2, 100) == 1, "registry: same content finds the first texture");
+    reg.merge(2, 1);
+    check(reg.refs(1) == 3 && reg.refs(2) == 0 && reg.size() == 1, "registry: merge moves the references");
+    check(reg.acquire("b", t) && t == 1 && reg.refs(1) == 4, "registry: merged key names the target");
+    reg.addRef(7);
+    check(!reg.release(7), "registry: textures outside it are ignored");
+    bool last = false;
+    for (int i = 0; i < 4; i++) {
+        check(!last, "registry: released before the last reference");
+        last = reg.release(1, &hash);
+    }
+    check(last && hash == 100 && reg.size() == 0 && reg.findContent(100) == 0, "registry: last release frees the entry and content");
+    check(!reg.acquire("a", t) && !reg.acquire("b", t), "registry: released keys are forgotten");
+    reg.add("c", 3);
+    reg.setContent(3, 200);
+    reg.fail(3);
+    check(reg.acquire("c", t) && t == 0 && reg.findContent(200) == 0 && reg.size() == 0, "registry: failed loads stay known as failed");
+}
+
+static int runChecks() {
+    checkBlockCodecs();
+    checkVertexCodec();
+    checkTextureRegistry();
+    cout << (checkFailures ? to_string(checkFailures) + " checks failed" : string("all checks passed")) << "\n";
+    return checkFailures ? 1 : 0;
+}
+
+// -------------------- main --------------------
+int main(int argc, char** argv) {
+    vector<string> files;
+    vector<size_t> synthetic;
+    unsigned threads = 0;
+    string import;   // "", "full" or "stream"
+    bool stages = false;
+    bool codec = false;
+    MeshImportOptions stageOpt;
+    string jsonPath = "mesh_bench_stages.json";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--tris") && i + 1 < argc) synthetic.push_back((size_t)atof(argv[++i]));
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--import") && i + 1 < argc) import = argv[++i];
+        else if (!strcmp(argv[i], "--stages")) stages = true;
+        else if (!strcmp(argv[i], "--strips")) stageOpt.triangleStrips = true;
+        else if (!strcmp(argv[i], "--codec")) codec = true;
+        else if (!strcmp(argv[i], "--check")) return runChecks();
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc) jsonPath = argv[++i];
+        else files.push_back(argv[i]);
+    }
+    if (files.empty() && synthetic.empty()) {
+        files.push_back("resources/model.obj");
+        if (stages) synthetic = { 10000, 100000, 1000000, 10000000, 20000000 };
+        else synthetic.push_back(10000000);
+    }
+
+    if (stages) {
+        FILE* json = fopen(jsonPath.c_str(), "w");
+        if (!json) { cerr << "Failed to write: " << jsonPath << "\n"; return 1; }
+        fprintf(json, "{\n  \"hardwareThreads\": %u,\n  \"inputs\": [", thread::hardware_concurrency());
+        bool first = true;
+        for (auto& f : files)
+            if (benchStages(f, stageOpt, json, first)) first = false;
+        for (size_t tris : synthetic) {
+            string path = "bench_synthetic_" + to_string(tris) + ".obj";
+            cout << "generating " << path << "...\n";
+            if (!writeSyntheticObj(path, tris)) continue;
+            if (benchStages(path, stageOpt, json, first)) first = false;
+            remove(path.c_str());
+        }
+        fprintf(json, "\n  ]\n}\n");
+        fclose(json);
+        cout << "wrote " << jsonPath << "\n";
+        return 0;
+    }
+    for (auto& f : files) {
+        if (codec) benchCodec(f);
+        else if (import.empty()) benchParse(f, threads);
+        else benchImport(f, import == "stream");
+    }
+    for (size_t tris : synthetic) {
+        string path = "bench_synthetic_" + to_string(tris) + ".obj";
+        cout << "generating " << path << "...\n";
+        if (!writeSyntheticObj(path, tris)) continue;
+        if (codec) benchCodec(path);
+        else if (import.empty()) benchParse(path, threads);
+        else benchImport(path, import == "stream");
+        remove(path.c_str());
+        if (codec) remove(meshPackagePath(path).c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,222 @@
+// mesh_cache.cpp
+
+#include "mesh_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+// -------------------- file layout --------------------
+// [header][sections in the order of MeshCacheSectionId, each aligned to 16 bytes]
+// Each section is an array of fixed-size records that the view points into directly.
+enum MeshCacheSectionId { SectionVertices, SectionIndices, SectionLods, SectionSubmeshes, SectionMeshlets, SectionMaterials, kSectionCount };
+
+struct MeshCacheSection {
+    uint64_t offset;
+    uint32_t count;
+    uint32_t elementSize;   // bytes per record, checked on open
+};
+
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t flags;   // kCacheStrips
+    uint32_t format;  // VertexFormatId of the vertex section
+    MeshBounds bounds;
+    MeshCacheSection sections[kSectionCount];
+};
+static const char kMeshCacheMagic[4] = { 'M', 'S', 'H', 'C' };
+static const uint32_t kCacheStrips = 1;   // indices are triangle strips
+
+static uint64_t align16(uint64_t v) { return (v + 15) & ~(uint64_t)15; }
+
+string meshCachePath(const string& objPath) {
+    return objPath + ".meshcache";
+}
+
+// -------------------- source hash --------------------
+// mtllib names referenced by the OBJ (a line starting with "mtllib", possibly several files)
+static void findMtlLibs(const char* p, size_t n, vector<string>& out) {
+    size_t i = 0;
+    while (i < n) {
+        size_t end = i;
+        while (end < n && p[end] != '\n') end++;
+        if (end - i > 7 && memcmp(p + i, "mtllib", 6) == 0 && (p[i + 6] == ' ' || p[i + 6] == '\t')) {
+            string line(p + i + 7, end - i - 7);
+            stringstream ss(line);
+            string name;
+            while (ss >> name) out.push_back(name);
+        }
+        i = end + 1;
+    }
+}
+
+uint64_t hashMeshSources(const string& objPath, const MeshImportOptions& opt, VertexFormatId format) {
+    MappedFile obj;
+    if (!obj.open(objPath)) return 0;
+    uint64_t h = hashBytes(obj.data(), obj.size(), kMeshCacheVersion);
+    vector<string> libs;
+    findMtlLibs(obj.data(), obj.size(), libs);
+    string base = objPath.substr(0, objPath.find_last_of("/\\") + 1);
+    for (auto& lib : libs) {
+        MappedFile mtl;
+        // a missing MTL still changes the key, so adding it later invalidates the cache
+        if (mtl.open(base + lib)) h = hashBytes(mtl.data(), mtl.size(), h);
+        else h = hashBytes(lib.data(), lib.size(), h ^ 0xDEADull);
+    }
+    h = hashBytes(&opt.weldEpsilon, sizeof(opt.weldEpsilon), h);
+    h = hashBytes(&opt.creaseAngle, sizeof(opt.creaseAngle), h);
+    // the parse path too: parallel and streaming fan-triangulate polygons past quads unlike tinyobj
+    unsigned char flags[10] = { opt.parallelParse, opt.streaming, opt.generateNormals, opt.generateTangents, opt.optimizeVertexCache,
+                                opt.optimizeOverdraw, opt.optimizeVertexFetch, opt.generateLods, opt.buildMeshlets, opt.triangleStrips };
+    h = hashBytes(flags, sizeof(flags), h);
+    uint32_t formatId = (uint32_t)format;
+    h = hashBytes(&formatId, sizeof(formatId), h);
+    return h ? h : 1;
+}
+
+// -------------------- write / open --------------------
+bool writeMeshCache(const string& cachePath, const MeshData& mesh, VertexFormatId format, uint64_t sourceHash) {
+    vector<uint16_t> scratch;
+    MeshView view = makeMeshView(mesh, scratch);
+    vector<unsigned char> packed;
+    const void* vertices = view.vertices;
+    if (format != VertexFormatFloat) {
+        PositionDequant dq;
+        if (isQuantizedFormat(format)) dq = positionDequant(mesh.bounds);
+        packVertices(format, view.vertices, view.vertexCount, dq, packed);
+        vertices = packed.data();
+    }
+    MeshCacheHeader hdr;
+    memset((void*)&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, kMeshCacheMagic, 4);
+    hdr.version = kMeshCacheVersion;
+    hdr.sourceHash = sourceHash;
+    hdr.flags = view.strips ? kCacheStrips : 0;
+    hdr.format = (uint32_t)format;
+    hdr.bounds = mesh.bounds;
+    const void* data[kSectionCount] = { vertices, view.indices, view.lods, view.submeshes, view.meshlets, view.materials };
+    size_t counts[kSectionCount] = { view.vertexCount, view.indexCount, view.lodCount, view.submeshCount, view.meshletCount, view.materialCount };
+    size_t sizes[kSectionCount] = { vertexFormatBytes(format), (size_t)view.indexSize, sizeof(MeshLod), sizeof(MeshSubmesh),
+                                    sizeof(Meshlet), sizeof(MeshMaterial) };
+    uint64_t end = sizeof(hdr);
+    for (int i = 0; i < kSectionCount; i++) {
+        hdr.sections[i].offset = align16(end);
+        hdr.sections[i].count = (uint32_t)counts[i];
+        hdr.sections[i].elementSize = (uint32_t)sizes[i];
+        end = hdr.sections[i].offset + (uint64_t)counts[i] * sizes[i];
+    }
+
+    // write to a temp file and rename, so a crash never leaves a truncated cache behind
+    string tmp = cachePath + ".tmp";
+    {
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out) { cerr << "Failed to write mesh cache: " << tmp << "\n"; return false; }
+        const char zeros[16] = {};
+        out.write((const char*)&hdr, sizeof(hdr));
+        uint64_t pos = sizeof(hdr);
+        for (int i = 0; i < kSectionCount; i++) {
+            out.write(zeros, hdr.sections[i].offset - pos);
+            out.write((const char*)data[i], (streamsize)counts[i] * sizes[i]);
+            pos = hdr.sections[i].offset + (uint64_t)counts[i] * sizes[i];
+        }
+        if (!out) { cerr << "Failed to write mesh cache: " << tmp << "\n"; return false; }
+    }
+    remove(cachePath.c_str());
+    if (rename(tmp.c_str(), cachePath.c_str()) != 0) {
+        cerr << "Failed to rename mesh cache: " << tmp << "\n";
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+static bool rangeFits(uint64_t offset, uint64_t count, uint64_t total) {
+    return offset + count <= total;
+}
+
+// Every index names a vertex; strips may also hold the restart value (all ones at the index width).
+template <typename T>
+static bool indicesFit(const T* indices, size_t count, size_t vertexCount, bool strips) {
+    const T restart = (T)~(T)0;
+    for (size_t i = 0; i < count; i++)
+        if (indices[i] >= vertexCount && !(strips && indices[i] == restart)) return false;
+    return true;
+}
+
+// Material strings end inside their fixed arrays.
+static bool terminated(const char* s, size_t size) {
+    return memchr(s, 0, size) != nullptr;
+}
+
+bool validMeshTables(const MeshView& v) {
+    bool fit = (v.indexSize == 2) ? indicesFit((const uint16_t*)v.indices, v.indexCount, v.vertexCount, v.strips)
+                                  : indicesFit((const uint32_t*)v.indices, v.indexCount, v.vertexCount, v.strips);
+    if (!fit) return false;
+    for (size_t i = 0; i < v.materialCount; i++) {
+        const MeshMaterial& m = v.materials[i];
+        if (!terminated(m.name, sizeof(m.name))) return false;
+        for (int t = 0; t < kMaterialTextureCount; t++)
+            if (!terminated(m.textures[t], sizeof(m.textures[t]))) return false;
+    }
+    for (size_t i = 0; i < v.lodCount; i++)
+        if (!rangeFits(v.lods[i].indexOffset, v.lods[i].indexCount, v.indexCount) ||
+            !rangeFits(v.lods[i].submeshOffset, v.lods[i].submeshCount, v.submeshCount)) return false;
+    for (size_t i = 0; i < v.submeshCount; i++)
+        if (!rangeFits(v.submeshes[i].indexOffset, v.submeshes[i].indexCount, v.indexCount) ||
+            !rangeFits(v.submeshes[i].meshletOffset, v.submeshes[i].meshletCount, v.meshletCount) ||
+            v.submeshes[i].material >= v.materialCount) return false;
+    for (size_t i = 0; i < v.meshletCount; i++)
+        if (!rangeFits(v.meshlets[i].indexOffset, v.meshlets[i].indexCount, v.indexCount)) return false;
+    return true;
+}
+
+bool openMeshCache(const string& cachePath, uint64_t sourceHash, CachedMesh& out) {
+    MappedFile file;
+    if (!file.open(cachePath)) return false;
+    if (file.size() < sizeof(MeshCacheHeader)) return false;
+    MeshCacheHeader hdr;
+    memcpy(&hdr, file.data(), sizeof(hdr));
+    if (memcmp(hdr.magic, kMeshCacheMagic, 4) != 0 || hdr.version != kMeshCacheVersion) return false;
+    if (hdr.sourceHash != sourceHash) return false;
+    const MeshCacheSection* sec = hdr.sections;
+    VertexFormatId format = (VertexFormatId)hdr.format;
+    size_t sizes[kSectionCount] = { vertexFormatBytes(format), sec[SectionIndices].elementSize, sizeof(MeshLod),
+                                    sizeof(MeshSubmesh), sizeof(Meshlet), sizeof(MeshMaterial) };
+    if (sizes[SectionVertices] == 0 || (sizes[SectionIndices] != 2 && sizes[SectionIndices] != 4)) return false;
+    uint64_t end = sizeof(hdr);
+    for (int i = 0; i < kSectionCount; i++) {
+        if (sec[i].elementSize != sizes[i] || sec[i].offset % 16 || sec[i].offset < end) return false;
+        end = sec[i].offset + (uint64_t)sec[i].count * sizes[i];
+    }
+    if (end > file.size()) return false;
+
+    const char* base = file.data();
+    MeshView v;
+    if (format == VertexFormatFloat) v.vertices = (const float*)(base + sec[SectionVertices].offset);
+    v.vertexCount = sec[SectionVertices].count;
+    v.indices = base + sec[SectionIndices].offset;
+    v.indexCount = sec[SectionIndices].count;
+    v.indexSize = (int)sec[SectionIndices].elementSize;
+    v.lods = (const MeshLod*)(base + sec[SectionLods].offset);
+    v.lodCount = sec[SectionLods].count;
+    v.submeshes = (const MeshSubmesh*)(base + sec[SectionSubmeshes].offset);
+    v.submeshCount = sec[SectionSubmeshes].count;
+    v.meshlets = (const Meshlet*)(base + sec[SectionMeshlets].offset);
+    v.meshletCount = sec[SectionMeshlets].count;
+    v.materials = (const MeshMaterial*)(base + sec[SectionMaterials].offset);
+    v.materialCount = sec[SectionMaterials].count;
+    v.bounds = hdr.bounds;
+    v.strips = (hdr.flags & kCacheStrips) != 0;
+    if (!validMeshTables(v)) return false;
+    out.view = v;
+    out.format = format;
+    out.vertices = base + sec[SectionVertices].offset;
+    out.file = std::move(file);
+    return true;
+}
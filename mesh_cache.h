@@ -0,0 +1,42 @@
+// mesh_cache.h
+// Versioned binary cache of imported meshes. The file holds the final vertex stream already in its
+// upload format (vertex_format.h), the index stream at upload width, the LOD, submesh, meshlet and
+// material tables and the bounds, and is memory-mapped on load so the GL upload reads straight from
+// the page cache.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "mapped_file.h"
+#include "mesh_import.h"
+#include "vertex_format.h"
+
+// bump whenever the file layout or the import pipeline output changes
+const uint32_t kMeshCacheVersion = 10;
+
+struct CachedMesh {
+    MappedFile file;
+    MeshView view;   // points into file; view.vertices is set for VertexFormatFloat only
+    VertexFormatId format = VertexFormatFloat;
+    const void* vertices = nullptr;   // view.vertexCount * vertexFormatBytes(format) bytes in file
+};
+
+// Cache file used for an OBJ ("model.obj" -> "model.obj.meshcache").
+std::string meshCachePath(const std::string& objPath);
+
+// Hash of the OBJ bytes, every MTL it references, the import options, the vertex format and the
+// cache version. Returns 0 when the OBJ cannot be read.
+uint64_t hashMeshSources(const std::string& objPath, const MeshImportOptions& opt, VertexFormatId format);
+
+// Writes mesh with its vertices packed into format (quantized ones against positionDequant(mesh.bounds)).
+bool writeMeshCache(const std::string& cachePath, const MeshData& mesh, VertexFormatId format, uint64_t sourceHash);
+
+// Maps the cache and validates magic, version, source hash, vertex format and stream sizes.
+bool openMeshCache(const std::string& cachePath, uint64_t sourceHash, CachedMesh& out);
+
+// Every index names a vertex (or is the strip restart value), the LOD, submesh and meshlet ranges
+// lie inside the buffers they index, every submesh names an existing material and the material
+// strings are terminated; for files that come from elsewhere.
+bool validMeshTables(const MeshView& view);
@@ -0,0 +1,498 @@
+// mesh_codec.cpp
+
+#include "mesh_codec.h"
+
+#include "mapped_file.h"
+#include "mesh_cache.h"
+#include "mesh_optimize.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CODEC_SSE 1
+#endif
+
+using namespace std;
+
+// -------------------- vertex codec --------------------
+// Block layout: a mode byte, then for coded blocks, for every byte plane a header of 2 bits per group
+// (group g at bits 2 * (g % 4) of byte g / 4), then all groups of plane 0, all groups of plane 1, ...
+// The 2-bit code selects 0, 2, 4 or 8 bits per value; values are packed high bits first. A delta
+// word puts the low byte of its zigzagged difference in its first plane and the high byte in its
+// second; other planes hold the vertex bytes as they are. Raw blocks split the vertex into runs of
+// delta and of other words and store each run of all n vertices in turn, so whole attribute values
+// stay together for a general-purpose compressor to match.
+static const size_t kGroup = 16;
+static const size_t kGroupBytes[4] = { 0, 4, 8, 16 };
+static const unsigned char kBlockCoded = 0, kBlockRaw = 1;
+
+static bool isDeltaWord(uint32_t deltaWords, size_t word) {
+    return word < 32 && (deltaWords >> word & 1);
+}
+
+static int groupCode(const unsigned char* header, size_t group) {
+    return (header[group / 4] >> (2 * (group % 4))) & 3;
+}
+
+// Byte offsets of the raw block runs in bounds[0, count], bounds[count] = stride; returns count.
+static size_t rawRuns(size_t stride, uint32_t deltaWords, size_t* bounds) {
+    size_t count = 0;
+    bounds[count++] = 0;
+    for (size_t w = 1; w < stride / 2; w++)
+        if (isDeltaWord(deltaWords, w) != isDeltaWord(deltaWords, w - 1)) bounds[count++] = 2 * w;
+    bounds[count] = stride;
+    return count;
+}
+
+static bool sameDeltaWords(const unsigned char* a, const unsigned char* b, size_t stride, uint32_t deltaWords) {
+    for (size_t w = 0; w < stride / 2; w++)
+        if (isDeltaWord(deltaWords, w) && memcmp(a + 2 * w, b + 2 * w, 2) != 0) return false;
+    return true;
+}
+
+void encodeVertexBuffer(const void* vertices, size_t vertexCount, size_t stride, uint32_t deltaWords, vector<unsigned char>& out) {
+    const unsigned char* src = (const unsigned char*)vertices;
+    out.clear();
+    uint16_t last[128] = {};
+    size_t runs[129];
+    size_t runCount = rawRuns(stride, deltaWords, runs);
+    vector<unsigned char> planes(stride * kVertexCodecBlock), block;
+    unordered_map<uint64_t, size_t> seen;   // hash of the delta words -> last vertex with them
+    for (size_t base = 0; base < vertexCount; base += kVertexCodecBlock) {
+        size_t n = min(kVertexCodecBlock, vertexCount - base);
+        size_t groups = (n + kGroup - 1) / kGroup, headerBytes = (groups + 3) / 4;
+        // values past the end stay 0: the decoder then repeats the last vertex there
+        fill(planes.begin(), planes.end(), (unsigned char)0);
+        size_t repeats = 0;
+        for (size_t i = 0; i < n; i++) {
+            const unsigned char* v = src + (base + i) * stride;
+            uint64_t h = 14695981039346656037ull;
+            for (size_t w = 0; w < stride / 2; w++)
+                if (isDeltaWord(deltaWords, w)) h = (h ^ (v[2 * w] | v[2 * w + 1] << 8)) * 1099511628211ull;
+            auto it = seen.find(h);
+            if (it != seen.end() && base + i - it->second <= kVertexCodecBlock && sameDeltaWords(src + it->second * stride, v, stride, deltaWords))
+                repeats++;
+            seen[h] = base + i;
+            for (size_t w = 0; w < stride / 2; w++) {
+                unsigned char* lo = &planes[2 * w * kVertexCodecBlock + i];
+                unsigned char* hi = lo + kVertexCodecBlock;
+                if (!isDeltaWord(deltaWords, w)) {
+                    *lo = v[2 * w];
+                    *hi = v[2 * w + 1];
+                    continue;
+                }
+                uint16_t value;
+                memcpy(&value, v + 2 * w, sizeof(value));
+                uint16_t d = (uint16_t)(value - last[w]);
+                uint16_t z = (uint16_t)((d << 1) ^ (0u - (d >> 15)));
+                last[w] = value;
+                *lo = (unsigned char)z;
+                *hi = (unsigned char)(z >> 8);
+            }
+        }
+        block.assign(stride * headerBytes, 0);
+        for (size_t k = 0; k < stride; k++) {
+            for (size_t g = 0; g < groups; g++) {
+                const unsigned char* z = &planes[k * kVertexCodecBlock + g * kGroup];
+                unsigned char any = 0;
+                for (size_t i = 0; i < kGroup; i++) any |= z[i];
+                int code = any == 0 ? 0 : any < 4 ? 1 : any < 16 ? 2 : 3;
+                block[k * headerBytes + g / 4] |= (unsigned char)(code << (2 * (g % 4)));
+                if (code == 1)
+                    for (int j = 0; j < 4; j++) block.push_back((unsigned char)(z[4 * j] << 6 | z[4 * j + 1] << 4 | z[4 * j + 2] << 2 | z[4 * j + 3]));
+                else if (code == 2)
+                    for (int j = 0; j < 8; j++) block.push_back((unsigned char)(z[2 * j] << 4 | z[2 * j + 1]));
+                else if (code == 3) block.insert(block.end(), z, z + kGroup);
+            }
+        }
+        // Blocks that do not shrink stay raw, and so do blocks where most vertices repeat a recent
+        // one (faceted meshes repeat every position on several vertices): deltas turn those repeats
+        // into noise a compressor cannot match, so it gets them back as whole values.
+        if (block.size() < n * stride && repeats * 2 <= n) {
+            out.push_back(kBlockCoded);
+            out.insert(out.end(), block.begin(), block.end());
+        }
+        else {
+            out.push_back(kBlockRaw);
+            for (size_t r = 0; r < runCount; r++)
+                for (size_t i = 0; i < n; i++) {
+                    const unsigned char* v = src + (base + i) * stride;
+                    out.insert(out.end(), v + runs[r], v + runs[r + 1]);
+                }
+        }
+    }
+}
+
+#if CODEC_SSE
+// one group of 16 plane values, a value per byte lane
+static __m128i unpackGroup(const unsigned char* src, int code) {
+    switch (code) {
+    case 0: return _mm_setzero_si128();
+    case 1: {
+        int word;
+        memcpy(&word, src, sizeof(word));
+        __m128i x = _mm_cvtsi32_si128(word), m = _mm_set1_epi8(3);
+        __m128i a = _mm_and_si128(_mm_srli_epi16(x, 6), m), b = _mm_and_si128(_mm_srli_epi16(x, 4), m);
+        __m128i c = _mm_and_si128(_mm_srli_epi16(x, 2), m), d = _mm_and_si128(x, m);
+        return _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, b), _mm_unpacklo_epi8(c, d));
+    }
+    case 2: {
+        __m128i x = _mm_loadl_epi64((const __m128i*)src), m = _mm_set1_epi8(15);
+        return _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(x, 4), m), _mm_and_si128(x, m));
+    }
+    default: return _mm_loadu_si128((const __m128i*)src);
+    }
+}
+
+// 8 zigzagged 16-bit deltas -> values: un-zigzag, prefix sum across the lanes, add the previous
+// value (broadcast to every lane)
+static __m128i decodeWords(__m128i z, __m128i last) {
+    __m128i half = _mm_srli_epi16(z, 1);
+    __m128i sign = _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(z, _mm_set1_epi16(1)));
+    __m128i d = _mm_xor_si128(half, sign);
+    d = _mm_add_epi16(d, _mm_slli_si128(d, 2));
+    d = _mm_add_epi16(d, _mm_slli_si128(d, 4));
+    d = _mm_add_epi16(d, _mm_slli_si128(d, 8));
+    return _mm_add_epi16(d, last);
+}
+
+static __m128i broadcastLastWord(__m128i v) {
+    return _mm_shuffle_epi32(_mm_shufflehi_epi16(v, 0xFF), 0xFF);
+}
+
+// the low / high byte planes of a delta word group, decoded in place
+static void decodeWordGroup(__m128i& lo, __m128i& hi, __m128i& last) {
+    __m128i a = decodeWords(_mm_unpacklo_epi8(lo, hi), last);
+    last = broadcastLastWord(a);
+    __m128i b = decodeWords(_mm_unpackhi_epi8(lo, hi), last);
+    last = broadcastLastWord(b);
+    __m128i m = _mm_set1_epi16(0xFF);
+    lo = _mm_packus_epi16(_mm_and_si128(a, m), _mm_and_si128(b, m));
+    hi = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+}
+
+// four byte planes of 16 vertices -> the 4 bytes at the same offset of each vertex
+static void storeTransposed(const __m128i* p, unsigned char* dst, size_t stride) {
+    __m128i a = _mm_unpacklo_epi8(p[0], p[1]), b = _mm_unpackhi_epi8(p[0], p[1]);
+    __m128i c = _mm_unpacklo_epi8(p[2], p[3]), d = _mm_unpackhi_epi8(p[2], p[3]);
+    __m128i w[4] = { _mm_unpacklo_epi16(a, c), _mm_unpackhi_epi16(a, c), _mm_unpacklo_epi16(b, d), _mm_unpackhi_epi16(b, d) };
+    for (int q = 0; q < 4; q++) {
+        for (int i = 0; i < 4; i++) {
+            int word = _mm_cvtsi128_si32(w[q]);
+            memcpy(dst + (4 * q + i) * stride, &word, sizeof(word));
+            w[q] = _mm_srli_si128(w[q], 4);
+        }
+    }
+}
+#else
+static void unpackGroupScalar(const unsigned char* src, int code, unsigned char* values) {
+    for (size_t i = 0; i < kGroup; i++)
+        values[i] = code == 0 ? 0
+                  : code == 1 ? (src[i / 4] >> (6 - 2 * (i % 4))) & 3
+                  : code == 2 ? (src[i / 2] >> (4 - 4 * (i % 2))) & 15
+                  : src[i];
+}
+#endif
+
+bool decodeVertexBuffer(void* vertices, size_t vertexCount, size_t stride, uint32_t deltaWords, const unsigned char* data, size_t size) {
+    if (stride == 0 || stride % 4 || stride > 256) return false;
+    unsigned char* dst = (unsigned char*)vertices;
+    size_t pos = 0;
+    uint16_t last[128] = {};
+    size_t planes[256];
+    unsigned char tail[kGroup * 256];   // the final, partial group
+    size_t runs[129];
+    size_t runCount = rawRuns(stride, deltaWords, runs);
+    for (size_t base = 0; base < vertexCount; base += kVertexCodecBlock) {
+        size_t n = min(kVertexCodecBlock, vertexCount - base);
+        if (pos == size) return false;
+        unsigned char mode = data[pos++];
+        if (mode == kBlockRaw) {
+            if (size - pos < n * stride) return false;
+            for (size_t r = 0; r < runCount; r++) {
+                size_t bytes = runs[r + 1] - runs[r];
+                for (size_t i = 0; i < n; i++, pos += bytes) memcpy(dst + (base + i) * stride + runs[r], data + pos, bytes);
+            }
+            for (size_t w = 0; w < stride / 2; w++)
+                if (isDeltaWord(deltaWords, w)) memcpy(&last[w], dst + (base + n - 1) * stride + 2 * w, sizeof(last[w]));
+            continue;
+        }
+        if (mode != kBlockCoded) return false;
+        size_t groups = (n + kGroup - 1) / kGroup, headerBytes = (groups + 3) / 4;
+        if (size - pos < stride * headerBytes) return false;
+        const unsigned char* header = data + pos;
+        pos += stride * headerBytes;
+        for (size_t k = 0; k < stride; k++) {
+            planes[k] = pos;
+            for (size_t g = 0; g < groups; g++) pos += kGroupBytes[groupCode(header + k * headerBytes, g)];
+        }
+        // the 16-byte load of an 8-bit group may not run past the input either
+        if (pos > size) return false;
+        bool partial = n % kGroup != 0;
+        // four planes at a time: the two 16-bit words at byte k
+        for (size_t k = 0; k < stride; k += 4) {
+            bool delta[2] = { isDeltaWord(deltaWords, k / 2), isDeltaWord(deltaWords, k / 2 + 1) };
+#if CODEC_SSE
+            __m128i prev[2] = { _mm_set1_epi16((short)last[k / 2]), _mm_set1_epi16((short)last[k / 2 + 1]) };
+#endif
+            for (size_t g = 0; g < groups; g++) {
+                unsigned char* out = (partial && g == groups - 1) ? tail : dst + (base + g * kGroup) * stride;
+#if CODEC_SSE
+                __m128i values[4];
+                for (int p = 0; p < 4; p++) {
+                    int code = groupCode(header + (k + p) * headerBytes, g);
+                    values[p] = unpackGroup(data + planes[k + p], code);
+                    planes[k + p] += kGroupBytes[code];
+                }
+                for (int w = 0; w < 2; w++)
+                    if (delta[w]) decodeWordGroup(values[2 * w], values[2 * w + 1], prev[w]);
+                storeTransposed(values, out + k, stride);
+#else
+                unsigned char values[4][kGroup];
+                for (size_t p = 0; p < 4; p++) {
+                    int code = groupCode(header + (k + p) * headerBytes, g);
+                    unpackGroupScalar(data + planes[k + p], code, values[p]);
+                    planes[k + p] += kGroupBytes[code];
+                }
+                for (size_t w = 0; w < 2; w++) {
+                    if (!delta[w]) continue;
+                    uint16_t& v = last[k / 2 + w];
+                    for (size_t i = 0; i < kGroup; i++) {
+                        uint16_t z = (uint16_t)(values[2 * w][i] | values[2 * w + 1][i] << 8);
+                        v = (uint16_t)(v + ((z >> 1) ^ (0u - (z & 1))));
+                        values[2 * w][i] = (unsigned char)v;
+                        values[2 * w + 1][i] = (unsigned char)(v >> 8);
+                    }
+                }
+                for (size_t p = 0; p < 4; p++)
+                    for (size_t i = 0; i < kGroup; i++) out[i * stride + k + p] = values[p][i];
+#endif
+            }
+#if CODEC_SSE
+            for (int w = 0; w < 2; w++) last[k / 2 + w] = (uint16_t)_mm_cvtsi128_si32(prev[w]);
+#endif
+        }
+        if (partial) memcpy(dst + (base + (groups - 1) * kGroup) * stride, tail, (n % kGroup) * stride);
+    }
+    return pos == size;
+}
+
+// -------------------- index codec --------------------
+// Per index one code: 0 = the next vertex never referenced so far; 1..16 = the index seen that many
+// indices ago (a window that covers the neighbouring triangles of a vertex cache ordered list);
+// otherwise varint(zigzag(index - previous) + 17).
+static const uint32_t kIndexWindow = 16;
+static const uint64_t kIndexDeltaBase = kIndexWindow + 1;
+
+static void writeVarint(uint64_t v, vector<unsigned char>& out) {
+    while (v >= 128) {
+        out.push_back((unsigned char)(v | 128));
+        v >>= 7;
+    }
+    out.push_back((unsigned char)v);
+}
+
+void encodeIndexBuffer(const uint32_t* indices, size_t indexCount, vector<unsigned char>& out) {
+    out.clear();
+    out.reserve(indexCount + indexCount / 2);
+    uint32_t next = 0, prev = 0;
+    uint32_t window[kIndexWindow] = {};
+    size_t seen = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t v = indices[i];
+        uint32_t age = 0;
+        for (uint32_t k = 1; k <= kIndexWindow && k <= seen && !age; k++)
+            if (window[(seen - k) % kIndexWindow] == v) age = k;
+        if (v == next) out.push_back(0);
+        else if (age) out.push_back((unsigned char)age);
+        else {
+            uint32_t d = v - prev;
+            writeVarint((uint64_t)((d << 1) ^ (0u - (d >> 31))) + kIndexDeltaBase, out);
+        }
+        if (v != kStripRestartIndex && v >= next) next = v + 1;
+        prev = v;
+        window[seen++ % kIndexWindow] = v;
+    }
+}
+
+// Scalar: a window code reads the index decoded just before it, and a triangle of a fetch-ordered
+// buffer mixes new-vertex and window codes.
+template <typename T>
+static bool decodeIndices(T* dst, size_t indexCount, const unsigned char* data, size_t size) {
+    const unsigned char* end = data + size;
+    uint32_t next = 0, prev = 0;
+    uint32_t window[kIndexWindow] = {};
+    for (size_t i = 0; i < indexCount; i++) {
+        if (data == end) return false;
+        uint32_t v;
+        if (*data == 0) {
+            v = next;
+            data++;
+        }
+        else if (*data <= kIndexWindow) {
+            if (*data > i) return false;
+            v = window[(i - *data) % kIndexWindow];
+            data++;
+        }
+        else {
+            uint64_t code = 0;
+            for (int shift = 0;; shift += 7) {
+                if (data == end || shift > 35) return false;
+                unsigned char b = *data++;
+                code |= (uint64_t)(b & 127) << shift;
+                if (!(b & 128)) break;
+            }
+            uint32_t z = (uint32_t)(code - kIndexDeltaBase);
+            v = prev + ((z >> 1) ^ (0u - (z & 1)));
+        }
+        if (v != kStripRestartIndex && v >= next) next = v + 1;
+        prev = v;
+        window[i % kIndexWindow] = v;
+        dst[i] = (T)v;
+    }
+    return data == end;
+}
+
+bool decodeIndexBuffer(void* indices, size_t indexCount, int indexSize, const unsigned char* data, size_t size) {
+    if (indexSize == 2) return decodeIndices((uint16_t*)indices, indexCount, data, size);
+    if (indexSize == 4) return decodeIndices((uint32_t*)indices, indexCount, data, size);
+    return false;
+}
+
+// -------------------- packages --------------------
+// [header][lods][submeshes][meshlets][materials][encoded vertices][encoded indices], unaligned:
+// everything is copied out or decoded on load.
+struct MeshPackageHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;   // kPackageStrips
+    uint32_t indexSize;
+    uint32_t vertexCount, indexCount;
+    uint32_t lodCount, submeshCount, meshletCount, materialCount;
+    uint64_t vertexBytes, indexBytes;   // encoded sizes
+    MeshBounds bounds;
+};
+static const char kMeshPackageMagic[4] = { 'M', 'S', 'H', 'P' };
+static const uint32_t kPackageStrips = 1;
+
+string meshPackagePath(const string& objPath) {
+    return objPath + ".meshpack";
+}
+
+bool writeMeshPackage(const string& packagePath, const MeshData& mesh) {
+    vector<CompactVertex> compact;
+    quantizeVertices(mesh.vertices.data(), mesh.vertexCount(), positionDequant(mesh.bounds), compact);
+    vector<unsigned char> vertexData, indexData;
+    encodeVertexBuffer(compact.data(), compact.size(), sizeof(CompactVertex), kCompactDeltaWords, vertexData);
+    encodeIndexBuffer(mesh.indices.data(), mesh.indices.size(), indexData);
+
+    MeshPackageHeader hdr;
+    memset((void*)&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, kMeshPackageMagic, 4);
+    hdr.version = kMeshPackageVersion;
+    hdr.flags = mesh.strips ? kPackageStrips : 0;
+    hdr.indexSize = mesh.fitsShortIndices() ? 2 : 4;
+    hdr.vertexCount = (uint32_t)mesh.vertexCount();
+    hdr.indexCount = (uint32_t)mesh.indices.size();
+    hdr.lodCount = (uint32_t)mesh.lods.size();
+    hdr.submeshCount = (uint32_t)mesh.submeshes.size();
+    hdr.meshletCount = (uint32_t)mesh.meshlets.size();
+    hdr.materialCount = (uint32_t)mesh.materials.size();
+    hdr.vertexBytes = vertexData.size();
+    hdr.indexBytes = indexData.size();
+    hdr.bounds = mesh.bounds;
+
+    // temp file and rename, as for the mesh cache
+    string tmp = packagePath + ".tmp";
+    {
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out) { cerr << "Failed to write mesh package: " << tmp << "\n"; return false; }
+        out.write((const char*)&hdr, sizeof(hdr));
+        out.write((const char*)mesh.lods.data(), (streamsize)(mesh.lods.size() * sizeof(MeshLod)));
+        out.write((const char*)mesh.submeshes.data(), (streamsize)(mesh.submeshes.size() * sizeof(MeshSubmesh)));
+        out.write((const char*)mesh.meshlets.data(), (streamsize)(mesh.meshlets.size() * sizeof(Meshlet)));
+        out.write((const char*)mesh.materials.data(), (streamsize)(mesh.materials.size() * sizeof(MeshMaterial)));
+        out.write((const char*)vertexData.data(), (streamsize)vertexData.size());
+        out.write((const char*)indexData.data(), (streamsize)indexData.size());
+        if (!out) { cerr << "Failed to write mesh package: " << tmp << "\n"; return false; }
+    }
+    remove(packagePath.c_str());
+    if (rename(tmp.c_str(), packagePath.c_str()) != 0) {
+        cerr << "Failed to rename mesh package: " << tmp << "\n";
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+static void readTable(const char*& p, uint32_t count, vector<T>& out) {
+    out.resize(count);
+    memcpy((void*)out.data(), p, count * sizeof(T));
+    p += count * sizeof(T);
+}
+
+bool readMeshPackage(const string& packagePath, MeshPackage& out) {
+    MappedFile file;
+    if (!file.open(packagePath)) return false;
+    if (file.size() < sizeof(MeshPackageHeader)) return false;
+    MeshPackageHeader hdr;
+    memcpy(&hdr, file.data(), sizeof(hdr));
+    if (memcmp(hdr.magic, kMeshPackageMagic, 4) != 0 || hdr.version != kMeshPackageVersion) return false;
+    if (hdr.indexSize != 2 && hdr.indexSize != 4) return false;
+    uint64_t tables = (uint64_t)hdr.lodCount * sizeof(MeshLod) + (uint64_t)hdr.submeshCount * sizeof(MeshSubmesh) +
+                      (uint64_t)hdr.meshletCount * sizeof(Meshlet) + (uint64_t)hdr.materialCount * sizeof(MeshMaterial);
+    if (sizeof(hdr) + tables + hdr.vertexBytes + hdr.indexBytes != file.size()) {
+        cerr << "Corrupt mesh package: " << packagePath << "\n";
+        return false;
+    }
+    // the smallest encodings are the block headers (a byte per plane per 64 vertices) and one byte
+    // per index; counts past that are corrupt, and would size the buffers below from the header alone
+    if (((uint64_t)hdr.vertexCount + 63) / 64 * sizeof(CompactVertex) > hdr.vertexBytes || hdr.indexCount > hdr.indexBytes) {
+        cerr << "Corrupt mesh package: " << packagePath << "\n";
+        return false;
+    }
+
+    const char* p = file.data() + sizeof(hdr);
+    readTable(p, hdr.lodCount, out.lods);
+    readTable(p, hdr.submeshCount, out.submeshes);
+    readTable(p, hdr.meshletCount, out.meshlets);
+    readTable(p, hdr.materialCount, out.materials);
+    out.vertices.resize((size_t)hdr.vertexCount * sizeof(CompactVertex));
+    out.indices.resize((size_t)hdr.indexCount * hdr.indexSize);
+    const unsigned char* vertexData = (const unsigned char*)p;
+    const unsigned char* indexData = vertexData + hdr.vertexBytes;
+    if (!decodeVertexBuffer(out.vertices.data(), hdr.vertexCount, sizeof(CompactVertex), kCompactDeltaWords, vertexData, (size_t)hdr.vertexBytes) ||
+        !decodeIndexBuffer(out.indices.data(), hdr.indexCount, (int)hdr.indexSize, indexData, (size_t)hdr.indexBytes)) {
+        cerr << "Corrupt mesh package: " << packagePath << "\n";
+        return false;
+    }
+
+    MeshView& v = out.view;
+    v = MeshView();
+    v.vertexCount = hdr.vertexCount;
+    v.indices = out.indices.data();
+    v.indexCount = hdr.indexCount;
+    v.indexSize = (int)hdr.indexSize;
+    v.lods = out.lods.data();
+    v.lodCount = out.lods.size();
+    v.submeshes = out.submeshes.data();
+    v.submeshCount = out.submeshes.size();
+    v.meshlets = out.meshlets.data();
+    v.meshletCount = out.meshlets.size();
+    v.materials = out.materials.data();
+    v.materialCount = out.materials.size();
+    v.bounds = hdr.bounds;
+    v.strips = (hdr.flags & kPackageStrips) != 0;
+    if (!validMeshTables(v)) {
+        cerr << "Corrupt mesh package: " << packagePath << "\n";
+        return false;
+    }
+    return true;
+}
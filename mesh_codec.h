@@ -0,0 +1,64 @@
+// mesh_codec.h
+// Compressed mesh packages for distribution, next to the local mesh cache: compact vertices and
+// indices in a byte-oriented encoding that general-purpose compressors shrink further. The vertex
+// decoder uses SSE2 where available; the index decoder is scalar.
+//
+// Vertices are coded in blocks of byte planes, in groups of 16 vertices bit-packed to 0, 2, 4 or 8
+// bits per value. Smooth 16-bit attributes (the delta words) are the zigzagged difference to the
+// previous vertex, split into a low and a high byte plane; other bytes are stored as they are.
+// Blocks that would not shrink, or whose vertices mostly repeat recent ones, stay raw, grouped by
+// attribute so a compressor on top can match the repeats.
+// Indices are one-byte codes for the next unseen vertex (what a fetch-ordered buffer mostly holds)
+// and for repeats of the last 16 indices, else varints of the difference to the previous index.
+// Each code depends on the indices before it and the codes come in short mixed runs, so there is
+// little for SIMD to batch there.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mesh_import.h"
+#include "mesh_quantize.h"
+
+// vertices per block; the decoder keeps one block's headers and plane offsets on the stack
+const size_t kVertexCodecBlock = 256;
+
+// CompactVertex words that change smoothly between neighbouring vertices: pos and uv. The packed
+// normal and the octahedral tangent are stored as they are.
+const uint32_t kCompactDeltaWords = 0x7 | 0x3 << 6;
+
+// stride must be a multiple of 4 and at most 256 bytes. Bit w of deltaWords delta-codes the 16-bit
+// word at byte 2 * w (w < 32); decode with the same mask.
+void encodeVertexBuffer(const void* vertices, size_t vertexCount, size_t stride, uint32_t deltaWords, std::vector<unsigned char>& out);
+// Returns false when data is truncated or malformed.
+bool decodeVertexBuffer(void* vertices, size_t vertexCount, size_t stride, uint32_t deltaWords, const unsigned char* data, size_t size);
+
+void encodeIndexBuffer(const uint32_t* indices, size_t indexCount, std::vector<unsigned char>& out);
+// indexSize 2 or 4; kStripRestartIndex comes out as the all-ones value of that width.
+bool decodeIndexBuffer(void* indices, size_t indexCount, int indexSize, const unsigned char* data, size_t size);
+
+// bump whenever the package layout or either encoding changes
+const uint32_t kMeshPackageVersion = 2;
+
+// A decoded package. view points into the members; its vertices stay null, the vertex data is
+// CompactVertex (quantized against positionDequant(view.bounds)).
+struct MeshPackage {
+    std::vector<unsigned char> vertices;
+    std::vector<unsigned char> indices;   // at view.indexSize
+    std::vector<MeshLod> lods;
+    std::vector<MeshSubmesh> submeshes;
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshMaterial> materials;
+    MeshView view;
+};
+
+// Package shipped for an OBJ ("model.obj" -> "model.obj.meshpack").
+std::string meshPackagePath(const std::string& objPath);
+
+bool writeMeshPackage(const std::string& packagePath, const MeshData& mesh);
+
+// Reads and decodes a package, validating sizes, counts and tables (validMeshTables).
+bool readMeshPackage(const std::string& packagePath, MeshPackage& out);
@@ -0,0 +1,727 @@
+// mesh_import.cpp
+// OBJ import (whole-file or streaming), index-triple welding, optional positional welding and
+// the optimization passes from mesh_optimize.
+
+#include "mesh_import.h"
+#include "mesh_optimize.h"
+#include "mesh_simplify.h"
+#include "mesh_tangents.h"
+#include "mem_stats.h"
+#include "obj_parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+#include "tiny_obj_loader.h"
+
+using namespace std;
+
+// -------------------- index-triple welding --------------------
+// OBJ faces reference (vertex, normal, texcoord) independently; every distinct triple is one GPU vertex.
+struct VertexKey {
+    int v, n, t;
+    bool operator==(const VertexKey& o) const { return v == o.v && n == o.n && t == o.t; }
+};
+static inline uint32_t hashVertexKey(const VertexKey& k) {
+    uint64_t h = (uint32_t)k.v * 0x9E3779B97F4A7C15ull;
+    h ^= ((uint32_t)k.n + 0x7F4A7C15ull + (h << 6) + (h >> 2)) * 0xBF58476D1CE4E5B9ull;
+    h ^= ((uint32_t)k.t + 0x94D049BBull + (h << 6) + (h >> 2)) * 0x94D049BB133111EBull;
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+// Open-addressing table from key to vertex id: 4 bytes per slot plus the 12-byte key per unique
+// vertex, about a third of what std::unordered_map needs for the same content.
+struct VertexWelder {
+    vector<uint32_t> slots;   // vertex id + 1, 0 = empty
+    vector<VertexKey> keys;   // by vertex id
+    void reserve(size_t vertices) {
+        keys.reserve(vertices);
+        size_t cap = 16;
+        while (cap < vertices * 2) cap <<= 1;
+        if (cap > slots.size()) rehash(cap);
+    }
+    // returns the vertex id; added is set when the key was not present yet
+    uint32_t findOrAdd(const VertexKey& k, bool& added) {
+        if ((keys.size() + 1) * 2 > slots.size()) rehash(max<size_t>(16, slots.size() * 2));
+        size_t mask = slots.size() - 1;
+        for (size_t i = hashVertexKey(k) & mask;; i = (i + 1) & mask) {
+            uint32_t s = slots[i];
+            if (s == 0) {
+                keys.push_back(k);
+                slots[i] = (uint32_t)keys.size();
+                added = true;
+                return (uint32_t)keys.size() - 1;
+            }
+            if (keys[s - 1] == k) { added = false; return s - 1; }
+        }
+    }
+    void rehash(size_t cap) {
+        slots.assign(cap, 0);
+        size_t mask = cap - 1;
+        for (size_t id = 0; id < keys.size(); id++) {
+            size_t i = hashVertexKey(keys[id]) & mask;
+            while (slots[i]) i = (i + 1) & mask;
+            slots[i] = (uint32_t)id + 1;
+        }
+    }
+};
+
+static void appendVertex(const float* positions, const float* normals, const float* texcoords,
+                         const VertexKey& k, vector<float>& data) {
+    // position
+    data.push_back(positions[3 * k.v + 0]);
+    data.push_back(positions[3 * k.v + 1]);
+    data.push_back(positions[3 * k.v + 2]);
+    // normal
+    if (k.n >= 0) {
+        data.push_back(normals[3 * k.n + 0]);
+        data.push_back(normals[3 * k.n + 1]);
+        data.push_back(normals[3 * k.n + 2]);
+    }
+    else {
+        // all zero marks "no normal" for generateNormals
+        data.push_back(0); data.push_back(0); data.push_back(0);
+    }
+    // uv
+    if (k.t >= 0) {
+        data.push_back(texcoords[2 * k.t + 0]);
+        data.push_back(texcoords[2 * k.t + 1]);
+    }
+    else { data.push_back(0.0f); data.push_back(0.0f); }
+    // tangent, filled by generateTangents after welding
+    data.insert(data.end(), 4, 0.0f);
+}
+
+static inline void emitCorner(const VertexKey& key, const float* positions, const float* normals, const float* texcoords,
+                              VertexWelder& unique, MeshData& out) {
+    bool added;
+    uint32_t id = unique.findOrAdd(key, added);
+    if (added) appendVertex(positions, normals, texcoords, key, out.vertices);
+    out.indices.push_back(id);
+}
+
+// -------------------- stage accounting --------------------
+// Records one MeshImportStage per begin/end pair when the caller asked for them; free otherwise.
+struct StageRecorder {
+    vector<MeshImportStage>* stages = nullptr;
+    MeshImportStage current;
+    chrono::steady_clock::time_point start;
+    AllocationCounters allocStart;
+
+    void begin(const char* name) {
+        if (!stages) return;
+        current = MeshImportStage();
+        current.name = name;
+        resetPeakRss();
+        allocStart = allocationCounters();
+        start = chrono::steady_clock::now();
+    }
+    void end() {
+        if (!stages) return;
+        current.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        AllocationCounters alloc = allocationCounters();
+        current.allocations = alloc.count - allocStart.count;
+        current.allocatedBytes = alloc.bytes - allocStart.bytes;
+        current.peakRssBytes = peakRssBytes();
+        stages->push_back(current);
+    }
+};
+
+// -------------------- full parse, then weld --------------------
+// attrib/shapes are released before returning so the later passes run on the compact mesh only.
+static bool importWhole(const string& path, MeshData& out, const MeshImportOptions& opt, size_t& corners,
+                        vector<int>& faceMaterials, vector<tinyobj::material_t>& materials, StageRecorder& rec) {
+    tinyobj::attrib_t attrib;
+    vector<tinyobj::shape_t> shapes;
+    string warn, err;
+    string base = path.substr(0, path.find_last_of("/\\") + 1);
+    rec.begin("parse");
+    bool ok = opt.parallelParse
+        ? parseObjParallel(path, attrib, shapes, materials, warn, err, base)
+        : tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), base.c_str());
+    if (!warn.empty()) cerr << "WARN: " << warn << "\n";
+    if (!err.empty()) cerr << "ERR: " << err << "\n";
+    if (!ok) return false;
+    rec.end();
+
+    // de-index: one interleaved vertex per unique v/vt/vn triple
+    rec.begin("weld");
+    corners = 0;
+    for (auto& shape : shapes) corners += shape.mesh.indices.size();
+    out.indices.reserve(corners);
+    // a closed mesh has roughly one unique vertex per 6 corners; the vectors grow if it is worse
+    out.vertices.reserve(corners / 4 * kMeshVertexFloats);
+    faceMaterials.reserve(corners / 3);
+    VertexWelder unique;
+    unique.reserve(corners / 4);
+    for (auto& shape : shapes) {
+        for (auto& f : shape.mesh.indices) {
+            VertexKey key = { f.vertex_index, f.normal_index, f.texcoord_index };
+            emitCorner(key, attrib.vertices.data(), attrib.normals.data(), attrib.texcoords.data(), unique, out);
+        }
+        // both parsers triangulate, so there is one material id per triangle
+        faceMaterials.insert(faceMaterials.end(), shape.mesh.material_ids.begin(), shape.mesh.material_ids.end());
+        // drop each shape's index list as soon as it is welded
+        vector<tinyobj::index_t>().swap(shape.mesh.indices);
+        vector<int>().swap(shape.mesh.material_ids);
+    }
+    rec.end();
+    return true;
+}
+
+// -------------------- streaming parse + weld --------------------
+// tinyobj reads the file line by line and hands every record to a callback; faces are welded
+// straight into the output, so only the v/vn/vt arrays (needed for random access) and the
+// weld table live next to the result. Nothing proportional to the corner count is kept twice.
+struct StreamingImport {
+    vector<float> positions, normals, texcoords;
+    VertexWelder unique;
+    MeshData* out = nullptr;
+    vector<int>* faceMaterials = nullptr;
+    vector<tinyobj::material_t>* materials = nullptr;
+    int material = -1;
+    size_t corners = 0, badFaces = 0;
+};
+
+static void streamVertex(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z, tinyobj::real_t) {
+    vector<float>& p = ((StreamingImport*)user)->positions;
+    p.push_back(x); p.push_back(y); p.push_back(z);
+}
+static void streamNormal(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z) {
+    vector<float>& n = ((StreamingImport*)user)->normals;
+    n.push_back(x); n.push_back(y); n.push_back(z);
+}
+static void streamTexcoord(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t) {
+    vector<float>& t = ((StreamingImport*)user)->texcoords;
+    t.push_back(x); t.push_back(y);
+}
+
+static void streamUseMaterial(void* user, const char*, int materialId) {
+    ((StreamingImport*)user)->material = materialId;
+}
+// called with every material loaded so far
+static void streamMaterialLib(void* user, const tinyobj::material_t* materials, int count) {
+    ((StreamingImport*)user)->materials->assign(materials, materials + count);
+}
+
+// raw OBJ index (1-based, negative = relative, 0 = absent) -> 0-based or -1; false if out of range
+static bool resolveStreamIndex(int raw, size_t count, int& out) {
+    if (raw == 0) { out = -1; return true; }
+    long long i = raw > 0 ? (long long)raw - 1 : (long long)count + raw;
+    if (i < 0 || i >= (long long)count) return false;
+    out = (int)i;
+    return true;
+}
+
+static void streamFace(void* user, tinyobj::index_t* indices, int count) {
+    StreamingImport& s = *(StreamingImport*)user;
+    if (count < 3 || count > 64) { s.badFaces++; return; }
+    VertexKey keys[64];
+    for (int i = 0; i < count; i++) {
+        int v, n, t;
+        // forward references cannot be resolved while streaming; such faces are skipped
+        if (!resolveStreamIndex(indices[i].vertex_index, s.positions.size() / 3, v) || v < 0 ||
+            !resolveStreamIndex(indices[i].normal_index, s.normals.size() / 3, n) ||
+            !resolveStreamIndex(indices[i].texcoord_index, s.texcoords.size() / 2, t)) { s.badFaces++; return; }
+        keys[i].v = v; keys[i].n = n; keys[i].t = t;
+    }
+    const float* pos = s.positions.data();
+    int order[6] = { 0, 1, 2, 0, 2, 3 };
+    if (count == 4) {
+        // same split as tinyobj::LoadObj: along the shorter diagonal
+        float d02 = 0.0f, d13 = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            float a = pos[3 * keys[2].v + k] - pos[3 * keys[0].v + k];
+            float b = pos[3 * keys[3].v + k] - pos[3 * keys[1].v + k];
+            d02 += a * a; d13 += b * b;
+        }
+        if (!(d02 < d13)) { int alt[6] = { 0, 1, 3, 1, 2, 3 }; memcpy(order, alt, sizeof(order)); }
+        for (int c = 0; c < 6; c++)
+            emitCorner(keys[order[c]], pos, s.normals.data(), s.texcoords.data(), s.unique, *s.out);
+        s.faceMaterials->push_back(s.material);
+        s.faceMaterials->push_back(s.material);
+        s.corners += 6;
+        return;
+    }
+    for (int k = 1; k + 1 < count; k++) {
+        emitCorner(keys[0], pos, s.normals.data(), s.texcoords.data(), s.unique, *s.out);
+        emitCorner(keys[k], pos, s.normals.data(), s.texcoords.data(), s.unique, *s.out);
+        emitCorner(keys[k + 1], pos, s.normals.data(), s.texcoords.data(), s.unique, *s.out);
+        s.faceMaterials->push_back(s.material);
+        s.corners += 3;
+    }
+}
+
+static bool importStreaming(const string& path, MeshData& out, size_t& corners,
+                            vector<int>& faceMaterials, vector<tinyobj::material_t>& materials) {
+    // a counting pre-pass sizes every buffer once, so nothing is reallocated (and briefly doubled)
+    ObjRecordCounts counts;
+    if (!countObjRecords(path, counts)) { cerr << "ERR: Cannot open file [" << path << "]\n"; return false; }
+    ifstream in(path, ios::binary);
+    if (!in) { cerr << "ERR: Cannot open file [" << path << "]\n"; return false; }
+
+    StreamingImport s;
+    s.out = &out;
+    s.faceMaterials = &faceMaterials;
+    s.materials = &materials;
+    faceMaterials.reserve(counts.triangles);
+    s.positions.reserve(counts.positions * 3);
+    s.normals.reserve(counts.normals * 3);
+    s.texcoords.reserve(counts.texcoords * 2);
+    out.indices.reserve(counts.triangles * 3);
+    // unique vertices: at least one per position, at most one per corner
+    size_t expected = max(counts.positions, min(counts.triangles * 3, max(counts.normals, counts.texcoords)));
+    out.vertices.reserve(expected * kMeshVertexFloats);
+    s.unique.reserve(expected);
+
+    tinyobj::callback_t cb;
+    cb.vertex_cb = streamVertex;
+    cb.normal_cb = streamNormal;
+    cb.texcoord_cb = streamTexcoord;
+    cb.index_cb = streamFace;
+    cb.usemtl_cb = streamUseMaterial;
+    cb.mtllib_cb = streamMaterialLib;
+    string warn, err;
+    string base = path.substr(0, path.find_last_of("/\\") + 1);
+    tinyobj::MaterialFileReader materialReader(base);
+    bool ok = tinyobj::LoadObjWithCallback(in, cb, &s, &materialReader, &warn, &err);
+    if (!warn.empty()) cerr << "WARN: " << warn << "\n";
+    if (!err.empty()) cerr << "ERR: " << err << "\n";
+    if (s.badFaces) cerr << "WARN: skipped " << s.badFaces << " faces with invalid or forward indices\n";
+    corners = s.corners;
+    return ok;
+}
+
+// -------------------- materials and submeshes --------------------
+static void copyName(char* dst, size_t size, const string& src) {
+    size_t n = min(src.size(), size - 1);
+    memcpy(dst, src.data(), n);
+    dst[n] = 0;
+    if (n < src.size()) cerr << "WARN: material string truncated: " << src << "\n";
+}
+
+static void convertMaterial(const tinyobj::material_t& m, MeshMaterial& out) {
+    copyName(out.name, sizeof(out.name), m.name);
+    for (int a = 0; a < 3; a++) out.baseColor[a] = m.diffuse[a];
+    out.metallic = m.metallic;
+    out.roughness = m.roughness;
+    const string& normal = !m.normal_texname.empty() ? m.normal_texname : m.bump_texname;
+    const string* maps[kMaterialTextureCount] = { &m.diffuse_texname, &normal, &m.metallic_texname, &m.roughness_texname, &m.ambient_texname };
+    for (int t = 0; t < kMaterialTextureCount; t++) copyName(out.textures[t], sizeof(out.textures[t]), *maps[t]);
+}
+
+// Stable-sort triangles by material and describe LOD 0 as one submesh per used material.
+static void buildSubmeshes(MeshData& out, const vector<int>& faceMaterials, const vector<tinyobj::material_t>& materials) {
+    out.materials.resize(materials.size());
+    for (size_t i = 0; i < materials.size(); i++) convertMaterial(materials[i], out.materials[i]);
+    size_t triCount = out.indices.size() / 3;
+    // faces without a (known) material share a default entry at the end of the table
+    uint32_t fallback = (uint32_t)out.materials.size();
+    vector<uint32_t> triMaterial(triCount, fallback);
+    bool needFallback = false;
+    for (size_t t = 0; t < triCount; t++) {
+        int m = t < faceMaterials.size() ? faceMaterials[t] : -1;
+        if (m >= 0 && (size_t)m < materials.size()) triMaterial[t] = (uint32_t)m;
+        else needFallback = true;
+    }
+    if (needFallback) {
+        out.materials.push_back(MeshMaterial());
+        copyName(out.materials.back().name, sizeof(out.materials.back().name), "default");
+    }
+
+    vector<uint32_t> start(out.materials.size() + 1, 0);
+    for (uint32_t m : triMaterial) start[m + 1]++;
+    for (size_t m = 0; m < out.materials.size(); m++) start[m + 1] += start[m];
+    out.submeshes.clear();
+    for (size_t m = 0; m < out.materials.size(); m++) {
+        if (start[m + 1] == start[m]) continue;
+        MeshSubmesh sub;
+        sub.material = (uint32_t)m;
+        sub.indexOffset = start[m] * 3;
+        sub.indexCount = (start[m + 1] - start[m]) * 3;
+        out.submeshes.push_back(sub);
+    }
+    vector<uint32_t> sorted(out.indices.size());
+    for (size_t t = 0; t < triCount; t++) {
+        uint32_t dst = start[triMaterial[t]]++;
+        memcpy(&sorted[3 * dst], &out.indices[3 * t], 3 * sizeof(uint32_t));
+    }
+    out.indices.swap(sorted);
+    out.lods.assign(1, MeshLod());
+    out.lods[0].indexCount = (uint32_t)out.indices.size();
+    out.lods[0].submeshCount = (uint32_t)out.submeshes.size();
+    out.lods[0].triangleCount = (uint32_t)triCount;
+}
+
+// Run an index-buffer pass on every submesh range separately, so no pass moves triangles across materials.
+template <class Pass>
+static void forEachSubmesh(MeshData& mesh, Pass pass) {
+    vector<uint32_t> range;
+    for (auto& sub : mesh.submeshes) {
+        range.assign(mesh.indices.begin() + sub.indexOffset, mesh.indices.begin() + sub.indexOffset + sub.indexCount);
+        pass(sub, range);
+        copy(range.begin(), range.end(), mesh.indices.begin() + sub.indexOffset);
+    }
+}
+
+// -------------------- LODs --------------------
+// Each submesh is simplified on its own (borders between materials stay in place); LOD n takes level n
+// of every submesh, or the coarsest level a submesh reached.
+static void buildLods(MeshData& out, const MeshImportOptions& opt) {
+    const int ratioCount = (int)(sizeof(kLodRatios) / sizeof(kLodRatios[0]));
+    size_t lod0Submeshes = out.lods[0].submeshCount;
+    vector<vector<SimplifiedLod>> chains(lod0Submeshes);
+    size_t levels = 0;
+    vector<uint32_t> range;
+    for (size_t i = 0; i < lod0Submeshes; i++) {
+        const MeshSubmesh& sub = out.submeshes[i];
+        range.assign(out.indices.begin() + sub.indexOffset, out.indices.begin() + sub.indexOffset + sub.indexCount);
+        buildLodChain(range, out.vertices, kMeshVertexFloats, kLodRatios, ratioCount, chains[i]);
+        levels = max(levels, chains[i].size());
+    }
+    cout << "  LODs: " << out.triangleCount();
+    for (size_t level = 0; level < levels; level++) {
+        MeshLod lod;
+        lod.indexOffset = (uint32_t)out.indices.size();
+        lod.submeshOffset = (uint32_t)out.submeshes.size();
+        for (size_t i = 0; i < lod0Submeshes; i++) {
+            MeshSubmesh sub;
+            sub.material = out.submeshes[i].material;
+            sub.indexOffset = (uint32_t)out.indices.size();
+            if (chains[i].empty()) {
+                // too small to simplify: every LOD keeps the full submesh
+                range.assign(out.indices.begin() + out.submeshes[i].indexOffset,
+                             out.indices.begin() + out.submeshes[i].indexOffset + out.submeshes[i].indexCount);
+            }
+            else {
+                SimplifiedLod& s = chains[i][min(level, chains[i].size() - 1)];
+                range = s.indices;
+                lod.error = max(lod.error, s.error);
+                if (opt.optimizeVertexCache) optimizeVertexCache(range, out.vertexCount());
+            }
+            sub.indexCount = (uint32_t)range.size();
+            out.indices.insert(out.indices.end(), range.begin(), range.end());
+            out.submeshes.push_back(sub);
+        }
+        lod.indexCount = (uint32_t)out.indices.size() - lod.indexOffset;
+        lod.submeshCount = (uint32_t)lod0Submeshes;
+        lod.triangleCount = lod.indexCount / 3;
+        out.lods.push_back(lod);
+        cout << " / " << lod.indexCount / 3 << " (error " << lod.error << ")";
+    }
+    cout << " triangles\n";
+}
+
+// -------------------- triangle strips --------------------
+// Every meshlet, or every submesh without meshlets, becomes its own run of strips ending in a
+// restart index, so all the ranges the renderer draws (LODs, submeshes, merged meshlet runs) stay
+// contiguous and only need their offsets rewritten.
+static void convertToStrips(MeshData& out) {
+    vector<uint32_t> strips;
+    strips.reserve(out.indices.size());
+    size_t stripCount = 0;
+    auto convert = [&](uint32_t& offset, uint32_t& count) {
+        uint32_t begin = (uint32_t)strips.size();
+        stripCount += stripifyTriangles(out.indices.data() + offset, count, strips);
+        offset = begin;
+        count = (uint32_t)strips.size() - begin;
+    };
+    for (MeshLod& lod : out.lods) {
+        uint32_t lodBegin = (uint32_t)strips.size();
+        for (uint32_t s = lod.submeshOffset; s < lod.submeshOffset + lod.submeshCount; s++) {
+            MeshSubmesh& sub = out.submeshes[s];
+            uint32_t subBegin = (uint32_t)strips.size();
+            if (sub.meshletCount == 0) convert(sub.indexOffset, sub.indexCount);
+            for (uint32_t m = sub.meshletOffset; m < sub.meshletOffset + sub.meshletCount; m++)
+                convert(out.meshlets[m].indexOffset, out.meshlets[m].indexCount);
+            sub.indexOffset = subBegin;
+            sub.indexCount = (uint32_t)strips.size() - subBegin;
+        }
+        lod.indexOffset = lodBegin;
+        lod.indexCount = (uint32_t)strips.size() - lodBegin;
+    }
+    size_t indexBytes = out.fitsShortIndices() ? 2 : 4;
+    cout << "  strips: " << stripCount << ", " << (float)out.indices.size() / 3 / max(stripCount, (size_t)1)
+         << " triangles each; indices " << out.indices.size() << " -> " << strips.size() << " ("
+         << out.indices.size() * indexBytes / 1024.0 << " -> " << strips.size() * indexBytes / 1024.0 << " KB)\n";
+    strips.shrink_to_fit();
+    out.indices.swap(strips);
+    out.strips = true;
+}
+
+// -------------------- driver --------------------
+bool importObj(const string& path, MeshData& out, const MeshImportOptions& opt, vector<MeshImportStage>* stages) {
+    out.vertices.clear();
+    out.indices.clear();
+    out.lods.clear();
+    out.submeshes.clear();
+    out.meshlets.clear();
+    out.materials.clear();
+    out.strips = false;
+    size_t corners = 0;
+    vector<int> faceMaterials;
+    vector<tinyobj::material_t> materials;
+    StageRecorder rec;
+    rec.stages = stages;
+    size_t rssBefore = currentRssBytes();
+    resetPeakRss();
+    // streaming welds while it parses, so it is a single stage
+    if (opt.streaming) rec.begin("parse+weld");
+    bool ok = opt.streaming ? importStreaming(path, out, corners, faceMaterials, materials)
+                            : importWhole(path, out, opt, corners, faceMaterials, materials, rec);
+    if (!ok) return false;
+    if (opt.streaming) rec.end();
+    size_t parsePeak = peakRssBytes();
+
+    size_t tripleVerts = out.vertexCount();
+    size_t removed = 0;
+    if (opt.weldEpsilon > 0.0f) {
+        rec.begin("epsilon weld");
+        removed = weldVertices(out, opt.weldEpsilon, &faceMaterials);
+        rec.end();
+    }
+    cout << "Imported " << path << ": " << out.triangleCount() << " triangles, "
+         << corners << " corners -> " << tripleVerts << " unique vertices";
+    if (opt.weldEpsilon > 0.0f) cout << " -> " << out.vertexCount() << " after epsilon weld (" << removed << " merged)";
+    cout << ", " << (out.fitsShortIndices() ? 16 : 32) << "-bit indices\n";
+    cout << "  " << (opt.streaming ? "streaming" : "full") << " parse+weld: peak RSS +"
+         << (parsePeak > rssBefore ? parsePeak - rssBefore : 0) / (1024.0 * 1024.0) << " MB, mesh buffers " << out.vertices.capacity() * sizeof(float) / (1024.0 * 1024.0)
+         << " + " << out.indices.capacity() * sizeof(uint32_t) / (1024.0 * 1024.0) << " MB\n";
+
+    rec.begin("normals");
+    if (opt.generateNormals) {
+        NormalStats ns = generateNormals(out.vertices, out.indices, kMeshVertexFloats, opt.creaseAngle);
+        if (ns.generated)
+            cout << "  normals: generated for " << ns.generated << " vertices, " << ns.split << " split at creases (> "
+                 << opt.creaseAngle << " deg)\n";
+    }
+    else {
+        for (size_t v = 0; v < out.vertexCount(); v++) {
+            float* n = &out.vertices[v * kMeshVertexFloats + 3];
+            if (n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f) n[1] = 1.0f;
+        }
+    }
+    rec.end();
+    if (opt.generateTangents) {
+        rec.begin("tangents");
+        size_t split = generateTangents(out.vertices, out.indices, kMeshVertexFloats);
+        rec.end();
+        cout << "  tangents: " << split << " vertices split at handedness seams\n";
+    }
+
+    rec.begin("submeshes");
+    buildSubmeshes(out, faceMaterials, materials);
+    vector<int>().swap(faceMaterials);
+    rec.end();
+    cout << "  materials: " << out.materials.size() << ", submeshes: " << out.submeshes.size() << "\n";
+
+    size_t vertexCount = out.vertexCount();
+    // the before/after analyses are left out of the optimization stages
+    if (opt.optimizeVertexCache) {
+        VertexCacheStats before = analyzeVertexCache(out.indices, vertexCount);
+        rec.begin("vertex cache");
+        forEachSubmesh(out, [&](const MeshSubmesh&, vector<uint32_t>& range) { optimizeVertexCache(range, vertexCount); });
+        rec.end();
+        VertexCacheStats after = analyzeVertexCache(out.indices, vertexCount);
+        cout << "  vertex cache: ACMR " << before.acmr << " -> " << after.acmr
+             << ", ATVR " << before.atvr << " -> " << after.atvr << "\n";
+    }
+    if (opt.optimizeOverdraw && opt.optimizeVertexCache) {
+        float before = analyzeOverdraw(out.indices, out.vertices, kMeshVertexFloats);
+        float acmrBefore = analyzeVertexCache(out.indices, vertexCount).acmr;
+        rec.begin("overdraw");
+        forEachSubmesh(out, [&](const MeshSubmesh&, vector<uint32_t>& range) { optimizeOverdraw(range, out.vertices, kMeshVertexFloats); });
+        rec.end();
+        float after = analyzeOverdraw(out.indices, out.vertices, kMeshVertexFloats);
+        cout << "  overdraw: " << before << " -> " << after << " (ACMR " << acmrBefore << " -> "
+             << analyzeVertexCache(out.indices, vertexCount).acmr << ")\n";
+    }
+    rec.begin("bounds");
+    out.bounds = computeBounds(out.vertices, kMeshVertexFloats);
+    rec.end();
+
+    if (opt.generateLods) {
+        rec.begin("lods");
+        buildLods(out, opt);
+        rec.end();
+    }
+    if (opt.buildMeshlets) {
+        rec.begin("meshlets");
+        forEachSubmesh(out, [&](MeshSubmesh& sub, vector<uint32_t>& range) {
+            sub.meshletOffset = (uint32_t)out.meshlets.size();
+            buildMeshlets(range, out.vertices, kMeshVertexFloats, sub.indexOffset, out.meshlets);
+            sub.meshletCount = (uint32_t)out.meshlets.size() - sub.meshletOffset;
+        });
+        rec.end();
+        size_t lod0Meshlets = 0, coned = 0;
+        for (uint32_t i = 0; i < out.lods[0].submeshCount; i++) lod0Meshlets += out.submeshes[i].meshletCount;
+        for (auto& m : out.meshlets) coned += m.coneCutoff < 1.0f;
+        cout << "  meshlets: " << lod0Meshlets << " in LOD 0 (" << out.meshlets.size() << " total), "
+             << (float)out.triangleCount() / max(lod0Meshlets, (size_t)1) << " triangles each, "
+             << coned << " with a backface cone\n";
+    }
+    // after the last triangle reorder, so the numbering follows the order every LOD is drawn in
+    if (opt.optimizeVertexFetch) {
+        size_t vertexBytes = kMeshVertexFloats * sizeof(float);
+        vector<uint32_t> lod0(out.indices.begin(), out.indices.begin() + out.lods[0].indexCount);
+        float before = analyzeVertexFetch(lod0, out.vertexCount(), vertexBytes);
+        rec.begin("vertex fetch");
+        optimizeVertexFetch(out.vertices, out.indices, kMeshVertexFloats);
+        rec.end();
+        lod0.assign(out.indices.begin(), out.indices.begin() + out.lods[0].indexCount);
+        cout << "  vertex fetch: LOD 0 overfetch " << before << " -> " << analyzeVertexFetch(lod0, out.vertexCount(), vertexBytes)
+             << ", final ACMR " << analyzeVertexCache(lod0, out.vertexCount()).acmr << "\n";
+    }
+    if (opt.triangleStrips) {
+        rec.begin("strips");
+        convertToStrips(out);
+        rec.end();
+    }
+    return true;
+}
+
+// -------------------- positional (epsilon) welding --------------------
+// Vertices are bucketed on a grid with cell size = epsilon; a match can only live in the 27 neighbouring cells.
+static uint64_t cellKey(int64_t x, int64_t y, int64_t z) {
+    const uint64_t mask = (1ull << 21) - 1;
+    return ((uint64_t)x & mask) | (((uint64_t)y & mask) << 21) | (((uint64_t)z & mask) << 42);
+}
+
+static bool nearlyEqual(const float* a, const float* b, float eps) {
+    for (int i = 0; i < kMeshVertexFloats; i++)
+        if (fabsf(a[i] - b[i]) > eps) return false;
+    return true;
+}
+
+size_t weldVertices(MeshData& mesh, float epsilon, vector<int>* triangleTags) {
+    size_t count = mesh.vertexCount();
+    if (count == 0 || epsilon <= 0.0f) return 0;
+    float inv = 1.0f / epsilon;
+    unordered_map<uint64_t, uint32_t> head;   // cell -> first kept vertex in that cell
+    head.reserve(count);
+    vector<uint32_t> next;                    // per kept vertex: next kept vertex in the same cell
+    vector<uint32_t> remap(count);
+    vector<float> kept;
+    kept.reserve(mesh.vertices.size());
+    const uint32_t none = 0xFFFFFFFFu;
+
+    for (size_t i = 0; i < count; i++) {
+        const float* v = &mesh.vertices[i * kMeshVertexFloats];
+        int64_t cx = (int64_t)floorf(v[0] * inv), cy = (int64_t)floorf(v[1] * inv), cz = (int64_t)floorf(v[2] * inv);
+        uint32_t match = none;
+        for (int dz = -1; dz <= 1 && match == none; dz++)
+            for (int dy = -1; dy <= 1 && match == none; dy++)
+                for (int dx = -1; dx <= 1 && match == none; dx++) {
+                    auto it = head.find(cellKey(cx + dx, cy + dy, cz + dz));
+                    if (it == head.end()) continue;
+                    for (uint32_t j = it->second; j != none; j = next[j])
+                        if (nearlyEqual(v, &kept[j * kMeshVertexFloats], epsilon)) { match = j; break; }
+                }
+        if (match != none) { remap[i] = match; continue; }
+        uint32_t id = (uint32_t)next.size();
+        uint64_t key = cellKey(cx, cy, cz);
+        auto it = head.find(key);
+        next.push_back(it != head.end() ? it->second : none);
+        head[key] = id;
+        kept.insert(kept.end(), v, v + kMeshVertexFloats);
+        remap[i] = id;
+    }
+
+    // rewrite indices, dropping triangles that collapsed to a line or a point
+    size_t w = 0;
+    for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+        uint32_t a = remap[mesh.indices[t]], b = remap[mesh.indices[t + 1]], c = remap[mesh.indices[t + 2]];
+        if (a == b || b == c || a == c) continue;
+        if (triangleTags && t / 3 < triangleTags->size()) (*triangleTags)[w / 3] = (*triangleTags)[t / 3];
+        mesh.indices[w++] = a; mesh.indices[w++] = b; mesh.indices[w++] = c;
+    }
+    mesh.indices.resize(w);
+    if (triangleTags && triangleTags->size() > w / 3) triangleTags->resize(w / 3);
+    mesh.vertices.swap(kept);
+    return count - mesh.vertexCount();
+}
+
+MeshBounds computeBounds(const vector<float>& vertices, int stride) {
+    MeshBounds b;
+    size_t count = vertices.size() / stride;
+    if (count == 0) return b;
+    for (int k = 0; k < 3; k++) b.min[k] = b.max[k] = vertices[k];
+    for (size_t v = 1; v < count; v++) {
+        const float* p = &vertices[v * stride];
+        for (int k = 0; k < 3; k++) {
+            if (p[k] < b.min[k]) b.min[k] = p[k];
+            if (p[k] > b.max[k]) b.max[k] = p[k];
+        }
+    }
+
+    // Ritter: start from the most separated pair of axis-extreme points, then grow over outliers
+    size_t lo[3] = { 0, 0, 0 }, hi[3] = { 0, 0, 0 };
+    for (size_t v = 1; v < count; v++)
+        for (int k = 0; k < 3; k++) {
+            if (vertices[v * stride + k] < vertices[lo[k] * stride + k]) lo[k] = v;
+            if (vertices[v * stride + k] > vertices[hi[k] * stride + k]) hi[k] = v;
+        }
+    auto dist2 = [&](const float* a, const float* c) {
+        return (a[0] - c[0]) * (a[0] - c[0]) + (a[1] - c[1]) * (a[1] - c[1]) + (a[2] - c[2]) * (a[2] - c[2]);
+    };
+    int axis = 0;
+    for (int k = 1; k < 3; k++)
+        if (dist2(&vertices[lo[k] * stride], &vertices[hi[k] * stride]) > dist2(&vertices[lo[axis] * stride], &vertices[hi[axis] * stride])) axis = k;
+    const float* a = &vertices[lo[axis] * stride];
+    const float* c = &vertices[hi[axis] * stride];
+    float center[3] = { 0.5f * (a[0] + c[0]), 0.5f * (a[1] + c[1]), 0.5f * (a[2] + c[2]) };
+    float radius = 0.5f * sqrtf(dist2(a, c));
+    for (size_t v = 0; v < count; v++) {
+        const float* p = &vertices[v * stride];
+        float d2 = dist2(p, center);
+        if (d2 <= radius * radius) continue;
+        float d = sqrtf(d2), grown = 0.5f * (radius + d);
+        for (int k = 0; k < 3; k++) center[k] += (grown - radius) / d * (p[k] - center[k]);
+        radius = grown;
+    }
+
+    float boxCenter[3], boxRadius2 = 0.0f;
+    for (int k = 0; k < 3; k++) boxCenter[k] = 0.5f * (b.min[k] + b.max[k]);
+    for (size_t v = 0; v < count; v++) boxRadius2 = max(boxRadius2, dist2(&vertices[v * stride], boxCenter));
+    if (sqrtf(boxRadius2) < radius) { memcpy(center, boxCenter, sizeof(center)); radius = sqrtf(boxRadius2); }
+    memcpy(b.center, center, sizeof(center));
+    b.radius = radius * 1.0001f;   // float error in the growth steps
+    return b;
+}
+
+MeshView makeMeshView(const MeshData& mesh, vector<uint16_t>& scratch) {
+    MeshView view;
+    view.vertices = mesh.vertices.data();
+    view.vertexCount = mesh.vertexCount();
+    view.indexCount = mesh.indices.size();
+    view.lods = mesh.lods.data();
+    view.lodCount = mesh.lods.size();
+    view.submeshes = mesh.submeshes.data();
+    view.submeshCount = mesh.submeshes.size();
+    view.meshlets = mesh.meshlets.data();
+    view.meshletCount = mesh.meshlets.size();
+    view.materials = mesh.materials.data();
+    view.materialCount = mesh.materials.size();
+    view.bounds = mesh.bounds;
+    view.strips = mesh.strips;
+    if (mesh.fitsShortIndices()) {
+        packShortIndices(mesh.indices, scratch);
+        view.indices = scratch.data();
+        view.indexSize = 2;
+    }
+    else {
+        view.indices = mesh.indices.data();
+        view.indexSize = 4;
+    }
+    return view;
+}
+
+void packShortIndices(const vector<uint32_t>& in, vector<uint16_t>& out) {
+    out.resize(in.size());
+    for (size_t i = 0; i < in.size(); i++) out[i] = (uint16_t)in[i];
+}
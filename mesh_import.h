@@ -0,0 +1,139 @@
+// mesh_import.h
+// CPU-side mesh import: OBJ -> welded, indexed vertex/index streams.
+// No GL dependency, so the same code path can be used by tools and benchmarks.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "material.h"
+#include "meshlet.h"
+
+// interleaved vertex format: pos(3), norm(3), uv(2), tangent(4) => stride = 12 floats
+// (tangent.w is the bitangent sign, see mesh_tangents.h)
+const int kMeshVertexFloats = 12;
+
+struct MeshBounds {
+    float min[3] = { 0, 0, 0 };
+    float max[3] = { 0, 0, 0 };
+    float center[3] = { 0, 0, 0 };   // bounding sphere
+    float radius = 0.0f;
+};
+
+// The triangles of one material within one LOD: a range of the index buffer and its meshlets.
+struct MeshSubmesh {
+    uint32_t material = 0;        // index into MeshData::materials
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    uint32_t meshletOffset = 0;   // meshlets covering exactly this index range
+    uint32_t meshletCount = 0;
+    uint32_t reserved = 0;
+};
+
+// One level of detail: a range of the index buffer over the shared vertex buffer, split into submeshes.
+struct MeshLod {
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;           // simplification error relative to LOD 0, mesh units
+    uint32_t submeshOffset = 0;
+    uint32_t submeshCount = 0;
+    uint32_t triangleCount = 0;   // indexCount / 3 for lists; strips need it stored
+};
+
+struct MeshData {
+    std::vector<float> vertices;     // kMeshVertexFloats per vertex
+    std::vector<uint32_t> indices;   // triangle list (or strips); LODs follow LOD 0 back to back
+    std::vector<MeshLod> lods;       // lods[0] is the full mesh; empty = the whole index buffer
+    std::vector<MeshSubmesh> submeshes;   // per LOD, see MeshLod::submeshOffset
+    std::vector<Meshlet> meshlets;        // per submesh, see MeshSubmesh::meshletOffset
+    std::vector<MeshMaterial> materials;  // from the MTL; triangles without one use a default entry
+    MeshBounds bounds;               // position AABB and bounding sphere
+    bool strips = false;             // indices are triangle strips ended by kStripRestartIndex (mesh_optimize.h)
+    size_t vertexCount() const { return vertices.size() / kMeshVertexFloats; }
+    size_t triangleCount() const { return lods.empty() ? indices.size() / 3 : lods[0].triangleCount; }
+    // 16-bit indices are enough when every vertex fits below the 0xFFFF restart value
+    bool fitsShortIndices() const { return vertexCount() < 0xFFFF; }
+};
+
+// Read-only view of GPU-ready streams; indices are already at their upload width (2 or 4 bytes).
+// Points either into a MeshData (+ packed scratch indices) or straight into a mapped mesh cache.
+struct MeshView {
+    const float* vertices = nullptr;
+    size_t vertexCount = 0;
+    const void* indices = nullptr;
+    size_t indexCount = 0;
+    int indexSize = 4;
+    const MeshLod* lods = nullptr;
+    size_t lodCount = 0;
+    const MeshSubmesh* submeshes = nullptr;
+    size_t submeshCount = 0;
+    const Meshlet* meshlets = nullptr;
+    size_t meshletCount = 0;
+    const MeshMaterial* materials = nullptr;
+    size_t materialCount = 0;
+    MeshBounds bounds;
+    bool strips = false;   // draw as GL_TRIANGLE_STRIP with primitive restart at the all-ones index
+};
+
+struct MeshImportOptions {
+    // parse with the multithreaded parser (obj_parser.h) instead of tinyobj::LoadObj
+    bool parallelParse = true;
+    // stream records through tinyobj::LoadObjWithCallback and weld on the fly instead of building
+    // the whole attrib_t/shape_t first: lowest peak memory, single-threaded
+    bool streaming = false;
+    // > 0: additionally merge vertices whose position, normal and uv all lie within this distance
+    float weldEpsilon = 0.0f;
+    // compute smooth normals for vertices the OBJ gives none (mesh_tangents.h); (0, 1, 0) when off
+    bool generateNormals = true;
+    // faces meeting at a sharper angle than this (degrees) do not share generated normals
+    float creaseAngle = 60.0f;
+    // fill the tangent frames for normal mapping (mesh_tangents.h); zero when off
+    bool generateTangents = true;
+    // reorder triangles for post-transform vertex cache reuse
+    bool optimizeVertexCache = true;
+    // sort triangle clusters to reduce overdraw (needs optimizeVertexCache to find clusters)
+    bool optimizeOverdraw = true;
+    // append simplified LODs (kLodRatios of the full triangle count) to the index buffer
+    bool generateLods = true;
+    // split every LOD into meshlets (meshlet.h) for cluster culling; the last triangle reorder
+    bool buildMeshlets = true;
+    // renumber vertices in first-use order of the final triangle order (every LOD, after meshlets)
+    // for vertex fetch locality
+    bool optimizeVertexFetch = true;
+    // last: rewrite every meshlet (or submesh, without meshlets) as triangle strips joined by
+    // primitive restart; an alternative index mode, off by default
+    bool triangleStrips = false;
+};
+
+// target triangle ratios of the generated LOD chain
+const float kLodRatios[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+
+// Cost of one importObj stage ("parse", "weld", "normals", ..., "meshlets", "strips"), for benchmarks.
+struct MeshImportStage {
+    const char* name = "";
+    double ms = 0.0;
+    size_t peakRssBytes = 0;     // RSS high-water mark during the stage (since process start where it cannot be reset)
+    size_t allocations = 0;      // see allocationCounters() in mem_stats.h
+    size_t allocatedBytes = 0;
+};
+
+// Parse an OBJ (plus its MTL) and build a compact unique-vertex buffer with a real index buffer.
+// When stages is given, the stages that ran are appended to it in order.
+bool importObj(const std::string& path, MeshData& out, const MeshImportOptions& opt = MeshImportOptions(),
+               std::vector<MeshImportStage>* stages = nullptr);
+
+// Position AABB and bounding sphere (Ritter's, or the AABB-centred one when tighter) of an
+// interleaved vertex buffer.
+MeshBounds computeBounds(const std::vector<float>& vertices, int stride);
+
+// View of a MeshData for upload; 16-bit indices are packed into scratch when they fit.
+MeshView makeMeshView(const MeshData& mesh, std::vector<uint16_t>& scratch);
+
+// Merge near-identical vertices of an already indexed mesh; returns the number of vertices removed.
+// Triangles that collapse are dropped; triangleTags (one value per triangle) is compacted alongside.
+size_t weldVertices(MeshData& mesh, float epsilon, std::vector<int>* triangleTags = nullptr);
+
+// Pack 32-bit indices into 16-bit ones (caller checks fitsShortIndices()).
+void packShortIndices(const std::vector<uint32_t>& in, std::vector<uint16_t>& out);
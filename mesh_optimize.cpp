@@ -0,0 +1,363 @@
+// mesh_optimize.cpp
+// Post-transform vertex cache optimization (Tipsify), overdraw cluster sorting, vertex fetch
+// remapping, the analyzers used to report each of them, and the strip converter.
+
+#include "mesh_optimize.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// -------------------- vertex -> triangle adjacency --------------------
+struct TriangleAdjacency {
+    vector<uint32_t> offsets;    // vertexCount + 1 entries
+    vector<uint32_t> triangles;  // triangle ids grouped by vertex
+};
+static void buildAdjacency(const vector<uint32_t>& indices, size_t vertexCount, TriangleAdjacency& adj) {
+    adj.offsets.assign(vertexCount + 1, 0);
+    for (uint32_t v : indices) adj.offsets[v + 1]++;
+    for (size_t v = 0; v < vertexCount; v++) adj.offsets[v + 1] += adj.offsets[v];
+    adj.triangles.resize(indices.size());
+    vector<uint32_t> fill(adj.offsets.begin(), adj.offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) adj.triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+}
+
+// -------------------- FIFO cache analysis --------------------
+VertexCacheStats analyzeVertexCache(const vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty()) return stats;
+    // a vertex is in the FIFO if it was pushed less than cacheSize pushes ago
+    vector<uint32_t> pushedAt(vertexCount, 0);
+    vector<bool> used(vertexCount, false);
+    uint32_t pushes = cacheSize + 1, misses = 0, unique = 0;
+    for (uint32_t v : indices) {
+        if (!used[v]) { used[v] = true; unique++; }
+        if (pushes - pushedAt[v] > cacheSize) { pushedAt[v] = pushes++; misses++; }
+    }
+    stats.acmr = (float)misses / (float)(indices.size() / 3);
+    stats.atvr = unique ? (float)misses / (float)unique : 0.0f;
+    return stats;
+}
+
+// -------------------- Tipsify --------------------
+// Fans around a vertex, then continues with the candidate vertex that is still in cache and has the
+// most remaining triangles; dead ends fall back to recently emitted vertices, then to input order.
+static int nextFanVertex(const vector<uint32_t>& candidates, const vector<uint32_t>& live, const vector<uint32_t>& cacheTime,
+                         uint32_t stamp, unsigned cacheSize, vector<uint32_t>& deadEnd, uint32_t& cursor, size_t vertexCount) {
+    int best = -1, bestPriority = -1;
+    for (uint32_t v : candidates) {
+        if (live[v] == 0) continue;
+        int priority = 0;
+        // still resident after emitting its remaining triangles (each can push up to 2 new vertices)?
+        if (stamp - cacheTime[v] + 2 * live[v] <= cacheSize) priority = (int)(stamp - cacheTime[v]);
+        if (priority > bestPriority) { bestPriority = priority; best = (int)v; }
+    }
+    if (best >= 0) return best;
+    while (!deadEnd.empty()) {
+        uint32_t v = deadEnd.back(); deadEnd.pop_back();
+        if (live[v] > 0) return (int)v;
+    }
+    while (cursor < vertexCount) {
+        if (live[cursor] > 0) return (int)cursor;
+        cursor++;
+    }
+    return -1;
+}
+
+void optimizeVertexCache(vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize) {
+    if (indices.size() < 3 || vertexCount == 0) return;
+    TriangleAdjacency adj;
+    buildAdjacency(indices, vertexCount, adj);
+    vector<uint32_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) live[v] = adj.offsets[v + 1] - adj.offsets[v];
+    vector<uint32_t> cacheTime(vertexCount, 0);
+    vector<bool> emitted(indices.size() / 3, false);
+    vector<uint32_t> deadEnd, candidates, out;
+    deadEnd.reserve(indices.size());
+    out.reserve(indices.size());
+    uint32_t stamp = cacheSize + 1, cursor = 0;
+
+    int fan = 0;
+    while (fan >= 0) {
+        candidates.clear();
+        for (uint32_t k = adj.offsets[fan]; k < adj.offsets[fan + 1]; k++) {
+            uint32_t t = adj.triangles[k];
+            if (emitted[t]) continue;
+            for (int c = 0; c < 3; c++) {
+                uint32_t v = indices[3 * t + c];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (stamp - cacheTime[v] > cacheSize) cacheTime[v] = stamp++;
+            }
+            emitted[t] = true;
+        }
+        fan = nextFanVertex(candidates, live, cacheTime, stamp, cacheSize, deadEnd, cursor, vertexCount);
+    }
+    indices.swap(out);
+}
+
+// -------------------- overdraw analysis (software rasterizer) --------------------
+const int kOverdrawGrid = 256;
+
+struct OverdrawCounter {
+    vector<float> depth;
+    size_t covered = 0, shaded = 0;
+    OverdrawCounter() : depth(kOverdrawGrid * kOverdrawGrid, 1e30f) {}
+    void rasterize(const float* a, const float* b, const float* c) {
+        // a/b/c: (u, v, depth) in grid units; only counter-clockwise (front facing) triangles
+        float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+        if (area <= 0.0f) return;
+        int x0 = max(0, (int)floorf(min(a[0], min(b[0], c[0])))), x1 = min(kOverdrawGrid - 1, (int)ceilf(max(a[0], max(b[0], c[0]))));
+        int y0 = max(0, (int)floorf(min(a[1], min(b[1], c[1])))), y1 = min(kOverdrawGrid - 1, (int)ceilf(max(a[1], max(b[1], c[1]))));
+        float inv = 1.0f / area;
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                float px = x + 0.5f, py = y + 0.5f;
+                float w0 = (c[0] - b[0]) * (py - b[1]) - (c[1] - b[1]) * (px - b[0]);
+                float w1 = (a[0] - c[0]) * (py - c[1]) - (a[1] - c[1]) * (px - c[0]);
+                float w2 = (b[0] - a[0]) * (py - a[1]) - (b[1] - a[1]) * (px - a[0]);
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+                float z = (w0 * a[2] + w1 * b[2] + w2 * c[2]) * inv;
+                float& d = depth[y * kOverdrawGrid + x];
+                if (d == 1e30f) covered++;
+                if (z < d) { d = z; shaded++; }
+            }
+        }
+    }
+};
+
+float analyzeOverdraw(const vector<uint32_t>& indices, const vector<float>& vertices, int stride) {
+    size_t vertexCount = vertices.size() / stride;
+    if (indices.empty() || vertexCount == 0) return 0.0f;
+    float lo[3] = { 1e30f, 1e30f, 1e30f }, hi[3] = { -1e30f, -1e30f, -1e30f };
+    for (size_t v = 0; v < vertexCount; v++)
+        for (int k = 0; k < 3; k++) { lo[k] = min(lo[k], vertices[v * stride + k]); hi[k] = max(hi[k], vertices[v * stride + k]); }
+    float extent = max(hi[0] - lo[0], max(hi[1] - lo[1], hi[2] - lo[2]));
+    float scale = extent > 0.0f ? (kOverdrawGrid - 1) / extent : 0.0f;
+    // camera on +z, -z, +x, -x, +y, -y: (u, v, depth) as signed axis picks of the normalized position
+    static const int axis[6][3] = { {0, 1, 2}, {0, 1, 2}, {2, 1, 0}, {2, 1, 0}, {0, 2, 1}, {0, 2, 1} };
+    static const float sign[6][3] = { {1, 1, -1}, {-1, 1, 1}, {-1, 1, -1}, {1, 1, 1}, {1, -1, -1}, {1, 1, 1} };
+    size_t covered = 0, shaded = 0;
+    for (int view = 0; view < 6; view++) {
+        OverdrawCounter counter;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            float p[3][3];
+            for (int c = 0; c < 3; c++) {
+                const float* src = &vertices[indices[t + c] * stride];
+                for (int k = 0; k < 3; k++) {
+                    int ax = axis[view][k];
+                    float n = (src[ax] - lo[ax]) * scale;
+                    // mirrored axes are flipped back into the grid
+                    p[c][k] = sign[view][k] > 0 ? n : (kOverdrawGrid - 1) - n;
+                }
+            }
+            counter.rasterize(p[0], p[1], p[2]);
+        }
+        covered += counter.covered; shaded += counter.shaded;
+    }
+    return covered ? (float)shaded / (float)covered : 0.0f;
+}
+
+// -------------------- overdraw optimization --------------------
+// Number of post-transform misses of triangle t given the FIFO state; updates the state.
+static unsigned simulateTriangle(const uint32_t* tri, vector<uint32_t>& pushedAt, uint32_t& pushes, unsigned cacheSize) {
+    unsigned misses = 0;
+    for (int c = 0; c < 3; c++) {
+        uint32_t v = tri[c];
+        if (pushes - pushedAt[v] > cacheSize) { pushedAt[v] = pushes++; misses++; }
+    }
+    return misses;
+}
+
+void optimizeOverdraw(vector<uint32_t>& indices, const vector<float>& vertices, int stride, float threshold) {
+    size_t vertexCount = vertices.size() / stride;
+    size_t triCount = indices.size() / 3;
+    if (triCount < 2 || vertexCount == 0) return;
+
+    // hard boundaries: a triangle with three misses starts a new fan/strip of the cache-optimized order
+    vector<size_t> hard;
+    vector<uint32_t> pushedAt(vertexCount, 0);
+    uint32_t pushes = kVertexCacheSize + 1;
+    for (size_t t = 0; t < triCount; t++)
+        if (simulateTriangle(&indices[3 * t], pushedAt, pushes, kVertexCacheSize) == 3 || t == 0) hard.push_back(t);
+    hard.push_back(triCount);
+
+    // soft boundaries: split a hard cluster as soon as the local ACMR (cache flushed at the split)
+    // is within threshold of the whole cluster's ACMR
+    vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); h++) {
+        size_t start = hard[h], end = hard[h + 1];
+        pushes += kVertexCacheSize + 1;
+        unsigned clusterMisses = 0;
+        for (size_t t = start; t < end; t++) clusterMisses += simulateTriangle(&indices[3 * t], pushedAt, pushes, kVertexCacheSize);
+        float clusterLimit = threshold * (float)clusterMisses / (float)(end - start);
+        pushes += kVertexCacheSize + 1;
+        unsigned misses = 0;
+        clusters.push_back(start);
+        for (size_t t = start; t < end; t++) {
+            misses += simulateTriangle(&indices[3 * t], pushedAt, pushes, kVertexCacheSize);
+            if (t + 1 < end && (float)misses / (float)(t + 1 - clusters.back()) <= clusterLimit) {
+                clusters.push_back(t + 1);
+                pushes += kVertexCacheSize + 1;
+                misses = 0;
+            }
+        }
+    }
+    clusters.push_back(triCount);
+
+    // sort key: how far out the cluster sits along its own average normal
+    float meshCenter[3] = { 0, 0, 0 };
+    double areaSum = 0.0;
+    vector<float> clusterKey(clusters.size() - 1);
+    vector<float> centroids(clusterKey.size() * 3), normals(clusterKey.size() * 3);
+    for (size_t c = 0; c + 1 < clusters.size(); c++) {
+        float cen[3] = { 0, 0, 0 }, nrm[3] = { 0, 0, 0 };
+        float area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            const float* a = &vertices[indices[3 * t] * stride];
+            const float* b = &vertices[indices[3 * t + 1] * stride];
+            const float* d = &vertices[indices[3 * t + 2] * stride];
+            float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float w = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; k++) {
+                cen[k] += (a[k] + b[k] + d[k]) * (w / 3.0f);
+                nrm[k] += n[k];
+            }
+            area += w;
+        }
+        for (int k = 0; k < 3; k++) {
+            meshCenter[k] += cen[k];
+            centroids[3 * c + k] = area > 0.0f ? cen[k] / area : 0.0f;
+            normals[3 * c + k] = nrm[k];
+        }
+        areaSum += area;
+    }
+    for (int k = 0; k < 3; k++) meshCenter[k] = areaSum > 0.0 ? (float)(meshCenter[k] / areaSum) : 0.0f;
+    for (size_t c = 0; c < clusterKey.size(); c++) {
+        const float* n = &normals[3 * c];
+        float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        float dp = 0.0f;
+        for (int k = 0; k < 3; k++) dp += (centroids[3 * c + k] - meshCenter[k]) * n[k];
+        clusterKey[c] = len > 0.0f ? dp / len : 0.0f;
+    }
+
+    vector<uint32_t> order(clusterKey.size());
+    for (size_t c = 0; c < order.size(); c++) order[c] = (uint32_t)c;
+    stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return clusterKey[a] > clusterKey[b]; });
+    vector<uint32_t> out;
+    out.reserve(indices.size());
+    for (uint32_t c : order)
+        out.insert(out.end(), indices.begin() + 3 * clusters[c], indices.begin() + 3 * clusters[c + 1]);
+    indices.swap(out);
+}
+
+// -------------------- vertex fetch --------------------
+float analyzeVertexFetch(const vector<uint32_t>& indices, size_t vertexCount, size_t vertexBytes) {
+    const size_t lineBytes = 64;
+    const int lines = 128;   // 8 KB fully associative LRU
+    size_t lineTag[lines], lineUse[lines];
+    for (int i = 0; i < lines; i++) { lineTag[i] = ~(size_t)0; lineUse[i] = 0; }
+    vector<uint32_t> pushedAt(vertexCount, 0);
+    vector<bool> used(vertexCount, false);
+    uint32_t pushes = kVertexCacheSize + 1;
+    size_t clock = 0, fetched = 0, unique = 0;
+    for (uint32_t v : indices) {
+        if (!used[v]) { used[v] = true; unique++; }
+        if (pushes - pushedAt[v] <= kVertexCacheSize) continue;
+        pushedAt[v] = pushes++;
+        size_t first = v * vertexBytes / lineBytes, last = (v * vertexBytes + vertexBytes - 1) / lineBytes;
+        for (size_t line = first; line <= last; line++) {
+            int hit = -1, victim = 0;
+            for (int i = 0; i < lines; i++) {
+                if (lineTag[i] == line) { hit = i; break; }
+                if (lineUse[i] < lineUse[victim]) victim = i;
+            }
+            if (hit < 0) { hit = victim; lineTag[hit] = line; fetched += lineBytes; }
+            lineUse[hit] = ++clock;
+        }
+    }
+    return unique ? (float)fetched / (float)(unique * vertexBytes) : 0.0f;
+}
+
+size_t optimizeVertexFetch(vector<float>& vertices, vector<uint32_t>& indices, int stride) {
+    size_t vertexCount = vertices.size() / stride;
+    const uint32_t none = 0xFFFFFFFFu;
+    vector<uint32_t> remap(vertexCount, none);
+    vector<float> out;
+    out.reserve(vertices.size());
+    uint32_t next = 0;
+    for (uint32_t& v : indices) {
+        if (remap[v] == none) {
+            remap[v] = next++;
+            out.insert(out.end(), vertices.begin() + (size_t)v * stride, vertices.begin() + (size_t)(v + 1) * stride);
+        }
+        v = remap[v];
+    }
+    vertices.swap(out);
+    return next;
+}
+
+// -------------------- triangle strips --------------------
+static const uint32_t kNoTriangle = 0xFFFFFFFFu;
+
+// An unvisited triangle with the directed edge a -> b, or kNoTriangle.
+static uint32_t findEdge(const TriangleAdjacency& adj, const vector<uint32_t>& local, const vector<bool>& done, uint32_t a, uint32_t b) {
+    for (uint32_t i = adj.offsets[a]; i < adj.offsets[a + 1]; i++) {
+        uint32_t t = adj.triangles[i];
+        if (done[t]) continue;
+        const uint32_t* tri = &local[3 * t];
+        for (int k = 0; k < 3; k++)
+            if (tri[k] == a && tri[(k + 1) % 3] == b) return t;
+    }
+    return kNoTriangle;
+}
+
+size_t stripifyTriangles(const uint32_t* indices, size_t indexCount, vector<uint32_t>& out) {
+    // local vertex ids keep the adjacency as small as the range (meshlets are converted one by one)
+    vector<uint32_t> vertices(indices, indices + indexCount);
+    sort(vertices.begin(), vertices.end());
+    vertices.erase(unique(vertices.begin(), vertices.end()), vertices.end());
+    vector<uint32_t> local(indexCount);
+    for (size_t i = 0; i < indexCount; i++)
+        local[i] = (uint32_t)(lower_bound(vertices.begin(), vertices.end(), indices[i]) - vertices.begin());
+    size_t triCount = indexCount / 3;
+    vector<bool> done(triCount, false);
+    for (size_t t = 0; t < triCount; t++) {
+        const uint32_t* tri = &local[3 * t];
+        done[t] = tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2];
+    }
+    TriangleAdjacency adj;
+    buildAdjacency(local, vertices.size(), adj);
+
+    size_t strips = 0;
+    vector<uint32_t> strip;
+    for (size_t start = 0; start < triCount; start++) {
+        if (done[start]) continue;
+        done[start] = true;
+        const uint32_t* tri = &local[3 * start];
+        // start on the rotation whose last edge has a neighbour; triangle 1 of a strip is odd, so it
+        // needs the reversed edge
+        int rot = 0;
+        for (int r = 0; r < 3; r++)
+            if (findEdge(adj, local, done, tri[(r + 2) % 3], tri[(r + 1) % 3]) != kNoTriangle) { rot = r; break; }
+        strip.assign({ tri[rot], tri[(rot + 1) % 3], tri[(rot + 2) % 3] });
+        while (true) {
+            // GL winds odd triangles of a strip as (1, 0, 2): they continue over the reversed edge
+            uint32_t p = strip[strip.size() - 2], q = strip.back();
+            bool odd = (strip.size() - 2) & 1;
+            uint32_t next = odd ? findEdge(adj, local, done, q, p) : findEdge(adj, local, done, p, q);
+            if (next == kNoTriangle) break;
+            done[next] = true;
+            const uint32_t* n = &local[3 * next];
+            strip.push_back((n[0] != p && n[0] != q) ? n[0] : (n[1] != p && n[1] != q) ? n[1] : n[2]);
+        }
+        for (uint32_t v : strip) out.push_back(vertices[v]);
+        out.push_back(kStripRestartIndex);
+        strips++;
+    }
+    return strips;
+}
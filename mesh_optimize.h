@@ -0,0 +1,49 @@
+// mesh_optimize.h
+// Index/vertex buffer reordering passes run after import, plus the metrics used to report them,
+// and the conversion of triangle lists to strips.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// post-transform cache size assumed by the optimizer and the FIFO simulation
+const unsigned kVertexCacheSize = 16;
+
+struct VertexCacheStats {
+    float acmr = 0.0f;   // average cache miss ratio: transformed vertices per triangle (0.5 is ideal)
+    float atvr = 0.0f;   // average transform to vertex ratio: transformed / unique vertices (1.0 is ideal)
+};
+
+// Simulate a FIFO post-transform cache of cacheSize entries over a triangle list.
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize = kVertexCacheSize);
+
+// Reorder triangles for post-transform cache reuse (Tipsify, Sander et al. 2007). Linear time.
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize = kVertexCacheSize);
+
+// Average overdraw (shaded / covered pixels) of a software rasterization from the six axis views,
+// with back faces culled as in the renderer. Positions are the first 3 floats of each vertex.
+float analyzeOverdraw(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, int stride);
+
+// Reorder triangle clusters front-to-back from the outside in (Sander et al. 2007), keeping the
+// vertex cache ACMR within threshold of the input order. Run after optimizeVertexCache.
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<float>& vertices, int stride, float threshold = 1.05f);
+
+// Bytes fetched from the vertex buffer (64-byte lines through a small LRU cache, fetched on
+// post-transform misses) divided by the size of the referenced vertices; 1.0 is ideal.
+float analyzeVertexFetch(const std::vector<uint32_t>& indices, size_t vertexCount, size_t vertexBytes);
+
+// Renumber vertices in first-use order of the index buffer and drop unreferenced ones.
+// Returns the new vertex count.
+size_t optimizeVertexFetch(std::vector<float>& vertices, std::vector<uint32_t>& indices, int stride);
+
+// Separates strips in a strip index buffer. At upload width it becomes 0xFFFF for 16-bit indices,
+// the value glPrimitiveRestartIndex is set to.
+const uint32_t kStripRestartIndex = 0xFFFFFFFFu;
+
+// Appends the triangles of indices[0, indexCount) to out as counter-clockwise triangle strips, each
+// followed by kStripRestartIndex. Strips are grown greedily over shared edges, starting from the
+// triangles in input order, so a vertex cache ordered list stays mostly in order. Degenerate
+// triangles are dropped. Returns the number of strips.
+size_t stripifyTriangles(const uint32_t* indices, size_t indexCount, std::vector<uint32_t>& out);
@@ -0,0 +1,170 @@
+// mesh_quantize.cpp
+// Float -> compact vertex encoding and the decode used to measure its error.
+
+#include "mesh_quantize.h"
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+// -------------------- half floats --------------------
+// Round to nearest even, overflow to infinity, NaN kept quiet.
+uint16_t floatToHalf(float f) {
+    uint32_t x; memcpy(&x, &f, 4);
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t a = x & 0x7FFFFFFF;
+    if (a >= 0x7F800000) return (uint16_t)(sign | (a > 0x7F800000 ? 0x7E00 : 0x7C00));
+    if (a >= 0x477FF000) return (uint16_t)(sign | 0x7C00);   // >= 65520 rounds past the largest half
+    if (a < 0x38800000) {                                    // below the smallest normal half
+        float v; memcpy(&v, &a, 4);
+        return (uint16_t)(sign | (uint32_t)lrintf(v * 16777216.0f));
+    }
+    // rebias the exponent (127 -> 15) and round the 13 dropped mantissa bits
+    a += 0xC8000FFF + ((a >> 13) & 1);
+    return (uint16_t)(sign | (a >> 13));
+}
+
+float halfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1F, mant = h & 0x3FF;
+    if (exp == 0) {
+        float v = ldexpf((float)mant, -24);
+        return sign ? -v : v;
+    }
+    uint32_t x = sign | (exp == 31 ? 0x7F800000 | (mant << 13) : ((exp + 112) << 23) | (mant << 13));
+    float f; memcpy(&f, &x, 4);
+    return f;
+}
+
+// -------------------- 10_10_10_2 normals --------------------
+static uint32_t packSnorm10(float v) {
+    int q = (int)lrintf(min(max(v, -1.0f), 1.0f) * 511.0f);
+    return (uint32_t)q & 0x3FF;
+}
+
+static float unpackSnorm10(uint32_t bits) {
+    int q = (int)(bits & 0x3FF);
+    if (q & 0x200) q -= 0x400;
+    return max(q / 511.0f, -1.0f);
+}
+
+// w = bitangent sign: 1 or -1 as a 2-bit snorm
+uint32_t packNormal1010102(const float* n, float sign) {
+    float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    float inv = len > 0.0f ? 1.0f / len : 0.0f;
+    uint32_t w = sign < 0.0f ? 3u : 1u;
+    return packSnorm10(n[0] * inv) | (packSnorm10(n[1] * inv) << 10) | (packSnorm10(n[2] * inv) << 20) | (w << 30);
+}
+
+// -------------------- octahedral tangents --------------------
+// Unit vector -> octahedron -> square [-1, 1]^2, stored as two unorm8; pbr.vs has the same decode.
+void packOctahedral(const float* v, uint8_t* out) {
+    float l1 = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+    float x = l1 > 0.0f ? v[0] / l1 : 1.0f, y = l1 > 0.0f ? v[1] / l1 : 0.0f;
+    if (l1 > 0.0f && v[2] < 0.0f) {
+        float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx; y = fy;
+    }
+    out[0] = (uint8_t)lrintf((x * 0.5f + 0.5f) * 255.0f);
+    out[1] = (uint8_t)lrintf((y * 0.5f + 0.5f) * 255.0f);
+}
+
+static void unpackOctahedral(const uint8_t* in, float* v) {
+    float x = in[0] / 255.0f * 2.0f - 1.0f, y = in[1] / 255.0f * 2.0f - 1.0f;
+    float z = 1.0f - fabsf(x) - fabsf(y);
+    if (z < 0.0f) {
+        float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx; y = fy;
+    }
+    float len = sqrtf(x * x + y * y + z * z);
+    v[0] = x / len; v[1] = y / len; v[2] = z / len;
+}
+
+// -------------------- encode --------------------
+PositionDequant positionDequant(const MeshBounds& bounds) {
+    PositionDequant dq;
+    for (int a = 0; a < 3; a++) {
+        dq.offset[a] = bounds.min[a];
+        dq.scale[a] = bounds.max[a] - bounds.min[a];
+    }
+    return dq;
+}
+
+typedef CompactVertexFormat::Stream<0> CompactStream;
+static_assert(CompactStream::offsetOf(0) == offsetof(CompactVertex, pos) && CompactStream::offsetOf(1) == offsetof(CompactVertex, tangent) &&
+              CompactStream::offsetOf(2) == offsetof(CompactVertex, normal) && CompactStream::offsetOf(3) == offsetof(CompactVertex, uv),
+              "CompactVertexFormat must match CompactVertex");
+
+void quantizeVertices(const float* vertices, size_t vertexCount, const PositionDequant& dq, vector<CompactVertex>& out) {
+    out.resize(vertexCount);
+    CompactVertexFormat::pack(vertices, vertexCount, dq, (unsigned char*)out.data());
+}
+
+void dequantizeVertices(const CompactVertex* quantized, size_t vertexCount, const PositionDequant& dq, vector<float>& out) {
+    out.resize(vertexCount * kMeshVertexFloats);
+    for (size_t i = 0; i < vertexCount; i++) {
+        const CompactVertex& c = quantized[i];
+        float* v = &out[i * kMeshVertexFloats];
+        for (int a = 0; a < 3; a++) v[a] = dq.offset[a] + c.pos[a] / 65535.0f * dq.scale[a];
+        for (int a = 0; a < 3; a++) v[3 + a] = unpackSnorm10(c.normal >> (10 * a));
+        v[6] = halfToFloat(c.uv[0]);
+        v[7] = halfToFloat(c.uv[1]);
+        unpackOctahedral(c.tangent, v + 8);
+        v[11] = (c.normal >> 30) == 3 ? -1.0f : 1.0f;
+    }
+}
+
+// -------------------- error --------------------
+QuantizationError measureQuantizationError(const float* vertices, const vector<CompactVertex>& quantized,
+                                           const PositionDequant& dq) {
+    QuantizationError e;
+    if (quantized.empty()) return e;
+    double sumPos = 0.0, sumNormal = 0.0, sumTangent = 0.0;
+    size_t normals = 0, tangents = 0;
+    for (size_t i = 0; i < quantized.size(); i++) {
+        const float* v = vertices + i * kMeshVertexFloats;
+        const CompactVertex& c = quantized[i];
+        float d2 = 0.0f;
+        for (int a = 0; a < 3; a++) {
+            float p = dq.offset[a] + c.pos[a] / 65535.0f * dq.scale[a];
+            d2 += (p - v[a]) * (p - v[a]);
+        }
+        float d = sqrtf(d2);
+        e.maxPosition = max(e.maxPosition, d);
+        sumPos += d;
+
+        float len = sqrtf(v[3] * v[3] + v[4] * v[4] + v[5] * v[5]);
+        if (len > 0.0f) {
+            float n[3] = { unpackSnorm10(c.normal), unpackSnorm10(c.normal >> 10), unpackSnorm10(c.normal >> 20) };
+            float nlen = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            float cosAngle = nlen > 0.0f ? (n[0] * v[3] + n[1] * v[4] + n[2] * v[5]) / (nlen * len) : -1.0f;
+            float deg = acosf(min(max(cosAngle, -1.0f), 1.0f)) * (180.0f / 3.14159265f);
+            e.maxNormalDeg = max(e.maxNormalDeg, deg);
+            sumNormal += deg;
+            normals++;
+        }
+
+        float tlen = sqrtf(v[8] * v[8] + v[9] * v[9] + v[10] * v[10]);
+        if (tlen > 0.0f) {
+            float t[3];
+            unpackOctahedral(c.tangent, t);
+            float cosAngle = (t[0] * v[8] + t[1] * v[9] + t[2] * v[10]) / tlen;
+            float deg = acosf(min(max(cosAngle, -1.0f), 1.0f)) * (180.0f / 3.14159265f);
+            e.maxTangentDeg = max(e.maxTangentDeg, deg);
+            sumTangent += deg;
+            tangents++;
+            e.tangentSignErrors += ((c.normal >> 30) == 3) != (v[11] < 0.0f);
+        }
+
+        for (int a = 0; a < 2; a++) e.maxUv = max(e.maxUv, fabsf(halfToFloat(c.uv[a]) - v[6 + a]));
+    }
+    e.meanPosition = (float)(sumPos / quantized.size());
+    e.meanNormalDeg = normals ? (float)(sumNormal / normals) : 0.0f;
+    e.meanTangentDeg = tangents ? (float)(sumTangent / tangents) : 0.0f;
+    return e;
+}
@@ -0,0 +1,60 @@
+// mesh_quantize.h
+// Compact 16-byte vertex format for upload: positions as 16-bit unorm relative to the mesh AABB,
+// normals as signed 10_10_10_2 with the bitangent sign in the 2-bit w, tangents octahedral in two
+// bytes, UVs as half floats. The float vertices stay the import/cache format.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mesh_import.h"
+
+// GL attributes: pos = 3 x GL_UNSIGNED_SHORT normalized, tangent = 2 x GL_UNSIGNED_BYTE normalized
+// (octahedral, decoded in pbr.vs), normal = GL_INT_2_10_10_10_REV normalized, uv = 2 x GL_HALF_FLOAT
+struct CompactVertex {
+    uint16_t pos[3];
+    uint8_t tangent[2];
+    uint32_t normal;
+    uint16_t uv[2];
+};
+static_assert(sizeof(CompactVertex) == 16, "CompactVertex must stay 16 bytes");
+
+// Dequantization is pos = offset + unorm * scale (per axis); pbr.vs applies it.
+struct PositionDequant {
+    float offset[3] = { 0, 0, 0 };
+    float scale[3] = { 1, 1, 1 };
+};
+
+struct QuantizationError {
+    float maxPosition = 0.0f, meanPosition = 0.0f;   // mesh units
+    float maxNormalDeg = 0.0f, meanNormalDeg = 0.0f;
+    float maxTangentDeg = 0.0f, meanTangentDeg = 0.0f;
+    size_t tangentSignErrors = 0;
+    float maxUv = 0.0f;
+};
+
+uint16_t floatToHalf(float f);
+float halfToFloat(uint16_t h);
+
+// Encoders shared with the vertex format writers (vertex_format.h).
+inline uint16_t quantizeUnorm16(float v) {   // v already scaled to 0..65535
+    return (uint16_t)lrintf(std::min(std::max(v, 0.0f), 65535.0f));
+}
+uint32_t packNormal1010102(const float* n, float sign);   // w = sign as a 2-bit snorm
+void packOctahedral(const float* v, uint8_t* out);       // two unorm8, decoded in pbr.vs
+
+PositionDequant positionDequant(const MeshBounds& bounds);
+
+// vertices: kMeshVertexFloats per vertex
+void quantizeVertices(const float* vertices, size_t vertexCount, const PositionDequant& dq, std::vector<CompactVertex>& out);
+
+// The inverse, back to kMeshVertexFloats per vertex (for float upload formats fed from compact data).
+void dequantizeVertices(const CompactVertex* quantized, size_t vertexCount, const PositionDequant& dq, std::vector<float>& out);
+
+// Decode out again and compare against the float vertices, the way the GPU would see them.
+QuantizationError measureQuantizationError(const float* vertices, const std::vector<CompactVertex>& quantized,
+                                           const PositionDequant& dq);
@@ -0,0 +1,314 @@
+// mesh_simplify.cpp
+// Pass-based QEM simplifier: every pass ranks all edges by collapse cost and greedily collapses the
+// cheapest ones whose neighbourhoods do not overlap, then rebuilds adjacency. This avoids a mutable
+// priority queue and keeps each pass linear apart from the sort.
+
+#include "mesh_simplify.h"
+#include "mesh_topology.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace std;
+
+// -------------------- quadrics --------------------
+// Symmetric 4x4 plane quadric; w is the accumulated triangle area so cost / w is a mean squared distance.
+struct Quadric {
+    double a2 = 0, b2 = 0, c2 = 0, d2 = 0, ab = 0, ac = 0, ad = 0, bc = 0, bd = 0, cd = 0, w = 0;
+    void addPlane(double a, double b, double c, double d, double weight) {
+        a2 += weight * a * a; b2 += weight * b * b; c2 += weight * c * c; d2 += weight * d * d;
+        ab += weight * a * b; ac += weight * a * c; ad += weight * a * d;
+        bc += weight * b * c; bd += weight * b * d; cd += weight * c * d;
+    }
+    void add(const Quadric& q) {
+        a2 += q.a2; b2 += q.b2; c2 += q.c2; d2 += q.d2; ab += q.ab; ac += q.ac; ad += q.ad;
+        bc += q.bc; bd += q.bd; cd += q.cd; w += q.w;
+    }
+    double eval(const float* p) const {
+        double x = p[0], y = p[1], z = p[2];
+        double r = a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z)
+                 + 2.0 * (ad * x + bd * y + cd * z) + d2;
+        return r > 0.0 ? r : 0.0;
+    }
+};
+
+static void cross3(const float* a, const float* b, const float* c, double* n) {
+    double e1[3] = { (double)b[0] - a[0], (double)b[1] - a[1], (double)b[2] - a[2] };
+    double e2[3] = { (double)c[0] - a[0], (double)c[1] - a[1], (double)c[2] - a[2] };
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// -------------------- position topology --------------------
+enum VertexKind : unsigned char { KindInterior, KindBorder, KindLocked };
+
+struct Simplifier {
+    int stride = 0;
+    const vector<float>* vertices = nullptr;
+    const vector<uint32_t>* indices = nullptr;
+    vector<uint32_t> wedgePos;          // vertex -> position id
+    vector<float> pos;                  // 3 per position id
+    vector<uint32_t> wedgeOffsets, wedges;   // position id -> its vertices (CSR)
+    vector<Quadric> quadrics;
+    vector<unsigned char> kind;
+    vector<unsigned char> everLocked;   // non-manifold once, locked for good
+    vector<uint32_t> tris;              // live triangles, position ids
+    vector<uint32_t> triSource;         // live triangle -> input triangle
+    float maxError = 0.0f;
+};
+
+static void weldPositions(Simplifier& s) {
+    const vector<float>& v = *s.vertices;
+    size_t count = v.size() / s.stride;
+    unordered_map<PositionKey, uint32_t, PositionKeyHash> ids;
+    ids.reserve(count);
+    s.wedgePos.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        auto it = ids.emplace(positionKey(&v[i * s.stride]), (uint32_t)(s.pos.size() / 3));
+        if (it.second) s.pos.insert(s.pos.end(), &v[i * s.stride], &v[i * s.stride] + 3);
+        s.wedgePos[i] = it.first->second;
+    }
+    buildCsr(s.wedgePos, s.pos.size() / 3, s.wedgeOffsets, s.wedges);
+}
+
+static void initTriangles(Simplifier& s) {
+    const vector<uint32_t>& idx = *s.indices;
+    size_t positions = s.pos.size() / 3;
+    s.quadrics.assign(positions, Quadric());
+    s.everLocked.assign(positions, 0);
+    for (size_t t = 0; t < idx.size() / 3; t++) {
+        uint32_t a = s.wedgePos[idx[3 * t]], b = s.wedgePos[idx[3 * t + 1]], c = s.wedgePos[idx[3 * t + 2]];
+        if (a == b || b == c || a == c) continue;
+        double n[3];
+        cross3(&s.pos[3 * a], &s.pos[3 * b], &s.pos[3 * c], n);
+        double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        s.tris.push_back(a); s.tris.push_back(b); s.tris.push_back(c);
+        s.triSource.push_back((uint32_t)t);
+        if (len <= 0.0) continue;
+        double area = 0.5 * len;
+        n[0] /= len; n[1] /= len; n[2] /= len;
+        double d = -(n[0] * s.pos[3 * a] + n[1] * s.pos[3 * a + 1] + n[2] * s.pos[3 * a + 2]);
+        uint32_t corners[3] = { a, b, c };
+        for (uint32_t p : corners) {
+            s.quadrics[p].addPlane(n[0], n[1], n[2], d, area);
+            s.quadrics[p].w += area;
+        }
+    }
+}
+
+// -------------------- edges --------------------
+struct Edge {
+    uint32_t from, to;
+    double cost;
+    uint32_t triangles;   // triangles sharing the edge (removed by the collapse)
+};
+
+static inline uint64_t edgeKey(uint32_t a, uint32_t b) {
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+static double collapseCost(const Simplifier& s, uint32_t from, uint32_t to) {
+    Quadric q = s.quadrics[from];
+    q.add(s.quadrics[to]);
+    return q.eval(&s.pos[3 * to]);
+}
+
+// Classify vertices from the current triangles and return every collapsible edge in its cheaper
+// allowed direction. The first pass also adds the plane quadrics that keep open borders in place.
+static void collectEdges(Simplifier& s, bool addBorderQuadrics, vector<Edge>& edges) {
+    size_t positions = s.pos.size() / 3;
+    vector<uint64_t> keys;
+    vector<uint32_t> keyTri;
+    keys.reserve(s.tris.size());
+    for (size_t i = 0; i < s.tris.size(); i++) {
+        uint32_t a = s.tris[i], b = s.tris[i % 3 == 2 ? i - 2 : i + 1];
+        keys.push_back(edgeKey(a, b));
+    }
+    vector<uint32_t> order(keys.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = (uint32_t)i;
+    sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) { return keys[x] < keys[y]; });
+
+    s.kind.assign(positions, KindInterior);
+    for (size_t p = 0; p < positions; p++) if (s.everLocked[p]) s.kind[p] = KindLocked;
+    struct Run { uint64_t key; uint32_t count, corner; };
+    vector<Run> runs;
+    for (size_t i = 0; i < order.size();) {
+        size_t j = i;
+        while (j < order.size() && keys[order[j]] == keys[order[i]]) j++;
+        Run r = { keys[order[i]], (uint32_t)(j - i), order[i] };
+        runs.push_back(r);
+        i = j;
+    }
+    for (const Run& r : runs) {
+        uint32_t a = (uint32_t)(r.key >> 32), b = (uint32_t)r.key;
+        if (r.count > 2) {
+            s.everLocked[a] = s.everLocked[b] = 1;
+            s.kind[a] = s.kind[b] = KindLocked;
+        }
+        else if (r.count == 1) {
+            if (s.kind[a] != KindLocked) s.kind[a] = KindBorder;
+            if (s.kind[b] != KindLocked) s.kind[b] = KindBorder;
+            if (addBorderQuadrics) {
+                // plane through the edge, perpendicular to its triangle
+                size_t t = r.corner / 3;
+                double n[3];
+                cross3(&s.pos[3 * s.tris[3 * t]], &s.pos[3 * s.tris[3 * t + 1]], &s.pos[3 * s.tris[3 * t + 2]], n);
+                const float* pa = &s.pos[3 * a];
+                const float* pb = &s.pos[3 * b];
+                double e[3] = { (double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2] };
+                double m[3] = { e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0] };
+                double len = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+                if (len > 0.0) {
+                    m[0] /= len; m[1] /= len; m[2] /= len;
+                    double d = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+                    double weight = 10.0 * (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+                    s.quadrics[a].addPlane(m[0], m[1], m[2], d, weight);
+                    s.quadrics[b].addPlane(m[0], m[1], m[2], d, weight);
+                }
+            }
+        }
+    }
+
+    edges.clear();
+    for (const Run& r : runs) {
+        if (r.count > 2) continue;
+        uint32_t a = (uint32_t)(r.key >> 32), b = (uint32_t)r.key;
+        bool borderEdge = r.count == 1;
+        // interior vertices may move anywhere; border vertices only along their border
+        bool ab = s.kind[a] == KindInterior || (s.kind[a] == KindBorder && borderEdge && s.kind[b] == KindBorder);
+        bool ba = s.kind[b] == KindInterior || (s.kind[b] == KindBorder && borderEdge && s.kind[a] == KindBorder);
+        if (!ab && !ba) continue;
+        double costAB = ab ? collapseCost(s, a, b) : 0.0;
+        double costBA = ba ? collapseCost(s, b, a) : 0.0;
+        Edge e;
+        e.triangles = r.count;
+        if (ab && (!ba || costAB <= costBA)) { e.from = a; e.to = b; e.cost = costAB; }
+        else { e.from = b; e.to = a; e.cost = costBA; }
+        edges.push_back(e);
+    }
+}
+
+// -------------------- collapse pass --------------------
+// Moving 'from' onto 'to' must not flip or degenerate any triangle that survives the collapse.
+static bool collapseKeepsOrientation(const Simplifier& s, const vector<uint32_t>& adjOffsets, const vector<uint32_t>& adj,
+                                     uint32_t from, uint32_t to) {
+    for (uint32_t k = adjOffsets[from]; k < adjOffsets[from + 1]; k++) {
+        const uint32_t* t = &s.tris[3 * adj[k]];
+        if (t[0] == to || t[1] == to || t[2] == to) continue;
+        const float* p[3];
+        const float* q[3];
+        for (int c = 0; c < 3; c++) {
+            p[c] = &s.pos[3 * t[c]];
+            q[c] = t[c] == from ? &s.pos[3 * to] : p[c];
+        }
+        double n0[3], n1[3];
+        cross3(p[0], p[1], p[2], n0);
+        cross3(q[0], q[1], q[2], n1);
+        if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.0) return false;
+    }
+    return true;
+}
+
+// Returns the number of collapses performed.
+static size_t collapsePass(Simplifier& s, size_t targetTriangles, bool first) {
+    vector<Edge> edges;
+    collectEdges(s, first, edges);
+    if (edges.empty()) return 0;
+    sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.cost < b.cost; });
+
+    size_t positions = s.pos.size() / 3;
+    size_t triCount = s.tris.size() / 3;
+    vector<uint32_t> adjOffsets, adj;
+    buildCsr(s.tris, positions, adjOffsets, adj, 3);
+
+    vector<uint32_t> remap(positions);
+    for (size_t p = 0; p < positions; p++) remap[p] = (uint32_t)p;
+    vector<unsigned char> locked(positions, 0);
+    size_t needed = triCount > targetTriangles ? triCount - targetTriangles : 0;
+    size_t removed = 0, collapses = 0;
+    for (const Edge& e : edges) {
+        if (removed >= needed) break;
+        if (locked[e.from] || locked[e.to]) continue;
+        if (!collapseKeepsOrientation(s, adjOffsets, adj, e.from, e.to)) continue;
+        remap[e.from] = e.to;
+        s.quadrics[e.to].add(s.quadrics[e.from]);
+        double w = s.quadrics[e.to].w;
+        float err = (float)sqrt(w > 0.0 ? e.cost / w : e.cost);
+        if (err > s.maxError) s.maxError = err;
+        // every triangle around 'from' changes, so its whole ring waits for the next pass
+        for (uint32_t k = adjOffsets[e.from]; k < adjOffsets[e.from + 1]; k++)
+            for (int c = 0; c < 3; c++) locked[s.tris[3 * adj[k] + c]] = 1;
+        locked[e.to] = 1;
+        removed += e.triangles;
+        collapses++;
+    }
+
+    size_t out = 0;
+    for (size_t t = 0; t < triCount; t++) {
+        uint32_t a = remap[s.tris[3 * t]], b = remap[s.tris[3 * t + 1]], c = remap[s.tris[3 * t + 2]];
+        if (a == b || b == c || a == c) continue;
+        s.tris[3 * out] = a; s.tris[3 * out + 1] = b; s.tris[3 * out + 2] = c;
+        s.triSource[out] = s.triSource[t];
+        out++;
+    }
+    s.tris.resize(3 * out);
+    s.triSource.resize(out);
+    return collapses;
+}
+
+// -------------------- output --------------------
+// Corner attributes: keep the original vertex while its position survives, otherwise take the vertex
+// of the new position that best matches the corner's normal and uv.
+static uint32_t pickWedge(const Simplifier& s, uint32_t original, uint32_t position) {
+    if (s.wedgePos[original] == position) return original;
+    const float* o = &(*s.vertices)[(size_t)original * s.stride];
+    uint32_t best = s.wedges[s.wedgeOffsets[position]];
+    float bestScore = 1e30f;
+    for (uint32_t k = s.wedgeOffsets[position]; k < s.wedgeOffsets[position + 1]; k++) {
+        const float* v = &(*s.vertices)[(size_t)s.wedges[k] * s.stride];
+        float dn = 1.0f - (o[3] * v[3] + o[4] * v[4] + o[5] * v[5]);
+        float du = o[6] - v[6], dv = o[7] - v[7];
+        float score = dn + du * du + dv * dv;
+        if (score < bestScore) { bestScore = score; best = s.wedges[k]; }
+    }
+    return best;
+}
+
+static void snapshot(const Simplifier& s, SimplifiedLod& lod) {
+    const vector<uint32_t>& idx = *s.indices;
+    lod.indices.resize(s.tris.size());
+    for (size_t t = 0; t < s.triSource.size(); t++)
+        for (int c = 0; c < 3; c++)
+            lod.indices[3 * t + c] = pickWedge(s, idx[3 * s.triSource[t] + c], s.tris[3 * t + c]);
+    lod.error = s.maxError;
+}
+
+void buildLodChain(const vector<uint32_t>& indices, const vector<float>& vertices, int stride,
+                   const float* ratios, int ratioCount, vector<SimplifiedLod>& out) {
+    out.clear();
+    if (indices.size() < 3 || stride < 8) return;
+    Simplifier s;
+    s.stride = stride;
+    s.vertices = &vertices;
+    s.indices = &indices;
+    weldPositions(s);
+    initTriangles(s);
+
+    size_t inputTriangles = indices.size() / 3;
+    bool first = true;
+    for (int r = 0; r < ratioCount; r++) {
+        size_t target = (size_t)(inputTriangles * ratios[r]);
+        size_t before = s.tris.size() / 3;
+        while (s.tris.size() / 3 > target) {
+            if (collapsePass(s, target, first) == 0) break;
+            first = false;
+        }
+        // a level that barely shrank is not worth its index buffer, and nothing coarser will follow
+        size_t now = s.tris.size() / 3;
+        if (now == 0 || now > before * 9 / 10) break;
+        out.push_back(SimplifiedLod());
+        snapshot(s, out.back());
+    }
+}
@@ -0,0 +1,22 @@
+// mesh_simplify.h
+// Quadric error metric edge-collapse simplification (Garland & Heckbert 1997) used to build LOD chains.
+// LODs reuse the vertex buffer of the input mesh; only the index buffer is rebuilt.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct SimplifiedLod {
+    std::vector<uint32_t> indices;
+    float error = 0.0f;   // largest quadric distance of any collapse so far, in mesh units
+};
+
+// Simplify progressively towards each ratio (fractions of the input triangle count, descending) and
+// snapshot one LOD per ratio. Topology comes from welded positions, so attribute seams and flat-shaded
+// meshes collapse like smooth ones; each output corner picks the vertex of its final position whose
+// normal/uv is closest to the original corner. Stops early when no further collapse is possible.
+// Positions are the first 3 floats, normal the next 3 and uv the next 2 of each vertex.
+void buildLodChain(const std::vector<uint32_t>& indices, const std::vector<float>& vertices, int stride,
+                   const float* ratios, int ratioCount, std::vector<SimplifiedLod>& out);
@@ -0,0 +1,260 @@
+// mesh_tangents.cpp
+// Both generators use two parallel passes: per-face data over triangles, then a gather over a
+// vertex or position -> corner table (each vertex/position is owned by one thread, so no atomics
+// and the result does not depend on the thread count). Vertex splits are rare and done serially.
+
+#include "mesh_tangents.h"
+#include "mesh_topology.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using namespace std;
+
+// -------------------- vector helpers --------------------
+static inline float dot3(const float* a, const float* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+static inline void cross3(const float* a, const float* b, float* out) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static inline bool normalize3(float* v) {
+    float len = sqrtf(dot3(v, v));
+    if (!(len > 1e-20f)) return false;
+    for (int k = 0; k < 3; k++) v[k] /= len;
+    return true;
+}
+
+// any unit vector perpendicular to n, for vertices without usable UVs
+static void anyPerpendicular(const float* n, float* out) {
+    float axis[3] = { 0, 0, 0 };
+    axis[fabsf(n[0]) < 0.9f ? 0 : 1] = 1.0f;
+    cross3(n, axis, out);
+    if (!normalize3(out)) { out[0] = 1; out[1] = 0; out[2] = 0; }
+}
+
+// -------------------- face pass --------------------
+// Unit tangent and bitangent directions of a triangle's UV mapping, plus the interior angle at each
+// corner (the accumulation weight, as in MikkTSpace). Faces without UV area get zero weights.
+struct FaceFrame {
+    float tangent[3], bitangent[3];
+    float angle[3];
+};
+
+static void computeFaceFrame(const float* v0, const float* v1, const float* v2, FaceFrame& f) {
+    const float* p[3] = { v0, v1, v2 };
+    float e1[3], e2[3];
+    for (int k = 0; k < 3; k++) { e1[k] = v1[k] - v0[k]; e2[k] = v2[k] - v0[k]; }
+    float du1 = v1[6] - v0[6], dv1 = v1[7] - v0[7];
+    float du2 = v2[6] - v0[6], dv2 = v2[7] - v0[7];
+    float det = du1 * dv2 - du2 * dv1;
+    for (int k = 0; k < 3; k++) {
+        f.tangent[k] = e1[k] * dv2 - e2[k] * dv1;
+        f.bitangent[k] = e2[k] * du1 - e1[k] * du2;
+    }
+    bool ok = det != 0.0f && normalize3(f.tangent) && normalize3(f.bitangent);
+    if (det < 0.0f)
+        for (int k = 0; k < 3; k++) { f.tangent[k] = -f.tangent[k]; f.bitangent[k] = -f.bitangent[k]; }
+    for (int c = 0; c < 3; c++) {
+        f.angle[c] = 0.0f;
+        if (!ok) continue;
+        const float* a = p[c];
+        const float* b = p[(c + 1) % 3];
+        const float* d = p[(c + 2) % 3];
+        float x[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, y[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+        if (!normalize3(x) || !normalize3(y)) continue;
+        f.angle[c] = acosf(min(max(dot3(x, y), -1.0f), 1.0f));
+    }
+}
+
+// -------------------- vertex pass --------------------
+struct TangentSum {
+    float t[3] = { 0, 0, 0 };
+    float weight = 0.0f;
+};
+
+size_t generateTangents(vector<float>& vertices, vector<uint32_t>& indices, int stride, unsigned threads) {
+    size_t vertexCount = vertices.size() / stride;
+    size_t triCount = indices.size() / 3;
+    if (vertexCount == 0 || triCount == 0 || stride < 12) return 0;
+
+    vector<FaceFrame> faces(triCount);
+    parallelFor(triCount, threads, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++)
+            computeFaceFrame(&vertices[(size_t)indices[3 * t] * stride], &vertices[(size_t)indices[3 * t + 1] * stride],
+                             &vertices[(size_t)indices[3 * t + 2] * stride], faces[t]);
+    });
+
+    // vertex -> corners (CSR)
+    vector<uint32_t> offsets, corners;
+    buildCsr(indices, vertexCount, offsets, corners);
+
+    // Per vertex, the projected face tangents are summed separately for each handedness (the sign of
+    // dot(cross(n, T), B)). The heavier group is written to the vertex; a vertex that also has a
+    // lighter group is split afterwards, so each corner remembers its group.
+    vector<signed char> cornerSign(indices.size(), 1);
+    vector<float> minority(vertexCount * 4, 0.0f);   // tangent + sign of the lighter group, weight 0 = none
+    parallelFor(vertexCount, threads, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; v++) {
+            float* vert = &vertices[v * stride];
+            float n[3] = { vert[3], vert[4], vert[5] };
+            if (!normalize3(n)) { n[0] = 0; n[1] = 1; n[2] = 0; }
+            TangentSum sums[2];   // [0] = right-handed (+1), [1] = left-handed (-1)
+            for (uint32_t k = offsets[v]; k < offsets[v + 1]; k++) {
+                uint32_t corner = corners[k];
+                const FaceFrame& f = faces[corner / 3];
+                float w = f.angle[corner % 3];
+                float t[3], nxt[3];
+                float along = dot3(n, f.tangent);
+                for (int a = 0; a < 3; a++) t[a] = f.tangent[a] - n[a] * along;
+                cross3(n, f.tangent, nxt);
+                int group = dot3(nxt, f.bitangent) < 0.0f ? 1 : 0;
+                cornerSign[corner] = group ? -1 : 1;
+                if (w <= 0.0f || !normalize3(t)) continue;
+                for (int a = 0; a < 3; a++) sums[group].t[a] += t[a] * w;
+                sums[group].weight += w;
+            }
+            int major = sums[1].weight > sums[0].weight ? 1 : 0;
+            float* out[2] = { vert + 8, &minority[v * 4] };
+            for (int g = 0; g < 2; g++) {
+                const TangentSum& s = sums[g == 0 ? major : 1 - major];
+                float* dst = out[g];
+                if (g == 1 && s.weight <= 0.0f) continue;
+                for (int a = 0; a < 3; a++) dst[a] = s.t[a];
+                if (!normalize3(dst)) anyPerpendicular(n, dst);
+                dst[3] = (g == 0 ? major : 1 - major) ? -1.0f : 1.0f;
+            }
+        }
+    });
+
+    // split: corners whose handedness differs from their vertex's move to a copy with the other frame
+    vector<uint32_t> copyOf(vertexCount, UINT32_MAX);
+    size_t added = 0;
+    for (size_t i = 0; i < indices.size(); i++) {
+        uint32_t v = indices[i];
+        if ((float)cornerSign[i] == vertices[(size_t)v * stride + 11] || minority[v * 4 + 3] == 0.0f) continue;
+        if (copyOf[v] == UINT32_MAX) {
+            copyOf[v] = (uint32_t)(vertices.size() / stride);
+            vector<float> vert(vertices.begin() + (size_t)v * stride, vertices.begin() + (size_t)(v + 1) * stride);
+            copy(&minority[v * 4], &minority[v * 4] + 4, vert.begin() + 8);
+            vertices.insert(vertices.end(), vert.begin(), vert.end());
+            added++;
+        }
+        indices[i] = copyOf[v];
+    }
+    return added;
+}
+
+// -------------------- smooth normals --------------------
+NormalStats generateNormals(vector<float>& vertices, vector<uint32_t>& indices, int stride, float creaseDegrees, unsigned threads) {
+    NormalStats stats;
+    size_t vertexCount = vertices.size() / stride;
+    size_t triCount = indices.size() / 3;
+    vector<char> missing(vertexCount, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float* n = &vertices[v * stride + 3];
+        missing[v] = n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f;
+        stats.generated += missing[v];
+    }
+    if (stats.generated == 0) return stats;
+
+    // face normals and per-corner weights (twice the area times the corner angle)
+    vector<float> faceNormals(triCount * 3), weights(indices.size());
+    parallelFor(triCount, threads, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            const float* p[3];
+            for (int c = 0; c < 3; c++) p[c] = &vertices[(size_t)indices[3 * t + c] * stride];
+            float e1[3], e2[3], n[3];
+            for (int k = 0; k < 3; k++) { e1[k] = p[1][k] - p[0][k]; e2[k] = p[2][k] - p[0][k]; }
+            cross3(e1, e2, n);
+            float area2 = sqrtf(dot3(n, n));
+            if (!normalize3(n)) n[0] = n[1] = n[2] = 0.0f;
+            copy(n, n + 3, &faceNormals[3 * t]);
+            for (int c = 0; c < 3; c++) {
+                float x[3], y[3];
+                for (int k = 0; k < 3; k++) { x[k] = p[(c + 1) % 3][k] - p[c][k]; y[k] = p[(c + 2) % 3][k] - p[c][k]; }
+                bool ok = normalize3(x) && normalize3(y);
+                weights[3 * t + c] = ok ? area2 * acosf(min(max(dot3(x, y), -1.0f), 1.0f)) : 0.0f;
+            }
+        }
+    });
+
+    // corners around each position, whatever vertex (uv seam) they belong to
+    vector<uint32_t> cornerPos(indices.size());
+    size_t positions;
+    {
+        unordered_map<PositionKey, uint32_t, PositionKeyHash> ids;
+        ids.reserve(vertexCount);
+        vector<uint32_t> vertexPos(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            vertexPos[v] = ids.emplace(positionKey(&vertices[v * stride]), (uint32_t)ids.size()).first->second;
+        positions = ids.size();
+        for (size_t i = 0; i < indices.size(); i++) cornerPos[i] = vertexPos[indices[i]];
+    }
+    vector<uint32_t> posOffsets, posCorners;
+    buildCsr(cornerPos, positions, posOffsets, posCorners);
+
+    // gather: each thread owns whole positions and writes only the normals of their corners
+    float cosCrease = cosf(creaseDegrees * (3.14159265f / 180.0f));
+    vector<float> cornerNormals(indices.size() * 3, 0.0f);
+    parallelFor(positions, threads, [&](size_t begin, size_t end) {
+        vector<float> local;   // face normal * weight and face normal of each corner around the position
+        for (size_t p = begin; p < end; p++) {
+            uint32_t first = posOffsets[p], count = posOffsets[p + 1] - first;
+            local.resize((size_t)count * 6);
+            for (uint32_t b = 0; b < count; b++) {
+                uint32_t other = posCorners[first + b];
+                const float* fn = &faceNormals[other / 3 * 3];
+                for (int k = 0; k < 3; k++) { local[b * 6 + k] = fn[k] * weights[other]; local[b * 6 + 3 + k] = fn[k]; }
+            }
+            for (uint32_t a = 0; a < count; a++) {
+                uint32_t corner = posCorners[first + a];
+                if (!missing[indices[corner]]) continue;
+                const float* self = &local[a * 6 + 3];
+                bool degenerate = dot3(self, self) == 0.0f;
+                float* n = &cornerNormals[(size_t)corner * 3];
+                for (uint32_t b = 0; b < count; b++) {
+                    if (!degenerate && dot3(self, &local[b * 6 + 3]) < cosCrease) continue;
+                    for (int k = 0; k < 3; k++) n[k] += local[b * 6 + k];
+                }
+                if (!normalize3(n)) { n[0] = 0; n[1] = 1; n[2] = 0; }
+            }
+        }
+    });
+
+    // write back; corners of one vertex with different normals (a crease through it) get copies
+    vector<uint32_t> vertexOffsets, vertexCorners;
+    buildCsr(indices, vertexCount, vertexOffsets, vertexCorners);
+    vector<uint32_t> groups;   // vertex ids already holding a normal for the current vertex
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (!missing[v]) continue;
+        groups.clear();
+        for (uint32_t k = vertexOffsets[v]; k < vertexOffsets[v + 1]; k++) {
+            uint32_t corner = vertexCorners[k];
+            const float* n = &cornerNormals[(size_t)corner * 3];
+            uint32_t target = UINT32_MAX;
+            for (uint32_t g : groups)
+                if (memcmp(&vertices[(size_t)g * stride + 3], n, 3 * sizeof(float)) == 0) { target = g; break; }
+            if (target == UINT32_MAX) {
+                if (groups.empty()) target = (uint32_t)v;
+                else {
+                    target = (uint32_t)(vertices.size() / stride);
+                    vector<float> vert(vertices.begin() + v * stride, vertices.begin() + (v + 1) * stride);
+                    vertices.insert(vertices.end(), vert.begin(), vert.end());
+                    stats.split++;
+                }
+                copy(n, n + 3, &vertices[(size_t)target * stride + 3]);
+                groups.push_back(target);
+            }
+            indices[corner] = target;
+        }
+        // unreferenced vertices keep a valid normal
+        if (groups.empty()) vertices[v * stride + 4] = 1.0f;
+    }
+    return stats;
+}
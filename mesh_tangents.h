@@ -0,0 +1,29 @@
+// mesh_tangents.h
+// Per-vertex frames generated at import: smooth normals for meshes that come without them, and
+// tangents for normal mapping in the spirit of MikkTSpace: angle-weighted face tangents projected
+// onto the vertex normal, grouped by handedness so mirrored UV islands get their own vertices
+// instead of averaging to zero.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Vertex layout read and written: pos(3) at 0, normal(3) at 3, uv(2) at 6, tangent(4) at 8 where
+// tangent.w = +-1 is the bitangent sign (bitangent = cross(normal, tangent.xyz) * w).
+// Vertices whose triangles disagree on handedness are split; returns the number of vertices added.
+// threads = 0 uses std::thread::hardware_concurrency().
+size_t generateTangents(std::vector<float>& vertices, std::vector<uint32_t>& indices, int stride, unsigned threads = 0);
+
+struct NormalStats {
+    size_t generated = 0;   // vertices that had no normal
+    size_t split = 0;       // vertices added where a crease separates the faces around a corner
+};
+
+// Fills the normals of vertices whose normal is all zero (the importer's "no vn" marker). Each corner
+// gets the area- and angle-weighted average of the face normals around its position, skipping faces
+// that bend away from its own face by more than creaseDegrees; corners of one vertex that end up with
+// different normals are split into separate vertices. Same layout and threads as generateTangents.
+NormalStats generateNormals(std::vector<float>& vertices, std::vector<uint32_t>& indices, int stride, float creaseDegrees,
+                            unsigned threads = 0);
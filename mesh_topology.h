@@ -0,0 +1,43 @@
+// mesh_topology.h
+// Helpers shared by the passes that need adjacency: welding vertices by exact position bits and
+// building compressed sparse row (CSR) tables of items grouped by key.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Exact position of a vertex, for welding across uv / normal seams.
+struct PositionKey {
+    uint32_t bits[3];
+    bool operator==(const PositionKey& o) const { return memcmp(bits, o.bits, sizeof(bits)) == 0; }
+};
+struct PositionKeyHash {
+    size_t operator()(const PositionKey& k) const {
+        uint64_t h = k.bits[0] * 0x9E3779B97F4A7C15ull;
+        h ^= (k.bits[1] + (h << 6) + (h >> 2)) * 0xBF58476D1CE4E5B9ull;
+        h ^= (k.bits[2] + (h << 6) + (h >> 2)) * 0x94D049BB133111EBull;
+        return (size_t)(h ^ (h >> 31));
+    }
+};
+
+inline PositionKey positionKey(const float* position) {
+    PositionKey k;
+    memcpy(k.bits, position, sizeof(k.bits));
+    return k;
+}
+
+// Groups i / keysPerItem by keys[i] (each below keyCount): the items of key k are
+// items[offsets[k] .. offsets[k + 1]), in ascending order. keysPerItem 3 turns corner keys into
+// triangle lists.
+inline void buildCsr(const std::vector<uint32_t>& keys, size_t keyCount, std::vector<uint32_t>& offsets, std::vector<uint32_t>& items,
+                     uint32_t keysPerItem = 1) {
+    offsets.assign(keyCount + 1, 0);
+    for (uint32_t k : keys) offsets[k + 1]++;
+    for (size_t k = 0; k < keyCount; k++) offsets[k + 1] += offsets[k];
+    items.resize(keys.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < keys.size(); i++) items[fill[keys[i]]++] = (uint32_t)(i / keysPerItem);
+}
@@ -0,0 +1,164 @@
+// meshlet.cpp
+// Greedy meshlet growth: start from the first unassigned triangle in input order (which is already
+// cache/overdraw optimized) and keep adding the adjacent triangle that brings in the fewest new
+// vertices, breaking ties by distance to the seed, until a limit is hit.
+
+#include "meshlet.h"
+#include "mesh_optimize.h"
+#include "mesh_topology.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace std;
+
+// -------------------- position adjacency --------------------
+// triangle lists per welded position (CSR), plus the position id of every corner
+struct CornerAdjacency {
+    vector<uint32_t> cornerPos;
+    vector<uint32_t> offsets, triangles;
+};
+
+static void buildCornerAdjacency(const vector<uint32_t>& indices, const vector<float>& vertices, int stride, CornerAdjacency& adj) {
+    unordered_map<PositionKey, uint32_t, PositionKeyHash> ids;
+    ids.reserve(indices.size() / 2);
+    adj.cornerPos.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+        adj.cornerPos[i] = ids.emplace(positionKey(&vertices[(size_t)indices[i] * stride]), (uint32_t)ids.size()).first->second;
+    buildCsr(adj.cornerPos, ids.size(), adj.offsets, adj.triangles, 3);
+}
+
+// -------------------- bounds --------------------
+static void computeMeshletBounds(const uint32_t* tri, size_t triCount, const vector<float>& vertices, int stride, Meshlet& m) {
+    float lo[3] = { 1e30f, 1e30f, 1e30f }, hi[3] = { -1e30f, -1e30f, -1e30f };
+    for (size_t i = 0; i < triCount * 3; i++) {
+        const float* p = &vertices[(size_t)tri[i] * stride];
+        for (int a = 0; a < 3; a++) { lo[a] = min(lo[a], p[a]); hi[a] = max(hi[a], p[a]); }
+    }
+    float r2 = 0.0f;
+    for (int a = 0; a < 3; a++) m.center[a] = 0.5f * (lo[a] + hi[a]);
+    for (size_t i = 0; i < triCount * 3; i++) {
+        const float* p = &vertices[(size_t)tri[i] * stride];
+        float dx = p[0] - m.center[0], dy = p[1] - m.center[1], dz = p[2] - m.center[2];
+        r2 = max(r2, dx * dx + dy * dy + dz * dz);
+    }
+    m.radius = sqrtf(r2);
+
+    // cone around the average face normal; its half angle is the widest normal deviation
+    vector<float> normals;
+    normals.reserve(triCount * 3);
+    float axis[3] = { 0, 0, 0 };
+    for (size_t t = 0; t < triCount; t++) {
+        const float* a = &vertices[(size_t)tri[3 * t] * stride];
+        const float* b = &vertices[(size_t)tri[3 * t + 1] * stride];
+        const float* c = &vertices[(size_t)tri[3 * t + 2] * stride];
+        float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len <= 0.0f) continue;
+        for (int k = 0; k < 3; k++) { normals.push_back(n[k] / len); axis[k] += n[k] / len; }
+    }
+    float len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    m.coneCutoff = 1.0f;
+    if (len <= 0.0f) return;
+    for (int k = 0; k < 3; k++) m.coneAxis[k] = axis[k] / len;
+    float minDot = 1.0f;
+    for (size_t i = 0; i < normals.size(); i += 3)
+        minDot = min(minDot, normals[i] * m.coneAxis[0] + normals[i + 1] * m.coneAxis[1] + normals[i + 2] * m.coneAxis[2]);
+    // wider than ~84 degrees: some triangle always faces the viewer, keep the test disabled
+    if (minDot > 0.1f) m.coneCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+// -------------------- build --------------------
+void buildMeshlets(vector<uint32_t>& indices, const vector<float>& vertices, int stride, uint32_t baseOffset,
+                   vector<Meshlet>& out, unsigned maxVertices, unsigned maxTriangles) {
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) return;
+    maxVertices = max(maxVertices, 3u);
+    maxTriangles = max(maxTriangles, 1u);
+    CornerAdjacency adj;
+    buildCornerAdjacency(indices, vertices, stride, adj);
+    size_t firstMeshlet = out.size();
+
+    vector<bool> used(triCount, false);
+    vector<uint32_t> vertexStamp(vertices.size() / stride, 0);   // meshlet number + 1 that holds the vertex
+    vector<uint32_t> positionStamp(adj.offsets.size(), 0);       // same, for welded positions
+    vector<uint32_t> reordered, members, candidates;
+    reordered.reserve(indices.size());
+    uint32_t stamp = 0;
+    size_t seed = 0;
+
+    while (true) {
+        while (seed < triCount && used[seed]) seed++;
+        if (seed == triCount) break;
+        stamp++;
+        members.clear();
+        candidates.clear();
+        unsigned vertexCount = 0;
+        const float* origin = &vertices[(size_t)indices[3 * seed] * stride];
+        size_t next = seed;
+        while (true) {
+            // take triangle 'next'
+            used[next] = true;
+            members.push_back((uint32_t)next);
+            for (int c = 0; c < 3; c++) {
+                uint32_t v = indices[3 * next + c];
+                if (vertexStamp[v] != stamp) { vertexStamp[v] = stamp; vertexCount++; }
+                uint32_t p = adj.cornerPos[3 * next + c];
+                if (positionStamp[p] != stamp) {
+                    positionStamp[p] = stamp;
+                    candidates.insert(candidates.end(), adj.triangles.begin() + adj.offsets[p], adj.triangles.begin() + adj.offsets[p + 1]);
+                }
+            }
+            if (members.size() >= maxTriangles) break;
+
+            // best neighbour that still fits
+            int best = -1;
+            unsigned bestNew = 4;
+            float bestDist = 0.0f;
+            size_t keep = 0;
+            for (size_t k = 0; k < candidates.size(); k++) {
+                uint32_t t = candidates[k];
+                if (used[t]) continue;
+                candidates[keep++] = t;
+                unsigned fresh = 0;
+                for (int c = 0; c < 3; c++) fresh += vertexStamp[indices[3 * t + c]] != stamp;
+                if (vertexCount + fresh > maxVertices) continue;
+                const float* p = &vertices[(size_t)indices[3 * t] * stride];
+                float d = (p[0] - origin[0]) * (p[0] - origin[0]) + (p[1] - origin[1]) * (p[1] - origin[1]) + (p[2] - origin[2]) * (p[2] - origin[2]);
+                if (fresh < bestNew || (fresh == bestNew && d < bestDist)) { best = (int)t; bestNew = fresh; bestDist = d; }
+            }
+            candidates.resize(keep);
+            if (best < 0) break;
+            next = (size_t)best;
+        }
+
+        Meshlet m;
+        m.indexOffset = baseOffset + (uint32_t)reordered.size();
+        m.indexCount = (uint32_t)members.size() * 3;
+        size_t first = reordered.size();
+        for (uint32_t t : members) reordered.insert(reordered.end(), &indices[3 * t], &indices[3 * t] + 3);
+        computeMeshletBounds(&reordered[first], members.size(), vertices, stride, m);
+        out.push_back(m);
+    }
+
+    // growth order is local but not cache-optimal; re-run Tipsify inside each meshlet on local vertex ids
+    vector<uint32_t> local, globalId;
+    vector<uint32_t> localId(vertices.size() / stride, UINT32_MAX);
+    for (size_t i = firstMeshlet; i < out.size(); i++) {
+        uint32_t* range = &reordered[out[i].indexOffset - baseOffset];
+        size_t count = out[i].indexCount;
+        local.resize(count);
+        globalId.clear();
+        for (size_t k = 0; k < count; k++) {
+            uint32_t& id = localId[range[k]];
+            if (id == UINT32_MAX) { id = (uint32_t)globalId.size(); globalId.push_back(range[k]); }
+            local[k] = id;
+        }
+        optimizeVertexCache(local, globalId.size());
+        for (size_t k = 0; k < count; k++) range[k] = globalId[local[k]];
+        for (uint32_t v : globalId) localId[v] = UINT32_MAX;
+    }
+    indices.swap(reordered);
+}
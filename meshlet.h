@@ -0,0 +1,30 @@
+// meshlet.h
+// Partition of a triangle list into small clusters (meshlets) with culling bounds.
+// Each meshlet is a contiguous range of the index buffer, so visible ones can be drawn as ranges.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const unsigned kMeshletMaxVertices = 64;
+const unsigned kMeshletMaxTriangles = 124;
+
+struct Meshlet {
+    uint32_t indexOffset = 0;      // into the mesh index buffer
+    uint32_t indexCount = 0;
+    float center[3] = { 0, 0, 0 }; // bounding sphere, mesh space
+    float radius = 0.0f;
+    // backface cone: every triangle faces away from a viewer at v when
+    // dot(center - v, coneAxis) >= coneCutoff * |center - v| + radius; cutoff 1 disables the test
+    float coneAxis[3] = { 0, 0, 0 };
+    float coneCutoff = 1.0f;
+};
+
+// Reorder indices into meshlets of at most maxVertices unique vertices and maxTriangles triangles,
+// grown over shared positions so seams and flat shading do not split neighbours apart, and append
+// them to out. indexOffset values are relative to indices[0] plus baseOffset.
+// Positions are the first 3 floats of each vertex.
+void buildMeshlets(std::vector<uint32_t>& indices, const std::vector<float>& vertices, int stride, uint32_t baseOffset,
+                   std::vector<Meshlet>& out, unsigned maxVertices = kMeshletMaxVertices, unsigned maxTriangles = kMeshletMaxTriangles);
@@ -0,0 +1,457 @@
+// obj_parser.cpp
+
+// tinyobjloader is compiled here, next to the parser that fills its structures
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include "obj_parser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "mapped_file.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OBJ_PARSER_SSE2 1
+#endif
+
+using namespace std;
+
+// -------------------- line scanning --------------------
+// End of the current line (pointer to '\n' or end); 16 bytes per step with SSE2.
+static const char* findLineEnd(const char* p, const char* end) {
+#ifdef OBJ_PARSER_SSE2
+    const __m128i nl = _mm_set1_epi8('\n');
+    while (p + 16 <= end) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), nl));
+        if (mask) {
+            int bit = 0;
+            while (!(mask & (1 << bit))) bit++;
+            return p + bit;
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '\n') p++;
+    return p;
+}
+
+static inline const char* skipSpace(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+// -------------------- number parsing --------------------
+static const double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Up to 19 significant digits are accumulated in an integer and scaled once by an exact power
+// of ten (correctly rounded in double for |exp| <= 22, which covers every exporter we have seen).
+static const char* parseFloat(const char* p, const char* end, float& out) {
+    p = skipSpace(p, end);
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) { neg = (*p == '-'); p++; }
+    uint64_t mant = 0;
+    int digits = 0, exp10 = 0;
+    const char* start = p;
+    while (p < end && (unsigned)(*p - '0') < 10) {
+        if (digits < 19) { mant = mant * 10 + (unsigned)(*p - '0'); if (mant) digits++; }
+        else exp10++;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && (unsigned)(*p - '0') < 10) {
+            if (digits < 19) { mant = mant * 10 + (unsigned)(*p - '0'); if (mant) digits++; exp10--; }
+            p++;
+        }
+    }
+    if (p == start) { out = 0.0f; return p; }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool eneg = false;
+        if (q < end && (*q == '-' || *q == '+')) { eneg = (*q == '-'); q++; }
+        int e = 0;
+        if (q < end && (unsigned)(*q - '0') < 10) {
+            while (q < end && (unsigned)(*q - '0') < 10) { if (e < 10000) e = e * 10 + (*q - '0'); q++; }
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+    double v = (double)mant;
+    if (exp10 < 0) v = (exp10 >= -22) ? v / kPow10[-exp10] : v * pow(10.0, exp10);
+    else if (exp10 > 0) v = (exp10 <= 22) ? v * kPow10[exp10] : v * pow(10.0, exp10);
+    out = (float)(neg ? -v : v);
+    return p;
+}
+
+static const char* parseInt(const char* p, const char* end, int& out, bool& ok) {
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) { neg = (*p == '-'); p++; }
+    const char* start = p;
+    int v = 0;
+    while (p < end && (unsigned)(*p - '0') < 10) { v = v * 10 + (*p - '0'); p++; }
+    ok = p != start;
+    out = neg ? -v : v;
+    return p;
+}
+
+// -------------------- per-chunk parse --------------------
+const int kInheritMaterial = -2;   // faces before the first usemtl of a chunk
+
+struct ShapeStart {
+    string name;
+    size_t firstTriangle;
+};
+
+struct ObjChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    vector<float> v, vn, vt;
+    vector<tinyobj::index_t> indices;     // triangulated corners
+    vector<int> triMaterial;              // chunk-local material name id, or kInheritMaterial
+    vector<pair<size_t, int>> relative;   // (corner, component mask) of negative references
+    vector<size_t> quads;                 // first triangle of each quad, split 0-1-2 / 0-2-3 until merged
+    vector<ShapeStart> shapes;
+    vector<string> materialNames;
+    vector<string> mtllibs;
+    vector<const char*> badFaces;         // line starts of faces skipped for a corner that does not parse
+    int currentMaterial = kInheritMaterial;
+    // filled by the merge
+    size_t vBase = 0, vnBase = 0, vtBase = 0;
+};
+
+// Resolve one OBJ index (1-based, or negative = relative to the elements read so far)
+// into a 0-based index local to the chunk's own arrays for relative ones.
+static inline int resolveIndex(int raw, size_t localCount, bool& relative) {
+    relative = raw < 0;
+    return raw > 0 ? raw - 1 : (int)localCount + raw;
+}
+
+static bool parseFaceVertex(const char* p, const char* tokEnd, ObjChunk& c, tinyobj::index_t& idx, int& relMask) {
+    int raw; bool ok, rel;
+    p = parseInt(p, tokEnd, raw, ok);
+    if (!ok || raw == 0) return false;
+    idx.vertex_index = resolveIndex(raw, c.v.size() / 3, rel);
+    relMask = rel ? 1 : 0;
+    idx.texcoord_index = -1; idx.normal_index = -1;
+    if (p < tokEnd && *p == '/') {
+        p++;
+        if (p < tokEnd && *p != '/') {
+            p = parseInt(p, tokEnd, raw, ok);
+            if (!ok || raw == 0) return false;
+            idx.texcoord_index = resolveIndex(raw, c.vt.size() / 2, rel);
+            relMask |= rel ? 2 : 0;
+        }
+        if (p < tokEnd && *p == '/') {
+            p++;
+            p = parseInt(p, tokEnd, raw, ok);
+            if (!ok || raw == 0) return false;
+            idx.normal_index = resolveIndex(raw, c.vn.size() / 3, rel);
+            relMask |= rel ? 4 : 0;
+        }
+    }
+    return p == tokEnd;
+}
+
+static string restOfLine(const char* p, const char* eol) {
+    p = skipSpace(p, eol);
+    const char* e = eol;
+    while (e > p && (e[-1] == '\r' || e[-1] == ' ' || e[-1] == '\t')) e--;
+    return string(p, e);
+}
+
+static void parseChunk(ObjChunk& c) {
+    const char* p = c.begin;
+    const char* end = c.end;
+    // rough reservation: OBJ records average ~30 bytes
+    size_t guess = (size_t)(end - p) / 30;
+    c.v.reserve(guess); c.indices.reserve(guess * 2);
+    vector<tinyobj::index_t> poly;   // corners of the current face, any count
+    vector<int> polyRel;
+    while (p < end) {
+        const char* eol = findLineEnd(p, end);
+        const char* q = skipSpace(p, eol);
+        if (q < eol) {
+            char c0 = q[0], c1 = (q + 1 < eol) ? q[1] : '\0';
+            bool sep1 = (c1 == ' ' || c1 == '\t');
+            if (c0 == 'v' && sep1) {
+                float x, y, z;
+                q = parseFloat(q + 2, eol, x); q = parseFloat(q, eol, y); parseFloat(q, eol, z);
+                c.v.push_back(x); c.v.push_back(y); c.v.push_back(z);
+            }
+            else if (c0 == 'v' && c1 == 'n') {
+                float x, y, z;
+                q = parseFloat(q + 2, eol, x); q = parseFloat(q, eol, y); parseFloat(q, eol, z);
+                c.vn.push_back(x); c.vn.push_back(y); c.vn.push_back(z);
+            }
+            else if (c0 == 'v' && c1 == 't') {
+                float u, v;
+                q = parseFloat(q + 2, eol, u); parseFloat(q, eol, v);
+                c.vt.push_back(u); c.vt.push_back(v);
+            }
+            else if (c0 == 'f' && sep1) {
+                poly.clear();
+                polyRel.clear();
+                bool bad = false;
+                q += 2;
+                while (true) {
+                    q = skipSpace(q, eol);
+                    const char* tokEnd = q;
+                    while (tokEnd < eol && *tokEnd != ' ' && *tokEnd != '\t' && *tokEnd != '\r') tokEnd++;
+                    if (tokEnd == q || *q == '#') break;
+                    tinyobj::index_t idx;
+                    int rel;
+                    if (parseFaceVertex(q, tokEnd, c, idx, rel)) { poly.push_back(idx); polyRel.push_back(rel); }
+                    else bad = true;
+                    q = tokEnd;
+                }
+                // a face with a broken corner is skipped whole rather than drawn with a hole; the
+                // driver reports its line
+                int n = bad ? 0 : (int)poly.size();
+                if (bad) c.badFaces.push_back(p);
+                // quads are split along the shorter diagonal once all positions are known (as tinyobj
+                // does); larger polygons are fanned
+                if (n == 4) c.quads.push_back(c.indices.size() / 3);
+                for (int k = 1; k + 1 < n; k++) {
+                    int corner[3] = { 0, k, k + 1 };
+                    for (int j = 0; j < 3; j++) {
+                        if (polyRel[corner[j]]) c.relative.push_back(make_pair(c.indices.size(), polyRel[corner[j]]));
+                        c.indices.push_back(poly[corner[j]]);
+                    }
+                    c.triMaterial.push_back(c.currentMaterial);
+                }
+            }
+            else if ((c0 == 'o' || c0 == 'g') && sep1) {
+                ShapeStart s = { restOfLine(q + 1, eol), c.indices.size() / 3 };
+                c.shapes.push_back(s);
+            }
+            else if (eol - q > 7 && memcmp(q, "usemtl", 6) == 0) {
+                string name = restOfLine(q + 6, eol);
+                int id = -1;
+                for (size_t i = 0; i < c.materialNames.size(); i++) if (c.materialNames[i] == name) id = (int)i;
+                if (id < 0) { id = (int)c.materialNames.size(); c.materialNames.push_back(name); }
+                c.currentMaterial = id;
+            }
+            else if (eol - q > 7 && memcmp(q, "mtllib", 6) == 0) {
+                stringstream ss(restOfLine(q + 6, eol));
+                string name;
+                while (ss >> name) c.mtllibs.push_back(name);
+            }
+        }
+        p = eol + 1;
+    }
+}
+
+// -------------------- record counting --------------------
+static void countLines(const char* p, const char* end, ObjRecordCounts& counts) {
+    while (p < end) {
+        const char* eol = findLineEnd(p, end);
+        const char* q = skipSpace(p, eol);
+        if (eol - q >= 2) {
+            char c0 = q[0], c1 = q[1];
+            if (c0 == 'v' && (c1 == ' ' || c1 == '\t')) counts.positions++;
+            else if (c0 == 'v' && c1 == 'n') counts.normals++;
+            else if (c0 == 'v' && c1 == 't') counts.texcoords++;
+            else if (c0 == 'f' && (c1 == ' ' || c1 == '\t')) {
+                // corners = whitespace-separated groups after the 'f'
+                size_t corners = 0;
+                bool inToken = false;
+                for (const char* r = q + 1; r < eol && *r != '#'; r++) {
+                    bool space = (*r == ' ' || *r == '\t' || *r == '\r');
+                    if (!space && !inToken) corners++;
+                    inToken = !space;
+                }
+                if (corners >= 3) counts.triangles += corners - 2;
+            }
+        }
+        p = eol + 1;
+    }
+}
+
+// Reads through a fixed 1 MB window instead of mapping the file: touched pages of a mapping count
+// towards the resident set, which would defeat the point of a streaming import.
+bool countObjRecords(const string& path, ObjRecordCounts& counts) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    counts = ObjRecordCounts();
+    vector<char> buf(1 << 20);
+    size_t carry = 0;   // bytes of an unfinished line kept from the previous block
+    for (;;) {
+        if (carry == buf.size()) buf.resize(buf.size() * 2);   // a single line longer than the window
+        size_t got = fread(buf.data() + carry, 1, buf.size() - carry, f);
+        size_t filled = carry + got;
+        if (got == 0) {
+            countLines(buf.data(), buf.data() + filled, counts);
+            break;
+        }
+        size_t complete = filled;
+        while (complete > 0 && buf[complete - 1] != '\n') complete--;
+        countLines(buf.data(), buf.data() + complete, counts);
+        carry = filled - complete;
+        memmove(buf.data(), buf.data() + complete, carry);
+    }
+    fclose(f);
+    return true;
+}
+
+// -------------------- driver --------------------
+bool parseObjParallel(const string& path, tinyobj::attrib_t& attrib, vector<tinyobj::shape_t>& shapes,
+                      vector<tinyobj::material_t>& materials, string& warn, string& err,
+                      const string& mtlBaseDir, unsigned threads) {
+    MappedFile file;
+    if (!file.open(path)) { err += "Cannot open file [" + path + "]\n"; return false; }
+    const char* data = file.data();
+    const char* dataEnd = data + file.size();
+    if (file.size() >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) data += 3;
+
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    // small files are not worth the thread start-up
+    const size_t minChunk = 1 << 20;
+    size_t chunkCount = min((size_t)threads, (size_t)(dataEnd - data) / minChunk + 1);
+    vector<ObjChunk> chunks(chunkCount);
+    const char* p = data;
+    for (size_t i = 0; i < chunkCount; i++) {
+        chunks[i].begin = p;
+        const char* cut = (i + 1 == chunkCount) ? dataEnd : data + (dataEnd - data) * (i + 1) / chunkCount;
+        if (cut < p) cut = p;
+        cut = findLineEnd(cut, dataEnd);
+        chunks[i].end = cut;
+        p = (cut < dataEnd) ? cut + 1 : dataEnd;
+    }
+
+    vector<thread> workers;
+    for (size_t i = 1; i < chunkCount; i++) workers.emplace_back(parseChunk, ref(chunks[i]));
+    parseChunk(chunks[0]);
+    for (auto& w : workers) w.join();
+    workers.clear();
+
+    size_t line = 1;
+    const char* counted = data;
+    for (auto& c : chunks) {
+        for (const char* face : c.badFaces) {
+            line += count(counted, face, '\n');
+            counted = face;
+            warn += "Skipped face with a malformed corner at line " + to_string(line) + " of [" + path + "]\n";
+        }
+    }
+
+    // materials, loaded in the order their mtllib lines appear
+    map<string, int> materialMap;
+    set<string> loadedLibs;
+    materials.clear();
+    for (auto& c : chunks) {
+        for (auto& lib : c.mtllibs) {
+            if (!loadedLibs.insert(lib).second) continue;
+            ifstream in(mtlBaseDir + lib);
+            if (!in) { warn += "Material file [ " + mtlBaseDir + lib + " ] not found.\n"; continue; }
+            tinyobj::LoadMtl(&materialMap, &materials, &in, &warn, &err);
+        }
+    }
+
+    // global offsets, then copy attribute arrays in parallel
+    size_t nv = 0, nvn = 0, nvt = 0;
+    for (auto& c : chunks) {
+        c.vBase = nv; c.vnBase = nvn; c.vtBase = nvt;
+        nv += c.v.size() / 3; nvn += c.vn.size() / 3; nvt += c.vt.size() / 2;
+    }
+    attrib = tinyobj::attrib_t();
+    attrib.vertices.resize(nv * 3);
+    attrib.normals.resize(nvn * 3);
+    attrib.texcoords.resize(nvt * 2);
+    auto copyChunk = [&](size_t i) {
+        ObjChunk& c = chunks[i];
+        if (!c.v.empty()) memcpy(&attrib.vertices[c.vBase * 3], c.v.data(), c.v.size() * sizeof(float));
+        if (!c.vn.empty()) memcpy(&attrib.normals[c.vnBase * 3], c.vn.data(), c.vn.size() * sizeof(float));
+        if (!c.vt.empty()) memcpy(&attrib.texcoords[c.vtBase * 2], c.vt.data(), c.vt.size() * sizeof(float));
+        vector<float>().swap(c.v); vector<float>().swap(c.vn); vector<float>().swap(c.vt);
+        for (auto& r : c.relative) {
+            tinyobj::index_t& idx = c.indices[r.first];
+            if (r.second & 1) idx.vertex_index += (int)c.vBase;
+            if (r.second & 2) idx.texcoord_index += (int)c.vtBase;
+            if (r.second & 4) idx.normal_index += (int)c.vnBase;
+        }
+    };
+    for (size_t i = 1; i < chunkCount; i++) workers.emplace_back(copyChunk, i);
+    copyChunk(0);
+    for (auto& w : workers) w.join();
+
+    // reject out-of-range references instead of letting the importer read past the arrays
+    for (auto& c : chunks) {
+        for (auto& idx : c.indices) {
+            if (idx.vertex_index < 0 || (size_t)idx.vertex_index >= nv || idx.normal_index < -1 || idx.texcoord_index < -1 ||
+                idx.normal_index >= (int)nvn || idx.texcoord_index >= (int)nvt) {
+                err += "Face index out of range in [" + path + "]\n";
+                return false;
+            }
+        }
+    }
+
+    for (auto& c : chunks) {
+        for (size_t t : c.quads) {
+            tinyobj::index_t* q = &c.indices[3 * t];
+            tinyobj::index_t q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[5];
+            const float* p0 = &attrib.vertices[3 * q0.vertex_index];
+            const float* p1 = &attrib.vertices[3 * q1.vertex_index];
+            const float* p2 = &attrib.vertices[3 * q2.vertex_index];
+            const float* p3 = &attrib.vertices[3 * q3.vertex_index];
+            float sqr02 = 0.0f, sqr13 = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                sqr02 += (p2[k] - p0[k]) * (p2[k] - p0[k]);
+                sqr13 += (p3[k] - p1[k]) * (p3[k] - p1[k]);
+            }
+            if (sqr02 < sqr13) continue;
+            q[0] = q0; q[1] = q1; q[2] = q3;
+            q[3] = q1; q[4] = q2; q[5] = q3;
+        }
+    }
+
+    // shapes and per-face materials, in file order
+    shapes.clear();
+    int carriedMaterial = -1;
+    set<string> missingMaterials;
+    for (auto& c : chunks) {
+        vector<int> globalIds(c.materialNames.size(), -1);
+        for (size_t i = 0; i < c.materialNames.size(); i++) {
+            auto it = materialMap.find(c.materialNames[i]);
+            if (it != materialMap.end()) globalIds[i] = it->second;
+            else if (missingMaterials.insert(c.materialNames[i]).second)
+                warn += "material [ '" + c.materialNames[i] + "' ] not found in .mtl\n";
+        }
+        size_t triCount = c.indices.size() / 3;
+        size_t s = 0;
+        size_t t = 0;
+        while (t < triCount || s < c.shapes.size()) {
+            if (s < c.shapes.size() && c.shapes[s].firstTriangle == t) {
+                // an empty shape is replaced by the next o/g, as tinyobj does
+                if (shapes.empty() || !shapes.back().mesh.indices.empty()) shapes.push_back(tinyobj::shape_t());
+                shapes.back().name = c.shapes[s].name;
+                s++;
+                continue;
+            }
+            size_t stop = (s < c.shapes.size()) ? c.shapes[s].firstTriangle : triCount;
+            if (shapes.empty()) shapes.push_back(tinyobj::shape_t());
+            tinyobj::mesh_t& m = shapes.back().mesh;
+            m.indices.insert(m.indices.end(), c.indices.begin() + 3 * t, c.indices.begin() + 3 * stop);
+            m.num_face_vertices.insert(m.num_face_vertices.end(), stop - t, 3u);
+            for (size_t k = t; k < stop; k++) {
+                int local = c.triMaterial[k];
+                m.material_ids.push_back(local == kInheritMaterial ? carriedMaterial : globalIds[local]);
+            }
+            t = stop;
+        }
+        if (c.currentMaterial != kInheritMaterial) carriedMaterial = globalIds[c.currentMaterial];
+        vector<tinyobj::index_t>().swap(c.indices);
+    }
+    if (!shapes.empty() && shapes.back().mesh.indices.empty()) shapes.pop_back();
+    return true;
+}
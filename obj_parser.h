@@ -0,0 +1,28 @@
+// obj_parser.h
+// Multithreaded OBJ parser producing the same attrib_t / shape_t structures as tinyobj::LoadObj.
+// The file is memory-mapped, split on line boundaries into one chunk per worker, parsed in
+// parallel and merged in file order.
+//
+// Differences from tinyobj::LoadObj: polygons are fan-triangulated, and only v/vn/vt positions
+// are stored (no vertex weights, vertex colors, smoothing groups, lines or points).
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+
+// threads = 0 uses std::thread::hardware_concurrency(). MTL files are looked up in mtlBaseDir.
+bool parseObjParallel(const std::string& path, tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes,
+                      std::vector<tinyobj::material_t>& materials, std::string& warn, std::string& err,
+                      const std::string& mtlBaseDir, unsigned threads = 0);
+
+struct ObjRecordCounts {
+    size_t positions = 0, normals = 0, texcoords = 0;
+    size_t triangles = 0;   // after triangulating every f record
+};
+
+// Count records without parsing values (memory-mapped, SIMD line scan); used to size output
+// buffers before a streaming import.
+bool countObjRecords(const std::string& path, ObjRecordCounts& counts);
@@ -0,0 +1,23 @@
+// parallel.h
+// Minimal fork-join helper for the import stages: split an index range across std::threads.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Calls body(begin, end) on up to threads contiguous chunks of [0, count) and waits for all of them;
+// threads = 0 uses std::thread::hardware_concurrency(). Ranges below minChunk items per thread run inline.
+template<class Body>
+void parallelFor(size_t count, unsigned threads, Body body, size_t minChunk = 16384) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunks = std::min((size_t)threads, count / minChunk + 1);
+    if (chunks <= 1) { body((size_t)0, count); return; }
+    std::vector<std::thread> workers;
+    size_t step = (count + chunks - 1) / chunks;
+    for (size_t begin = 0; begin < count; begin += step)
+        workers.emplace_back(body, begin, std::min(begin + step, count));
+    for (auto& w : workers) w.join();
+}
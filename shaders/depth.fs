@@ -0,0 +1,4 @@
+#version 330 core
+// depth only; color writes are masked
+void main() {
+}
@@ -0,0 +1,17 @@
+#version 330 core
+layout(location=0) in vec3 aPos;   // float, or unorm16 in the mesh AABB (compact format)
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 posOffset;
+uniform vec3 posScale;
+
+// same math as pbr.vs, so the PBR pass can test GL_LEQUAL against this depth
+invariant gl_Position;
+
+void main() {
+    vec3 pos = posOffset + aPos * posScale;
+    vec3 worldPos = vec3(model * vec4(pos, 1.0));
+    gl_Position = projection * view * vec4(worldPos, 1.0);
+}
@@ -3,12 +3,32 @@ out vec4 FragColor;
 in vec3 WorldPos;
 in vec3 Normal;
 in vec2 TexCoords;
+in vec4 Tangent;
 
 uniform sampler2D albedoMap;
 uniform sampler2D normalMap;
+// virtual albedo (virtual_texture.h): the page table has a texel per tile and level holding the
+// atlas slot (rg) and level (b) of that tile or of its nearest resident ancestor; alpha 0 while
+// neither is resident
+uniform bool virtualAlbedo;
+uniform sampler2D vtAtlas;
+uniform sampler2D vtPageTable;
+uniform vec2 vtScale;        // image size / vtSize
+uniform float vtSize;        // virtual address space at level 0, texels per side
+uniform int vtLevelCount;
+uniform vec3 vtTile;         // tile content, border and slot size, in texels
+uniform vec2 vtAtlasTexel;   // 1 / atlas size
+#ifdef PACKED_ORM
+uniform sampler2D ormMap;   // occlusion, roughness, metallic in r, g, b
+#else
 uniform sampler2D metallicMap;
 uniform sampler2D roughnessMap;
 uniform sampler2D aoMap;
+#endif
+// material constants (MTL Kd / Pm / Pr), 1 when the matching map is set
+uniform vec3 baseColorFactor;
+uniform float metallicFactor;
+uniform float roughnessFactor;
 
 uniform vec3 camPos;
 uniform vec3 lightPosA;
@@ -46,12 +66,48 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0) {
 }
 // ----------------------------------------------------------------------------
 
+// Bilinear from the one level the derivatives ask for (vt_feedback.fs requests the same tile), or
+// from the nearest coarser one that is resident; the tile border covers the filter footprint.
+vec3 sampleVirtualAlbedo(vec2 uv) {
+    vec2 texel = uv * vtScale * vtSize;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+    int level = clamp(int(floor(lod)), 0, vtLevelCount - 1);
+    vec2 pos = fract(uv) * vtScale * vtSize;
+    ivec2 tile = ivec2(pos / (vtTile.x * exp2(float(level))));
+    vec4 page = texelFetch(vtPageTable, tile, level);
+    if (page.a == 0.0) return vec3(1.0);
+    int resident = int(page.b * 255.0 + 0.5);
+    ivec2 ancestor = tile >> (resident - level);
+    vec2 inTile = pos / exp2(float(resident)) - vec2(ancestor) * vtTile.x;
+    vec2 atlas = floor(page.rg * 255.0 + 0.5) * vtTile.z + vtTile.y + inTile;
+    return textureLod(vtAtlas, atlas * vtAtlasTexel, 0.0).rgb;
+}
+
 void main() {
-    vec3 albedo = pow(texture(albedoMap, TexCoords).rgb, vec3(2.2)); // gamma to linear
-    float metal = texture(metallicMap, TexCoords).r;
-    float roughness = texture(roughnessMap, TexCoords).r;
+    // sRGB formats decode to linear when sampled
+    vec3 albedo = (virtualAlbedo ? sampleVirtualAlbedo(TexCoords) : texture(albedoMap, TexCoords).rgb) * baseColorFactor;
+#ifdef PACKED_ORM
+    vec3 orm = texture(ormMap, TexCoords).rgb;
+    float metal = orm.b * metallicFactor;
+    float roughness = orm.g * roughnessFactor;
+    float ao = orm.r;
+#else
+    float metal = texture(metallicMap, TexCoords).r * metallicFactor;
+    float roughness = texture(roughnessMap, TexCoords).r * roughnessFactor;
     float ao = texture(aoMap, TexCoords).r;
+#endif
+    // tangent-space normal map; meshes without tangents (all zero) keep the vertex normal
     vec3 N = normalize(Normal);
+    vec3 T = Tangent.xyz - N * dot(N, Tangent.xyz);
+    if (dot(T, T) > 1e-8) {
+        T = normalize(T);
+        vec3 B = cross(N, T) * (Tangent.w < 0.0 ? -1.0 : 1.0);
+        // x and y only: BC5 normal maps carry no z
+        vec2 xy = texture(normalMap, TexCoords).xy * 2.0 - 1.0;
+        vec3 tn = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+        N = normalize(mat3(T, B, N) * tn);
+    }
     vec3 V = normalize(camPos - WorldPos);
     vec3 R = reflect(-V, N);
 
@@ -1,20 +1,40 @@
 #version 330 core
-layout(location=0) in vec3 aPos;
-layout(location=1) in vec3 aNormal;
+layout(location=0) in vec3 aPos;      // float, or unorm16 in the mesh AABB (compact format)
+layout(location=1) in vec4 aNormal;   // float (w = 1), or snorm 10_10_10_2 with the bitangent sign in w
 layout(location=2) in vec2 aTex;
+layout(location=3) in vec4 aTangent;  // float xyz + bitangent sign, or octahedral unorm8 in xy
 
 out vec3 WorldPos;
 out vec3 Normal;
 out vec2 TexCoords;
+out vec4 Tangent;   // world space, w = bitangent sign
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+// position dequantization: identity (0, 1) for float vertices
+uniform vec3 posOffset;
+uniform vec3 posScale;
+// compact vertices: tangent is octahedral, its sign comes from aNormal.w
+uniform bool octTangents;
+
+invariant gl_Position;   // matches depth.vs for the z-prepass
+
+vec3 octDecode(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0) v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
 
 void main() {
     mat4 mv = view * model;
-    WorldPos = vec3(model * vec4(aPos,1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    vec3 pos = posOffset + aPos * posScale;
+    WorldPos = vec3(model * vec4(pos,1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal.xyz;
+    vec3 tangent = octTangents ? octDecode(aTangent.xy) : aTangent.xyz;
+    float bitangentSign = octTangents ? (aNormal.w < 0.0 ? -1.0 : 1.0) : aTangent.w;
+    Tangent = vec4(mat3(model) * tangent, bitangentSign);
     TexCoords = aTex;
     gl_Position = projection * view * vec4(WorldPos, 1.0);
 }
@@ -0,0 +1,24 @@
+#version 330 core
+// Virtual texture feedback (virtual_texture.h), drawn with pbr.vs into a buffer a fraction of the
+// screen size: per pixel, the tile and level its virtual albedo would sample (same math as
+// sampleVirtualAlbedo in pbr.fs) and the texture's id; 0 where the material has none.
+out vec4 FragColor;
+in vec2 TexCoords;
+
+uniform int vtId;            // 1..255, 0 = not virtual
+uniform vec2 vtScale;        // image size / vtSize
+uniform float vtSize;        // virtual address space at level 0, texels per side
+uniform int vtLevelCount;
+uniform float vtTileSize;
+uniform float lodBias;       // log2 of the downscale: derivatives here are that much larger
+
+void main() {
+    if (vtId == 0) { FragColor = vec4(0.0); return; }
+    vec2 texel = TexCoords * vtScale * vtSize;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) - lodBias;
+    int level = clamp(int(floor(lod)), 0, vtLevelCount - 1);
+    vec2 pos = fract(TexCoords) * vtScale * vtSize;
+    vec2 tile = floor(pos / (vtTileSize * exp2(float(level))));
+    FragColor = vec4(tile, float(level), float(vtId)) / 255.0;
+}
@@ -0,0 +1,151 @@
+// texture_cache.cpp
+
+#include "texture_cache.h"
+
+#include "mapped_file.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+// -------------------- file layout --------------------
+// "DDS " [DdsHeader][DdsHeaderDx10][levels, largest first, tightly packed]
+struct DdsPixelFormat {
+    uint32_t size, flags, fourCC, rgbBitCount, rMask, gMask, bMask, aMask;
+};
+
+struct DdsHeader {
+    uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount;
+    uint32_t reserved1[11];   // [0] kTextureCacheTag, [1] version, [2..3] source hash
+    DdsPixelFormat pixelFormat;
+    uint32_t caps, caps2, caps3, caps4, reserved2;
+};
+
+struct DdsHeaderDx10 {
+    uint32_t dxgiFormat, resourceDimension, miscFlag, arraySize, miscFlags2;
+};
+
+static uint32_t fourCC(char a, char b, char c, char d) {
+    return (uint32_t)(unsigned char)a | (uint32_t)(unsigned char)b << 8 | (uint32_t)(unsigned char)c << 16 | (uint32_t)(unsigned char)d << 24;
+}
+
+static const uint32_t kDdsFlags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;   // caps, height, width, pixel format, mips, linear size
+static const uint32_t kDdsCaps = 0x8 | 0x1000 | 0x400000;                          // complex, texture, mipmap
+static const uint32_t kDdsFourCCFlag = 0x4;
+static const uint32_t kDdsTexture2D = 3;
+static const uint32_t kTextureCacheTag = fourCC('H', 'O', 'G', 'L');
+
+// the _SRGB variants follow their UNORM format
+static uint32_t dxgiFormat(TextureCodec codec, bool srgb) {
+    switch (codec) {
+    case TextureBC1: return srgb ? 72 : 71;     // DXGI_FORMAT_BC1_UNORM
+    case TextureBC4: return 80;                 // DXGI_FORMAT_BC4_UNORM
+    case TextureBC5: return 83;                 // DXGI_FORMAT_BC5_UNORM
+    case TextureBC7: return srgb ? 99 : 98;     // DXGI_FORMAT_BC7_UNORM
+    case TextureRGBA8: return srgb ? 29 : 28;   // DXGI_FORMAT_R8G8B8A8_UNORM
+    default: return 0;
+    }
+}
+
+string textureCachePath(const string& imagePath, TextureCodec codec) {
+    string name = textureCodecName(codec);
+    for (char& c : name) c = (char)tolower((unsigned char)c);
+    return imagePath + "." + name + ".dds";
+}
+
+uint64_t hashTextureSource(const string& imagePath, TextureCodec codec, const MipOptions& mips, bool flip) {
+    MappedFile image;
+    if (!image.open(imagePath)) return 0;
+    uint64_t h = hashBytes(image.data(), image.size(), kTextureCacheVersion);
+    uint32_t key[5] = { (uint32_t)codec, flip ? 1u : 0u, (uint32_t)mips.filter, mips.srgb ? 1u : 0u, mips.normalMap ? 1u : 0u };
+    return hashBytes(key, sizeof(key), h);
+}
+
+bool writeTextureCache(const string& cachePath, const CompressedTexture& texture, uint64_t sourceHash) {
+    if (texture.codec == TextureRaw || texture.levels.empty()) return false;
+    DdsHeader hdr = {};
+    hdr.size = sizeof(DdsHeader);
+    hdr.flags = kDdsFlags;
+    hdr.width = (uint32_t)texture.levels[0].width;
+    hdr.height = (uint32_t)texture.levels[0].height;
+    hdr.pitchOrLinearSize = (uint32_t)texture.levels[0].size;   // whole level, or row pitch for RGBA8
+    if (texture.codec == TextureRGBA8) hdr.pitchOrLinearSize = (uint32_t)texture.levels[0].width * 4;
+    hdr.depth = 1;
+    hdr.mipMapCount = (uint32_t)texture.levels.size();
+    hdr.reserved1[0] = kTextureCacheTag;
+    hdr.reserved1[1] = kTextureCacheVersion;
+    memcpy(&hdr.reserved1[2], &sourceHash, sizeof(sourceHash));
+    hdr.pixelFormat.size = sizeof(DdsPixelFormat);
+    hdr.pixelFormat.flags = kDdsFourCCFlag;
+    hdr.pixelFormat.fourCC = fourCC('D', 'X', '1', '0');
+    hdr.caps = kDdsCaps;
+    DdsHeaderDx10 dx10 = {};
+    dx10.dxgiFormat = dxgiFormat(texture.codec, texture.srgb);
+    dx10.resourceDimension = kDdsTexture2D;
+    dx10.arraySize = 1;
+
+    // write to a temp file and rename, so a crash never leaves a truncated cache behind
+    string tmp = cachePath + ".tmp";
+    {
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out) { cerr << "Failed to write texture cache: " << tmp << "\n"; return false; }
+        out.write("DDS ", 4);
+        out.write((const char*)&hdr, sizeof(hdr));
+        out.write((const char*)&dx10, sizeof(dx10));
+        out.write((const char*)texture.data.data(), (streamsize)texture.data.size());
+        if (!out) { cerr << "Failed to write texture cache: " << tmp << "\n"; return false; }
+    }
+    remove(cachePath.c_str());
+    if (rename(tmp.c_str(), cachePath.c_str()) != 0) {
+        cerr << "Failed to rename texture cache: " << tmp << "\n";
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool openTextureCache(const string& cachePath, uint64_t sourceHash, CompressedTexture& out) {
+    MappedFile file;
+    if (!file.open(cachePath)) return false;
+    const size_t headerBytes = 4 + sizeof(DdsHeader) + sizeof(DdsHeaderDx10);
+    if (file.size() < headerBytes || memcmp(file.data(), "DDS ", 4) != 0) return false;
+    DdsHeader hdr;
+    DdsHeaderDx10 dx10;
+    memcpy(&hdr, file.data() + 4, sizeof(hdr));
+    memcpy(&dx10, file.data() + 4 + sizeof(hdr), sizeof(dx10));
+    uint64_t hash;
+    memcpy(&hash, &hdr.reserved1[2], sizeof(hash));
+    if (hdr.reserved1[0] != kTextureCacheTag || hdr.reserved1[1] != kTextureCacheVersion || hash != sourceHash) return false;
+    if (hdr.pixelFormat.fourCC != fourCC('D', 'X', '1', '0') || dx10.resourceDimension != kDdsTexture2D) return false;
+    TextureCodec codec = TextureRaw;
+    bool srgb = false;
+    for (TextureCodec c : { TextureBC1, TextureBC4, TextureBC5, TextureBC7, TextureRGBA8 })
+        for (bool s : { false, true })
+            if (dxgiFormat(c, s) == dx10.dxgiFormat) { codec = c; srgb = s; }
+    if (codec == TextureRaw || hdr.width == 0 || hdr.height == 0 || hdr.mipMapCount == 0 || hdr.mipMapCount > 32) return false;
+
+    CompressedTexture t;
+    t.codec = codec;
+    t.srgb = srgb;
+    int w = (int)hdr.width, h = (int)hdr.height;
+    size_t offset = 0;
+    for (uint32_t i = 0; i < hdr.mipMapCount; i++) {
+        CompressedLevel l;
+        l.width = w;
+        l.height = h;
+        l.offset = offset;
+        l.size = compressedLevelBytes(codec, w, h);
+        offset += l.size;
+        t.levels.push_back(l);
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    if (headerBytes + offset > file.size()) return false;
+    t.data.assign(file.data() + headerBytes, file.data() + headerBytes + offset);
+    out = std::move(t);
+    return true;
+}
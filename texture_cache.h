@@ -0,0 +1,26 @@
+// texture_cache.h
+// Block-compressed (or RGBA8) textures cached next to their source image as DDS files (DX10 header,
+// full CPU-built mip chain), so later runs upload them without decoding, filtering or encoding. The
+// source hash lives in the header's reserved words, where DDS readers ignore it.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "texture_compress.h"
+
+// bump whenever the file layout or the encoders' output changes
+const uint32_t kTextureCacheVersion = 2;
+
+// Cache file used for an image ("albedo.png", BC7 -> "albedo.png.bc7.dds").
+std::string textureCachePath(const std::string& imagePath, TextureCodec codec);
+
+// Hash of the image bytes, the codec, the mip options, the flip and the cache version. Returns 0
+// when the image cannot be read.
+uint64_t hashTextureSource(const std::string& imagePath, TextureCodec codec, const MipOptions& mips, bool flip);
+
+bool writeTextureCache(const std::string& cachePath, const CompressedTexture& texture, uint64_t sourceHash);
+
+// Reads the cache, validating magic, format, source hash and level sizes.
+bool openTextureCache(const std::string& cachePath, uint64_t sourceHash, CompressedTexture& out);
@@ -0,0 +1,350 @@
+// texture_compress.cpp
+// Endpoints come from the principal axis of each block's texels (BC1, BC7) or its range (BC4),
+// indices from the nearest palette entry; BC7 refits its endpoints to the chosen indices once.
+
+#include "texture_compress.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+const char* textureCodecName(TextureCodec codec) {
+    switch (codec) {
+    case TextureBC1: return "BC1";
+    case TextureBC4: return "BC4";
+    case TextureBC5: return "BC5";
+    case TextureBC7: return "BC7";
+    case TextureRGBA8: return "RGBA8";
+    default: return "raw";
+    }
+}
+
+size_t textureBlockBytes(TextureCodec codec) {
+    if (codec == TextureRGBA8) return 64;
+    return (codec == TextureBC1 || codec == TextureBC4) ? 8 : 16;
+}
+
+size_t compressedLevelBytes(TextureCodec codec, int width, int height) {
+    if (codec == TextureRGBA8) return (size_t)width * height * 4;
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * textureBlockBytes(codec);
+}
+
+// -------------------- block helpers --------------------
+static float distance2(const float* a, const float* b, int n) {
+    float d = 0.0f;
+    for (int c = 0; c < n; c++) d += (a[c] - b[c]) * (a[c] - b[c]);
+    return d;
+}
+
+// Mean and principal axis of the first n channels of the 16 texels (power iteration on the
+// covariance, started from the texel farthest from the mean: a fixed start vector misses axes
+// orthogonal to it, such as two colours whose difference sums to zero); the axis is zero for a
+// flat block.
+static void principalAxis(const float (*px)[4], int n, float* mean, float* axis) {
+    for (int c = 0; c < 4; c++) mean[c] = axis[c] = 0.0f;
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < n; c++) mean[c] += px[i][c] / 16.0f;
+    float cov[4][4] = {};
+    for (int i = 0; i < 16; i++)
+        for (int a = 0; a < n; a++)
+            for (int b = 0; b < n; b++) cov[a][b] += (px[i][a] - mean[a]) * (px[i][b] - mean[b]);
+    int farthest = 0;
+    for (int i = 1; i < 16; i++)
+        if (distance2(px[i], mean, n) > distance2(px[farthest], mean, n)) farthest = i;
+    float v[4] = {};
+    for (int c = 0; c < n; c++) v[c] = px[farthest][c] - mean[c];
+    for (int iter = 0; iter < 8; iter++) {
+        float w[4] = {}, len = 0.0f;
+        for (int a = 0; a < n; a++) {
+            for (int b = 0; b < n; b++) w[a] += cov[a][b] * v[b];
+            len += w[a] * w[a];
+        }
+        if (len < 1e-12f) return;
+        len = sqrtf(len);
+        for (int a = 0; a < n; a++) v[a] = w[a] / len;
+    }
+    for (int c = 0; c < n; c++) axis[c] = v[c];
+}
+
+// Projection range of the texels along axis around mean.
+static void axisRange(const float (*px)[4], int n, const float* mean, const float* axis, float& tmin, float& tmax) {
+    tmin = 1e30f;
+    tmax = -1e30f;
+    for (int i = 0; i < 16; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < n; c++) t += (px[i][c] - mean[c]) * axis[c];
+        tmin = min(tmin, t);
+        tmax = max(tmax, t);
+    }
+}
+
+// Little-endian bit packing of a 64- or 128-bit block.
+struct BlockWriter {
+    unsigned char* out;
+    int bit = 0;
+    void write(uint32_t value, int count) {
+        for (int i = 0; i < count; i++, bit++)
+            if (value & (1u << i)) out[bit / 8] |= (unsigned char)(1u << (bit % 8));
+    }
+};
+
+// -------------------- BC1 --------------------
+static uint16_t packRgb565(const float* c) {
+    int r = min(max((int)lrintf(c[0] * 31.0f / 255.0f), 0), 31);
+    int g = min(max((int)lrintf(c[1] * 63.0f / 255.0f), 0), 63);
+    int b = min(max((int)lrintf(c[2] * 31.0f / 255.0f), 0), 31);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackRgb565(uint16_t v, float* c) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (float)((r << 3) | (r >> 2));
+    c[1] = (float)((g << 2) | (g >> 4));
+    c[2] = (float)((b << 3) | (b >> 2));
+}
+
+void encodeBlockBC1(const unsigned char* rgba, unsigned char* out) {
+    float px[16][4];
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++) px[i][c] = rgba[4 * i + c];
+    float mean[4], axis[4], tmin, tmax;
+    principalAxis(px, 3, mean, axis);
+    axisRange(px, 3, mean, axis, tmin, tmax);
+    // pull the endpoints in by 1/16 of the range: the extremes are rarely worth an exact match
+    float inset = (tmax - tmin) / 16.0f;
+    float e0[3], e1[3];
+    for (int c = 0; c < 3; c++) {
+        e0[c] = mean[c] + axis[c] * (tmax - inset);
+        e1[c] = mean[c] + axis[c] * (tmin + inset);
+    }
+    uint16_t c0 = packRgb565(e0), c1 = packRgb565(e1);
+    // c0 > c1 selects the four-colour mode
+    if (c0 < c1) swap(c0, c1);
+    memset(out, 0, 8);
+    memcpy(out, &c0, 2);
+    memcpy(out + 2, &c1, 2);
+    if (c0 == c1) return;
+    float palette[4][3];
+    unpackRgb565(c0, palette[0]);
+    unpackRgb565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+    uint32_t indices = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0;
+        float bestError = 1e30f;
+        for (int k = 0; k < 4; k++) {
+            float e = distance2(px[i], palette[k], 3);
+            if (e < bestError) { bestError = e; best = k; }
+        }
+        indices |= (uint32_t)best << (2 * i);
+    }
+    memcpy(out + 4, &indices, 4);
+}
+
+// -------------------- BC4 / BC5 --------------------
+void encodeBlockBC4(const unsigned char* rgba, int channel, unsigned char* out) {
+    int v[16], lo = 255, hi = 0;
+    for (int i = 0; i < 16; i++) {
+        v[i] = rgba[4 * i + channel];
+        lo = min(lo, v[i]);
+        hi = max(hi, v[i]);
+    }
+    memset(out, 0, 8);
+    out[0] = (unsigned char)hi;
+    out[1] = (unsigned char)lo;
+    if (hi == lo) return;
+    // a0 > a1: eight values, a0, a1 and six steps between them
+    int palette[8] = { hi, lo };
+    for (int k = 2; k < 8; k++) palette[k] = ((8 - k) * hi + (k - 1) * lo) / 7;
+    uint64_t indices = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0;
+        for (int k = 1; k < 8; k++)
+            if (abs(palette[k] - v[i]) < abs(palette[best] - v[i])) best = k;
+        indices |= (uint64_t)best << (3 * i);
+    }
+    for (int b = 0; b < 6; b++) out[2 + b] = (unsigned char)(indices >> (8 * b));
+}
+
+void encodeBlockBC5(const unsigned char* rgba, unsigned char* out) {
+    encodeBlockBC4(rgba, 0, out);
+    encodeBlockBC4(rgba, 1, out + 8);
+}
+
+// -------------------- BC7 (mode 6) --------------------
+// One subset, RGBA endpoints of 7 bits plus a p-bit per endpoint, 4-bit indices.
+static const int kBC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Endpoint to 7-bit channels with the p-bit that fits it best.
+static void quantizeBC7Endpoint(const float* e, int* q, int& p) {
+    float bestError = 1e30f;
+    for (int bit = 0; bit < 2; bit++) {
+        int cand[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            cand[c] = min(max((int)lrintf((e[c] - bit) / 2.0f), 0), 127);
+            float d = (float)(cand[c] * 2 + bit) - e[c];
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            p = bit;
+            memcpy(q, cand, sizeof(cand));
+        }
+    }
+}
+
+// Indices for the quantized endpoints; returns the squared error.
+static float assignBC7Indices(const float (*px)[4], const int* q0, int p0, const int* q1, int p1, int* indices) {
+    float palette[16][4];
+    for (int k = 0; k < 16; k++)
+        for (int c = 0; c < 4; c++) {
+            int a = q0[c] * 2 + p0, b = q1[c] * 2 + p1;
+            palette[k][c] = (float)(((64 - kBC7Weights4[k]) * a + kBC7Weights4[k] * b + 32) >> 6);
+        }
+    float total = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        int best = 0;
+        float bestError = 1e30f;
+        for (int k = 0; k < 16; k++) {
+            float e = distance2(px[i], palette[k], 4);
+            if (e < bestError) { bestError = e; best = k; }
+        }
+        indices[i] = best;
+        total += bestError;
+    }
+    return total;
+}
+
+// Least-squares endpoints for fixed indices; false when all texels use one weight.
+static bool refitBC7Endpoints(const float (*px)[4], const int* indices, float* e0, float* e1) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; i++) {
+        float w = kBC7Weights4[indices[i]] / 64.0f, u = 1.0f - w;
+        aa += u * u; ab += u * w; bb += w * w;
+        for (int c = 0; c < 4; c++) { ax[c] += u * px[i][c]; bx[c] += w * px[i][c]; }
+    }
+    float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f) return false;
+    for (int c = 0; c < 4; c++) {
+        e0[c] = min(max((ax[c] * bb - bx[c] * ab) / det, 0.0f), 255.0f);
+        e1[c] = min(max((bx[c] * aa - ax[c] * ab) / det, 0.0f), 255.0f);
+    }
+    return true;
+}
+
+void encodeBlockBC7(const unsigned char* rgba, unsigned char* out) {
+    float px[16][4];
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++) px[i][c] = rgba[4 * i + c];
+    float mean[4], axis[4], tmin, tmax, e0[4], e1[4];
+    principalAxis(px, 4, mean, axis);
+    axisRange(px, 4, mean, axis, tmin, tmax);
+    for (int c = 0; c < 4; c++) {
+        e0[c] = min(max(mean[c] + axis[c] * tmin, 0.0f), 255.0f);
+        e1[c] = min(max(mean[c] + axis[c] * tmax, 0.0f), 255.0f);
+    }
+    int q0[4], q1[4], p0, p1, indices[16];
+    quantizeBC7Endpoint(e0, q0, p0);
+    quantizeBC7Endpoint(e1, q1, p1);
+    float error = assignBC7Indices(px, q0, p0, q1, p1, indices);
+    for (int iter = 0; iter < 2 && error > 0.0f; iter++) {
+        int r0[4], r1[4], rp0, rp1, refit[16];
+        if (!refitBC7Endpoints(px, indices, e0, e1)) break;
+        quantizeBC7Endpoint(e0, r0, rp0);
+        quantizeBC7Endpoint(e1, r1, rp1);
+        float e = assignBC7Indices(px, r0, rp0, r1, rp1, refit);
+        if (e >= error) break;
+        error = e;
+        memcpy(q0, r0, sizeof(q0)); memcpy(q1, r1, sizeof(q1)); p0 = rp0; p1 = rp1;
+        memcpy(indices, refit, sizeof(indices));
+    }
+    // the first index is stored with 3 bits: its top bit must be 0
+    if (indices[0] & 8) {
+        swap(q0, q1);
+        swap(p0, p1);
+        for (int& i : indices) i = 15 - i;
+    }
+    memset(out, 0, 16);
+    BlockWriter w{ out };
+    w.write(1u << 6, 7);   // mode 6
+    for (int c = 0; c < 4; c++) {
+        w.write((uint32_t)q0[c], 7);
+        w.write((uint32_t)q1[c], 7);
+    }
+    w.write((uint32_t)p0, 1);
+    w.write((uint32_t)p1, 1);
+    w.write((uint32_t)indices[0], 3);
+    for (int i = 1; i < 16; i++) w.write((uint32_t)indices[i], 4);
+}
+
+// -------------------- driver --------------------
+typedef void (*BlockEncoder)(const unsigned char* rgba, unsigned char* out);
+
+static void encodeBlockBC4Red(const unsigned char* rgba, unsigned char* out) {
+    encodeBlockBC4(rgba, 0, out);
+}
+
+void compressImage(const unsigned char* rgba, int width, int height, TextureCodec codec, unsigned char* out, unsigned threads) {
+    if (codec == TextureRGBA8) {
+        memcpy(out, rgba, (size_t)width * height * 4);
+        return;
+    }
+    BlockEncoder encode = codec == TextureBC1 ? encodeBlockBC1 : codec == TextureBC4 ? encodeBlockBC4Red
+                        : codec == TextureBC5 ? encodeBlockBC5 : encodeBlockBC7;
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t blockBytes = textureBlockBytes(codec);
+    parallelFor((size_t)blocksY, threads, [&](size_t begin, size_t end) {
+        unsigned char block[64];
+        for (size_t by = begin; by < end; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                // texels past the edge repeat the last row / column
+                for (int j = 0; j < 4; j++) {
+                    int y = min((int)by * 4 + j, height - 1);
+                    for (int i = 0; i < 4; i++) {
+                        int x = min(bx * 4 + i, width - 1);
+                        memcpy(block + (j * 4 + i) * 4, &rgba[((size_t)y * width + x) * 4], 4);
+                    }
+                }
+                encode(block, out + (by * blocksX + bx) * blockBytes);
+            }
+        }
+    }, 8);
+}
+
+void compressTexture(const unsigned char* pixels, int width, int height, int channels, TextureCodec codec, const MipOptions& mips,
+                     CompressedTexture& out, unsigned threads) {
+    out.codec = codec;
+    out.srgb = mips.srgb;
+    out.levels.clear();
+    out.data.clear();
+    // everything is filtered and encoded from RGBA; grey (+ alpha) spreads to RGB
+    vector<unsigned char> rgba((size_t)width * height * 4);
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        const unsigned char* s = pixels + i * channels;
+        unsigned char* d = &rgba[i * 4];
+        d[0] = s[0];
+        d[1] = channels >= 3 ? s[1] : s[0];
+        d[2] = channels >= 3 ? s[2] : s[0];
+        d[3] = channels == 4 ? s[3] : channels == 2 ? s[1] : 255;
+    }
+    vector<MipLevel> chain;
+    buildMipChain(rgba.data(), width, height, mips, chain, threads);
+    for (const MipLevel& m : chain) {
+        CompressedLevel l;
+        l.width = m.width;
+        l.height = m.height;
+        l.offset = out.data.size();
+        l.size = compressedLevelBytes(codec, m.width, m.height);
+        out.data.resize(l.offset + l.size);
+        compressImage(m.rgba.data(), m.width, m.height, codec, &out.data[l.offset], threads);
+        out.levels.push_back(l);
+    }
+}
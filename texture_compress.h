@@ -0,0 +1,57 @@
+// texture_compress.h
+// CPU block compression of textures for upload without decoding: BC1 (RGB), BC4 (one channel),
+// BC5 (two channels, tangent-space normals) and BC7 (RGBA, mode 6 only), or plain RGBA8, each with
+// its mip chain (texture_mips.h). No GL dependency; texture_cache.h stores the result.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "texture_mips.h"
+
+enum TextureCodec {
+    TextureRaw,   // keep the decoded pixels
+    TextureBC1,
+    TextureBC4,
+    TextureBC5,
+    TextureBC7,
+    TextureRGBA8,   // uncompressed, for drivers without the formats above; still mipped and cached
+};
+
+const char* textureCodecName(TextureCodec codec);
+
+// bytes per 4x4 block (RGBA8 levels are not padded to whole blocks)
+size_t textureBlockBytes(TextureCodec codec);
+
+// Bytes of a width x height level (partial blocks at the edges count as whole ones).
+size_t compressedLevelBytes(TextureCodec codec, int width, int height);
+
+struct CompressedLevel {
+    int width = 0, height = 0;
+    size_t offset = 0, size = 0;   // in CompressedTexture::data
+};
+
+struct CompressedTexture {
+    TextureCodec codec = TextureRaw;
+    bool srgb = false;   // RGB is sRGB-encoded (MipOptions::srgb); upload with an sRGB format
+    std::vector<CompressedLevel> levels;   // levels[0] is the full image, down to 1x1
+    std::vector<unsigned char> data;
+};
+
+// Builds the mip chain of an 8-bit image with 1 to 4 channels and block-compresses every level, rows
+// of blocks spread over threads (0 = all cores). BC1 and BC7 read RGB(A), BC4 the first channel,
+// BC5 the first two.
+void compressTexture(const unsigned char* pixels, int width, int height, int channels, TextureCodec codec, const MipOptions& mips,
+                     CompressedTexture& out, unsigned threads = 0);
+
+// One RGBA8 image into compressedLevelBytes(codec, width, height) bytes, no mips (codec is not
+// TextureRaw).
+void compressImage(const unsigned char* rgba, int width, int height, TextureCodec codec, unsigned char* out, unsigned threads = 0);
+
+// Single 4x4 blocks of RGBA8 texels (row by row) into 8 or 16 bytes.
+void encodeBlockBC1(const unsigned char* rgba, unsigned char* out);
+void encodeBlockBC4(const unsigned char* rgba, int channel, unsigned char* out);
+void encodeBlockBC5(const unsigned char* rgba, unsigned char* out);
+void encodeBlockBC7(const unsigned char* rgba, unsigned char* out);
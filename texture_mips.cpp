@@ -0,0 +1,300 @@
+// texture_mips.cpp
+// Every level is resampled from the previous float level (not from its 8-bit copy) with weights
+// precomputed per output column and row; one RGBA texel is one 4-wide vector.
+
+#include "texture_mips.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPS_SSE 1
+#endif
+
+using namespace std;
+
+const char* mipFilterName(MipFilter filter) {
+    switch (filter) {
+    case MipKaiser: return "Kaiser";
+    case MipLanczos: return "Lanczos";
+    default: return "box";
+    }
+}
+
+// -------------------- filter kernels --------------------
+// t is measured in texels of the smaller level.
+static const float kPi = 3.14159265358979f;
+
+static float sinc(float x) {
+    if (fabsf(x) < 1e-5f) return 1.0f;
+    return sinf(kPi * x) / (kPi * x);
+}
+
+// modified Bessel function of the first kind, order 0 (series)
+static float besselI0(float x) {
+    float sum = 1.0f, term = 1.0f, q = x * x / 4.0f;
+    for (int k = 1; k < 20; k++) {
+        term *= q / (float)(k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+static float filterRadius(MipFilter filter) {
+    return filter == MipBox ? 0.5f : 3.0f;
+}
+
+static float filterWeight(MipFilter filter, float t) {
+    float r = filterRadius(filter);
+    if (fabsf(t) > r) return 0.0f;
+    if (filter == MipBox) return 1.0f;
+    if (filter == MipLanczos) return sinc(t) * sinc(t / r);
+    const float alpha = 4.0f;
+    float x = t / r;
+    return sinc(t) * besselI0(alpha * sqrtf(max(1.0f - x * x, 0.0f))) / besselI0(alpha);
+}
+
+// Taps of a dst-sized axis resampled from src texels: output i reads index[i * taps + k] with
+// weight[i * taps + k]; the weights of each output sum to 1.
+struct FilterTaps {
+    int taps = 0;
+    vector<int> index;
+    vector<float> weight;
+};
+
+// scale is src texels per dst texel; past src the taps repeat the edge texel.
+static void buildTaps(MipFilter filter, int src, int dst, float scale, FilterTaps& out) {
+    float support = filterRadius(filter) * scale;
+    out.taps = (int)ceilf(2.0f * support) + 1;
+    out.index.assign((size_t)dst * out.taps, 0);
+    out.weight.assign((size_t)dst * out.taps, 0.0f);
+    for (int i = 0; i < dst; i++) {
+        float center = (i + 0.5f) * scale;
+        int first = (int)floorf(center - support);
+        float sum = 0.0f;
+        for (int k = 0; k < out.taps; k++) {
+            int j = first + k;
+            float w = filterWeight(filter, ((j + 0.5f) - center) / scale);
+            out.index[(size_t)i * out.taps + k] = min(max(j, 0), src - 1);
+            out.weight[(size_t)i * out.taps + k] = w;
+            sum += w;
+        }
+        for (int k = 0; k < out.taps; k++) out.weight[(size_t)i * out.taps + k] /= sum;
+    }
+}
+
+// -------------------- texel math --------------------
+#if MIPS_SSE
+typedef __m128 Texel;
+static inline Texel texelZero() { return _mm_setzero_ps(); }
+static inline Texel texelLoad(const float* p) { return _mm_loadu_ps(p); }
+static inline void texelStore(float* p, Texel v) { _mm_storeu_ps(p, v); }
+static inline Texel texelMulAdd(Texel acc, Texel v, float w) { return _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(w))); }
+#else
+struct Texel { float v[4]; };
+static inline Texel texelZero() { return Texel{ { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+static inline Texel texelLoad(const float* p) { return Texel{ { p[0], p[1], p[2], p[3] } }; }
+static inline void texelStore(float* p, Texel v) { for (int c = 0; c < 4; c++) p[c] = v.v[c]; }
+static inline Texel texelMulAdd(Texel acc, Texel v, float w) {
+    for (int c = 0; c < 4; c++) acc.v[c] += v.v[c] * w;
+    return acc;
+}
+#endif
+
+// sRGB <-> linear; the encode table is fine enough that every byte round-trips
+static const int kLinearSteps = 16384;
+
+struct SrgbTables {
+    float toLinear[256];
+    unsigned char toSrgb[kLinearSteps + 1];
+    SrgbTables() {
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i <= kLinearSteps; i++) {
+            float l = (float)i / kLinearSteps;
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+            toSrgb[i] = (unsigned char)min(max(lrintf(c * 255.0f), 0L), 255L);
+        }
+    }
+};
+
+static const SrgbTables& srgbTables() {
+    static const SrgbTables tables;
+    return tables;
+}
+
+static unsigned char unitToByte(float v) {
+    return (unsigned char)lrintf(min(max(v, 0.0f), 1.0f) * 255.0f);
+}
+
+// Float texels [begin, end) to RGBA8; normals are renormalized on the way.
+static void storeTexels(const float* src, size_t begin, size_t end, const MipOptions& opt, unsigned char* out) {
+    const SrgbTables& tables = srgbTables();
+    for (size_t i = begin; i < end; i++) {
+        const float* s = &src[i * 4];
+        unsigned char* d = &out[i * 4];
+        if (opt.normalMap) {
+            float n[3] = { s[0] * 2.0f - 1.0f, s[1] * 2.0f - 1.0f, s[2] * 2.0f - 1.0f };
+            float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (len < 1e-6f) { n[0] = n[1] = 0.0f; n[2] = len = 1.0f; }
+            for (int c = 0; c < 3; c++) d[c] = unitToByte(n[c] / len * 0.5f + 0.5f);
+        }
+        else if (opt.srgb)
+            for (int c = 0; c < 3; c++) d[c] = tables.toSrgb[lrintf(min(max(s[c], 0.0f), 1.0f) * kLinearSteps)];
+        else {
+#if MIPS_SSE
+            __m128i v = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(s), _mm_setzero_ps()), _mm_set1_ps(1.0f)), _mm_set1_ps(255.0f)));
+            v = _mm_packus_epi16(_mm_packs_epi32(v, v), v);
+            int packed = _mm_cvtsi128_si32(v);
+            memcpy(d, &packed, 4);
+            continue;
+#else
+            for (int c = 0; c < 3; c++) d[c] = unitToByte(s[c]);
+#endif
+        }
+        d[3] = unitToByte(s[3]);
+    }
+}
+
+// byte -> float per channel: colour through the sRGB curve when asked, alpha always linear
+static void byteToFloatTables(const MipOptions& opt, float (&toFloat)[2][256]) {
+    for (int i = 0; i < 256; i++) {
+        toFloat[1][i] = i / 255.0f;
+        toFloat[0][i] = opt.srgb ? srgbTables().toLinear[i] : toFloat[1][i];
+    }
+}
+
+// -------------------- chain --------------------
+void buildMipChain(const unsigned char* rgba, int width, int height, const MipOptions& opt, vector<MipLevel>& out, unsigned threads) {
+    out.clear();
+    out.resize(1);
+    out[0].width = width;
+    out[0].height = height;
+    out[0].rgba.assign(rgba, rgba + (size_t)width * height * 4);
+
+    float toFloat[2][256];
+    byteToFloatTables(opt, toFloat);
+    vector<float> level((size_t)width * height * 4), rows, next;
+    parallelFor((size_t)height, threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin * width * 4; i < end * width * 4; i += 4) {
+            level[i] = toFloat[0][rgba[i]];
+            level[i + 1] = toFloat[0][rgba[i + 1]];
+            level[i + 2] = toFloat[0][rgba[i + 2]];
+            level[i + 3] = toFloat[1][rgba[i + 3]];
+        }
+    }, 64);
+
+    int w = width, h = height;
+    FilterTaps tapsX, tapsY;
+    while (w > 1 || h > 1) {
+        int nw = max(w / 2, 1), nh = max(h / 2, 1);
+        buildTaps(opt.filter, w, nw, (float)w / nw, tapsX);
+        buildTaps(opt.filter, h, nh, (float)h / nh, tapsY);
+        // horizontal: h rows of w texels -> h rows of nw
+        rows.resize((size_t)nw * h * 4);
+        parallelFor((size_t)h, threads, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; y++) {
+                const float* src = &level[y * w * 4];
+                float* dst = &rows[y * nw * 4];
+                for (int x = 0; x < nw; x++) {
+                    const int* index = &tapsX.index[(size_t)x * tapsX.taps];
+                    const float* weight = &tapsX.weight[(size_t)x * tapsX.taps];
+                    Texel acc = texelZero();
+                    for (int k = 0; k < tapsX.taps; k++) acc = texelMulAdd(acc, texelLoad(src + index[k] * 4), weight[k]);
+                    texelStore(dst + x * 4, acc);
+                }
+            }
+        }, 64);
+        // vertical: nh rows, each a weighted sum of whole rows
+        next.resize((size_t)nw * nh * 4);
+        parallelFor((size_t)nh, threads, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; y++) {
+                const int* index = &tapsY.index[y * tapsY.taps];
+                const float* weight = &tapsY.weight[y * tapsY.taps];
+                float* dst = &next[y * nw * 4];
+                for (int x = 0; x < nw; x++) {
+                    Texel acc = texelZero();
+                    for (int k = 0; k < tapsY.taps; k++) acc = texelMulAdd(acc, texelLoad(&rows[((size_t)index[k] * nw + x) * 4]), weight[k]);
+                    texelStore(dst + x * 4, acc);
+                }
+            }
+        }, 32);
+        level.swap(next);
+        w = nw;
+        h = nh;
+        MipLevel l;
+        l.width = w;
+        l.height = h;
+        l.rgba.resize((size_t)w * h * 4);
+        parallelFor((size_t)h, threads, [&](size_t begin, size_t end) {
+            storeTexels(level.data(), begin * w, end * w, opt, l.rgba.data());
+        }, 32);
+        out.push_back(std::move(l));
+    }
+}
+
+// -------------------- single level, in bands --------------------
+// Output rows go in bands: the source rows a band reads are converted and filtered horizontally into
+// a band-sized buffer, then reduced vertically, so memory stays a few rows of floats per thread.
+void downsampleLevel(const unsigned char* rgba, int width, int height, const MipOptions& opt, MipLevel& dst, unsigned threads) {
+    const int kBandRows = 32;
+    int w = width, h = height;
+    int nw = (w + 1) / 2, nh = (h + 1) / 2;
+    dst.width = nw;
+    dst.height = nh;
+    dst.rgba.resize((size_t)nw * nh * 4);
+    float toFloat[2][256];
+    byteToFloatTables(opt, toFloat);
+    FilterTaps tapsX, tapsY;
+    buildTaps(opt.filter, w, nw, 2.0f, tapsX);
+    buildTaps(opt.filter, h, nh, 2.0f, tapsY);
+    parallelFor((size_t)nh, threads, [&](size_t begin, size_t end) {
+        vector<float> line((size_t)w * 4), rows, out;
+        for (size_t y0 = begin; y0 < end; y0 += kBandRows) {
+            size_t y1 = min(y0 + kBandRows, end);
+            // source rows [first, last] feed this band; taps are clamped, so they are in range
+            int first = h, last = 0;
+            for (size_t i = y0 * tapsY.taps; i < y1 * tapsY.taps; i++) {
+                first = min(first, tapsY.index[i]);
+                last = max(last, tapsY.index[i]);
+            }
+            rows.resize((size_t)(last - first + 1) * nw * 4);
+            for (int sy = first; sy <= last; sy++) {
+                const unsigned char* s = &rgba[(size_t)sy * w * 4];
+                for (size_t i = 0; i < (size_t)w * 4; i += 4) {
+                    line[i] = toFloat[0][s[i]];
+                    line[i + 1] = toFloat[0][s[i + 1]];
+                    line[i + 2] = toFloat[0][s[i + 2]];
+                    line[i + 3] = toFloat[1][s[i + 3]];
+                }
+                float* d = &rows[(size_t)(sy - first) * nw * 4];
+                for (int x = 0; x < nw; x++) {
+                    const int* index = &tapsX.index[(size_t)x * tapsX.taps];
+                    const float* weight = &tapsX.weight[(size_t)x * tapsX.taps];
+                    Texel acc = texelZero();
+                    for (int k = 0; k < tapsX.taps; k++) acc = texelMulAdd(acc, texelLoad(&line[index[k] * 4]), weight[k]);
+                    texelStore(d + x * 4, acc);
+                }
+            }
+            out.resize((y1 - y0) * nw * 4);
+            for (size_t y = y0; y < y1; y++) {
+                const int* index = &tapsY.index[y * tapsY.taps];
+                const float* weight = &tapsY.weight[y * tapsY.taps];
+                float* d = &out[(y - y0) * nw * 4];
+                for (int x = 0; x < nw; x++) {
+                    Texel acc = texelZero();
+                    for (int k = 0; k < tapsY.taps; k++)
+                        acc = texelMulAdd(acc, texelLoad(&rows[((size_t)(index[k] - first) * nw + x) * 4]), weight[k]);
+                    texelStore(d + x * 4, acc);
+                }
+            }
+            storeTexels(out.data(), 0, (y1 - y0) * nw, opt, &dst.rgba[y0 * nw * 4]);
+        }
+    }, kBandRows);
+}
@@ -0,0 +1,37 @@
+// texture_mips.h
+// CPU mip chains for the texture cache, so the runtime never calls glGenerateMipmap. Each level is
+// filtered from the one above in float (separable, SSE2 where available), in linear light for sRGB
+// colour maps, with normals renormalized, and rows spread over threads.
+
+#pragma once
+
+#include <vector>
+
+enum MipFilter {
+    MipBox,       // 2x2 average
+    MipKaiser,    // Kaiser-windowed sinc, 3 texels of the smaller level each way, alpha 4
+    MipLanczos,   // Lanczos-3
+};
+
+const char* mipFilterName(MipFilter filter);
+
+struct MipOptions {
+    MipFilter filter = MipKaiser;
+    bool srgb = false;        // RGB is sRGB-encoded: filtered in linear light (alpha stays linear)
+    bool normalMap = false;   // RGB holds tangent-space normals: renormalized on every level
+};
+
+struct MipLevel {
+    int width = 0, height = 0;
+    std::vector<unsigned char> rgba;
+};
+
+// Levels of an RGBA8 image down to 1x1, out[0] being a copy of the image. Level sizes halve rounding
+// down; taps past the edges repeat the edge texels. threads = 0 uses every core.
+void buildMipChain(const unsigned char* rgba, int width, int height, const MipOptions& opt, std::vector<MipLevel>& out,
+                   unsigned threads = 0);
+
+// The next level of an RGBA8 image without a float copy of the whole image, for sources too large
+// for buildMipChain (virtual textures). Sizes halve rounding up, so every dst texel covers exactly
+// 2x2 src texels, the edge texels repeated past the edge.
+void downsampleLevel(const unsigned char* rgba, int width, int height, const MipOptions& opt, MipLevel& dst, unsigned threads = 0);
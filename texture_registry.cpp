@@ -0,0 +1,80 @@
+// texture_registry.cpp
+
+#include "texture_registry.h"
+
+using namespace std;
+
+string textureKey(const string& source, TextureCodec codec, const MipOptions& mips) {
+    return source + "|" + textureCodecName(codec) + "|" + mipFilterName(mips.filter) + (mips.srgb ? "|srgb" : "") +
+           (mips.normalMap ? "|normal" : "");
+}
+
+bool TextureRegistry::acquire(const string& key, uint32_t& texture) {
+    auto it = byKey.find(key);
+    if (it == byKey.end()) return false;
+    texture = it->second;
+    addRef(texture);
+    return true;
+}
+
+void TextureRegistry::add(const string& key, uint32_t texture) {
+    Entry& e = entries[texture];
+    e.refs++;
+    e.keys.push_back(key);
+    byKey[key] = texture;
+}
+
+void TextureRegistry::addRef(uint32_t texture) {
+    auto it = entries.find(texture);
+    if (it != entries.end()) it->second.refs++;
+}
+
+bool TextureRegistry::release(uint32_t texture, uint64_t* contentHash) {
+    auto it = entries.find(texture);
+    if (it == entries.end() || --it->second.refs > 0) return false;
+    for (const string& key : it->second.keys) byKey.erase(key);
+    if (it->second.content) byContent.erase(it->second.content);
+    if (contentHash) *contentHash = it->second.content;
+    entries.erase(it);
+    return true;
+}
+
+uint32_t TextureRegistry::setContent(uint32_t texture, uint64_t contentHash) {
+    auto found = byContent.find(contentHash);
+    if (found != byContent.end() && found->second != texture) return found->second;
+    auto it = entries.find(texture);
+    if (it == entries.end()) return 0;
+    it->second.content = contentHash;
+    byContent[contentHash] = texture;
+    return 0;
+}
+
+uint32_t TextureRegistry::findContent(uint64_t contentHash) const {
+    auto it = byContent.find(contentHash);
+    return it != byContent.end() ? it->second : 0;
+}
+
+void TextureRegistry::merge(uint32_t texture, uint32_t target) {
+    auto from = entries.find(texture);
+    auto to = entries.find(target);
+    if (from == entries.end() || to == entries.end() || texture == target) return;
+    to->second.refs += from->second.refs;
+    for (const string& key : from->second.keys) {
+        byKey[key] = target;
+        to->second.keys.push_back(key);
+    }
+    entries.erase(from);
+}
+
+void TextureRegistry::fail(uint32_t texture) {
+    auto it = entries.find(texture);
+    if (it == entries.end()) return;
+    for (const string& key : it->second.keys) byKey[key] = 0;
+    if (it->second.content) byContent.erase(it->second.content);
+    entries.erase(it);
+}
+
+uint32_t TextureRegistry::refs(uint32_t texture) const {
+    auto it = entries.find(texture);
+    return it != entries.end() ? it->second.refs : 0;
+}
@@ -0,0 +1,53 @@
+// texture_registry.h
+// Reference-counted sharing of GPU textures. A texture is found by its request key (source path(s)
+// plus import settings) before anything is loaded, and by its content hash (source bytes plus import
+// settings, see hashTextureSource) once the loader has hashed it, so the same image behind different
+// paths becomes one texture. Handles are plain GL names: the registry never calls GL, the owner
+// deletes a texture when release() reports its last reference gone.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "texture_compress.h"
+
+// Request key of an image loaded with the given settings.
+std::string textureKey(const std::string& source, TextureCodec codec, const MipOptions& mips);
+
+struct TextureRegistry {
+    // True when key was requested before; texture is then its texture with one more reference, or 0
+    // when that load failed.
+    bool acquire(const std::string& key, uint32_t& texture);
+    // New texture under key, holding one reference.
+    void add(const std::string& key, uint32_t texture);
+    // Ignored for textures not in the registry (the shared 1x1 fallbacks).
+    void addRef(uint32_t texture);
+    // Drops one reference. Returns true when it was the last: the entry is gone, contentHash (if
+    // given) receives its hash and the caller deletes the texture.
+    bool release(uint32_t texture, uint64_t* contentHash = nullptr);
+
+    // Records the content hash of texture. Returns the texture that already has it, else 0.
+    uint32_t setContent(uint32_t texture, uint64_t contentHash);
+    uint32_t findContent(uint64_t contentHash) const;
+    // Gives texture's keys and references to target and forgets texture (a duplicate by content).
+    void merge(uint32_t texture, uint32_t target);
+    // Forgets a texture that failed to load; its keys stay known and acquire() returns 0 for them.
+    void fail(uint32_t texture);
+
+    uint32_t refs(uint32_t texture) const;
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry {
+        uint32_t refs = 0;
+        uint64_t content = 0;
+        std::vector<std::string> keys;
+    };
+    std::map<uint32_t, Entry> entries;
+    std::map<std::string, uint32_t> byKey;   // 0 = failed
+    std::map<uint64_t, uint32_t> byContent;
+};
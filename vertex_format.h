@@ -0,0 +1,298 @@
+// vertex_format.h
+// Compile-time vertex format descriptions. A format is a list of streams, each an interleaved list
+// of attributes (semantic, component type, count, normalized); offsets and strides are constants
+// derived from that list, the packing code is one specialized writer per attribute, and the GL
+// side expands the same list into its glVertexAttribPointer calls. No GL dependency.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "mesh_import.h"
+#include "mesh_quantize.h"
+
+// also the shader attribute locations
+enum VertexSemantic {
+    SemanticPosition = 0,
+    SemanticNormal = 1,
+    SemanticTexcoord = 2,
+    SemanticTangent = 3,
+};
+
+// values are the GL enums, so they pass straight to glVertexAttribPointer
+enum ComponentType : uint32_t {
+    ComponentUByte = 0x1401,          // GL_UNSIGNED_BYTE
+    ComponentUShort = 0x1403,         // GL_UNSIGNED_SHORT
+    ComponentFloat = 0x1406,          // GL_FLOAT
+    ComponentHalf = 0x140B,           // GL_HALF_FLOAT
+    ComponentInt2101010Rev = 0x8D9F,  // GL_INT_2_10_10_10_REV: 4 components in one 32-bit word
+};
+
+constexpr size_t componentBytes(ComponentType type) {
+    return type == ComponentUByte ? 1 : (type == ComponentUShort || type == ComponentHalf) ? 2 : 4;
+}
+
+constexpr size_t alignUp(size_t v, size_t alignment) {
+    return (v + alignment - 1) / alignment * alignment;
+}
+
+template <VertexSemantic S, ComponentType T, int N, bool Normalized = false>
+struct VertexAttribute {
+    static constexpr VertexSemantic semantic = S;
+    static constexpr ComponentType type = T;
+    static constexpr int count = N;
+    static constexpr bool normalized = Normalized;
+    static constexpr size_t bytes = (T == ComponentInt2101010Rev) ? 4 : componentBytes(T) * N;
+    static constexpr size_t align = componentBytes(T);
+};
+
+// -------------------- attribute writers --------------------
+// Per-format constants the writers need, computed once per pack.
+struct VertexPackContext {
+    PositionDequant dequant;
+    float quantScale[3] = { 0, 0, 0 };   // 65535 / dequant.scale
+    explicit VertexPackContext(const PositionDequant& dq) : dequant(dq) {
+        for (int a = 0; a < 3; a++) quantScale[a] = dq.scale[a] > 0.0f ? 65535.0f / dq.scale[a] : 0.0f;
+    }
+};
+
+// VertexWriter<A>::write(v, dst, ctx) encodes attribute A of the float vertex v (kMeshVertexFloats,
+// layout in mesh_import.h) at dst. Only the combinations below exist; any other is a compile error.
+template <typename A> struct VertexWriter;
+
+template <> struct VertexWriter<VertexAttribute<SemanticPosition, ComponentFloat, 3>> {
+    static void write(const float* v, unsigned char* dst, const VertexPackContext&) { memcpy(dst, v, 3 * sizeof(float)); }
+};
+// unorm16 within the mesh AABB, see PositionDequant
+template <> struct VertexWriter<VertexAttribute<SemanticPosition, ComponentUShort, 3, true>> {
+    static void write(const float* v, unsigned char* dst, const VertexPackContext& ctx) {
+        uint16_t q[3];
+        for (int a = 0; a < 3; a++) q[a] = quantizeUnorm16((v[a] - ctx.dequant.offset[a]) * ctx.quantScale[a]);
+        memcpy(dst, q, sizeof(q));
+    }
+};
+template <> struct VertexWriter<VertexAttribute<SemanticNormal, ComponentFloat, 3>> {
+    static void write(const float* v, unsigned char* dst, const VertexPackContext&) { memcpy(dst, v + 3, 3 * sizeof(float)); }
+};
+// snorm 10_10_10 with the bitangent sign in the 2-bit w
+template <> struct VertexWriter<VertexAttribute<SemanticNormal, ComponentInt2101010Rev, 4, true>> {
+    static void write(const float* v, unsigned char* dst, const VertexPackContext&) {
+        uint32_t packed = packNormal1010102(v + 3, v[11]);
+        memcpy(dst, &packed, sizeof(packed));
+    }
+};
+template <> struct VertexWriter<VertexAttribute<SemanticTexcoord, ComponentFloat, 2>> {
+    static void write(const float* v, unsigned char* dst, const VertexPackContext&) { memcpy(dst, v + 6, 2 * sizeof(float)); }
+};
+template <> struct VertexWriter<VertexAttribute<SemanticTexcoord, ComponentHalf, 2>> {
+    static void write(const float* v, unsigned char* dst, const VertexPackContext&) {
+        uint16_t h[2] = { floatToHalf(v[6]), floatToHalf(v[7]) };
+        memcpy(dst, h, sizeof(h));
+    }
+};
+template <> struct VertexWriter<VertexAttribute<SemanticTangent, ComponentFloat, 4>> {
+    static void write(const float* v, unsigned char* dst, const VertexPackContext&) { memcpy(dst, v + 8, 4 * sizeof(float)); }
+};
+// octahedral; the sign travels in the normal's w
+template <> struct VertexWriter<VertexAttribute<SemanticTangent, ComponentUByte, 2, true>> {
+    static void write(const float* v, unsigned char* dst, const VertexPackContext&) { packOctahedral(v + 8, dst); }
+};
+
+// -------------------- streams and formats --------------------
+// Attributes of one stream are laid out in order, each aligned to its component size; the stride
+// is rounded up to 4 bytes.
+template <typename... Attributes>
+struct VertexStream {
+    static_assert(sizeof...(Attributes) > 0, "empty vertex stream");
+    static constexpr size_t attributeCount = sizeof...(Attributes);
+
+    // offset of attribute index; attributeCount gives the end of the last one
+    static constexpr size_t offsetOf(size_t index) {
+        const size_t bytes[] = { Attributes::bytes... };
+        const size_t aligns[] = { Attributes::align... };
+        size_t offset = 0;
+        for (size_t i = 0; i < attributeCount; i++) {
+            offset = alignUp(offset, aligns[i]);
+            if (i == index) return offset;
+            offset += bytes[i];
+        }
+        return offset;
+    }
+    static constexpr size_t stride = alignUp(offsetOf(attributeCount), 4);
+
+    static void write(const float* v, unsigned char* dst, const VertexPackContext& ctx) {
+        writeAll(v, dst, ctx, std::index_sequence_for<Attributes...>());
+    }
+    // f(semantic, type, count, normalized, offset) for every attribute
+    template <typename F>
+    static void forEachAttribute(F&& f) {
+        visitAll(f, std::index_sequence_for<Attributes...>());
+    }
+
+private:
+    template <size_t... I>
+    static void writeAll(const float* v, unsigned char* dst, const VertexPackContext& ctx, std::index_sequence<I...>) {
+        int expand[] = { (VertexWriter<Attributes>::write(v, dst + offsetOf(I), ctx), 0)... };
+        (void)expand;
+    }
+    template <typename F, size_t... I>
+    static void visitAll(F& f, std::index_sequence<I...>) {
+        int expand[] = { (f(Attributes::semantic, Attributes::type, Attributes::count, Attributes::normalized, offsetOf(I)), 0)... };
+        (void)expand;
+    }
+};
+
+// Streams are stored back to back: all vertices of stream 0, then all of stream 1, ...
+template <typename... Streams>
+struct VertexFormat {
+    static constexpr size_t streamCount = sizeof...(Streams);
+    template <size_t I> using Stream = typename std::tuple_element<I, std::tuple<Streams...>>::type;
+    static constexpr size_t vertexBytes() {
+        const size_t strides[] = { Streams::stride... };
+        size_t sum = 0;
+        for (size_t i = 0; i < streamCount; i++) sum += strides[i];
+        return sum;
+    }
+    // where stream index starts, in bytes, for vertexCount vertices
+    static constexpr size_t streamStart(size_t index, size_t vertexCount) {
+        const size_t strides[] = { Streams::stride... };
+        size_t start = 0;
+        for (size_t i = 0; i < index; i++) start += strides[i] * vertexCount;
+        return start;
+    }
+
+    // float vertices (kMeshVertexFloats each) -> out, vertexCount * vertexBytes() bytes
+    static void pack(const float* vertices, size_t vertexCount, const PositionDequant& dq, unsigned char* out) {
+        VertexPackContext ctx(dq);
+        packAll(vertices, vertexCount, ctx, out, std::index_sequence_for<Streams...>());
+    }
+    // f(stream, stride, start, semantic, type, count, normalized, offset) for every attribute
+    template <typename F>
+    static void forEachAttribute(size_t vertexCount, F&& f) {
+        visitAll(vertexCount, f, std::index_sequence_for<Streams...>());
+    }
+
+private:
+    template <typename S>
+    static void packStream(const float* vertices, size_t vertexCount, const VertexPackContext& ctx, unsigned char* dst) {
+        for (size_t i = 0; i < vertexCount; i++) S::write(vertices + i * kMeshVertexFloats, dst + i * S::stride, ctx);
+    }
+    template <size_t... I>
+    static void packAll(const float* vertices, size_t vertexCount, const VertexPackContext& ctx, unsigned char* out, std::index_sequence<I...>) {
+        int expand[] = { (packStream<Streams>(vertices, vertexCount, ctx, out + streamStart(I, vertexCount)), 0)... };
+        (void)expand;
+    }
+    template <typename F, size_t... I>
+    static void visitAll(size_t vertexCount, F& f, std::index_sequence<I...>) {
+        int expand[] = { (Streams::forEachAttribute([&](VertexSemantic semantic, ComponentType type, int count, bool normalized, size_t offset) {
+            f(I, Streams::stride, streamStart(I, vertexCount), semantic, type, count, normalized, offset);
+        }), 0)... };
+        (void)expand;
+    }
+};
+
+// -------------------- the upload formats --------------------
+typedef VertexAttribute<SemanticPosition, ComponentFloat, 3> PositionFloat;
+typedef VertexAttribute<SemanticPosition, ComponentUShort, 3, true> PositionUnorm16;
+typedef VertexAttribute<SemanticNormal, ComponentFloat, 3> NormalFloat;
+typedef VertexAttribute<SemanticNormal, ComponentInt2101010Rev, 4, true> NormalSnorm10;
+typedef VertexAttribute<SemanticTexcoord, ComponentFloat, 2> TexcoordFloat;
+typedef VertexAttribute<SemanticTexcoord, ComponentHalf, 2> TexcoordHalf;
+typedef VertexAttribute<SemanticTangent, ComponentFloat, 4> TangentFloat;
+typedef VertexAttribute<SemanticTangent, ComponentUByte, 2, true> TangentOct8;
+
+// the import/cache layout itself (48 bytes)
+typedef VertexFormat<VertexStream<PositionFloat, NormalFloat, TexcoordFloat, TangentFloat>> FloatVertexFormat;
+// positions alone first (12 + 36 bytes), for depth-only passes
+typedef VertexFormat<VertexStream<PositionFloat>, VertexStream<NormalFloat, TexcoordFloat, TangentFloat>> FloatSplitVertexFormat;
+// CompactVertex (16 bytes)
+typedef VertexFormat<VertexStream<PositionUnorm16, TangentOct8, NormalSnorm10, TexcoordHalf>> CompactVertexFormat;
+// 8 + 12 bytes
+typedef VertexFormat<VertexStream<PositionUnorm16>, VertexStream<NormalSnorm10, TexcoordHalf, TangentOct8>> CompactSplitVertexFormat;
+
+static_assert(FloatVertexFormat::vertexBytes() == kMeshVertexFloats * sizeof(float), "float format must match the import layout");
+static_assert(CompactVertexFormat::vertexBytes() == sizeof(CompactVertex), "compact format must match CompactVertex");
+static_assert(CompactSplitVertexFormat::vertexBytes() == 20, "compact split format must stay 8 + 12 bytes");
+
+// Runtime handle for the formats above; visitVertexFormat maps it back to the type.
+enum VertexFormatId {
+    VertexFormatFloat,
+    VertexFormatFloatSplit,
+    VertexFormatCompact,
+    VertexFormatCompactSplit,
+};
+
+// positions need PositionDequant, tangents are octahedral
+inline bool isQuantizedFormat(VertexFormatId id) {
+    return id == VertexFormatCompact || id == VertexFormatCompactSplit;
+}
+
+// f(Format()) with the format type for id; the one switch between a runtime choice and the
+// specialized code.
+template <typename F>
+void visitVertexFormat(VertexFormatId id, F&& f) {
+    switch (id) {
+    case VertexFormatFloat: f(FloatVertexFormat()); break;
+    case VertexFormatFloatSplit: f(FloatSplitVertexFormat()); break;
+    case VertexFormatCompact: f(CompactVertexFormat()); break;
+    case VertexFormatCompactSplit: f(CompactSplitVertexFormat()); break;
+    }
+}
+
+inline size_t vertexFormatStreamCount(VertexFormatId id) {
+    size_t count = 0;
+    visitVertexFormat(id, [&](auto format) { count = decltype(format)::streamCount; });
+    return count;
+}
+
+inline size_t vertexFormatBytes(VertexFormatId id) {
+    size_t bytes = 0;
+    visitVertexFormat(id, [&](auto format) { bytes = decltype(format)::vertexBytes(); });
+    return bytes;
+}
+
+// Packs float vertices into the format, vertexCount * vertexFormatBytes(id) bytes.
+inline void packVertices(VertexFormatId id, const float* vertices, size_t vertexCount, const PositionDequant& dq,
+                         std::vector<unsigned char>& out) {
+    out.resize(vertexCount * vertexFormatBytes(id));
+    visitVertexFormat(id, [&](auto format) { decltype(format)::pack(vertices, vertexCount, dq, out.data()); });
+}
+
+// Copies vertices in format from into format to, attribute by attribute (matched by semantic), for
+// formats that only differ in stream layout (compact <-> compact split). Returns false when an
+// attribute of to is missing from from or encoded differently.
+inline bool repackVertices(VertexFormatId from, VertexFormatId to, const unsigned char* src, size_t vertexCount,
+                           std::vector<unsigned char>& out) {
+    struct Source {
+        bool found = false;
+        ComponentType type = ComponentFloat;
+        int count = 0;
+        size_t stride = 0, start = 0, offset = 0;
+    };
+    Source sources[4];
+    visitVertexFormat(from, [&](auto format) {
+        decltype(format)::forEachAttribute(vertexCount, [&](size_t, size_t stride, size_t start, VertexSemantic semantic,
+                                                            ComponentType type, int count, bool, size_t offset) {
+            Source& s = sources[semantic];
+            s.found = true; s.type = type; s.count = count; s.stride = stride; s.start = start; s.offset = offset;
+        });
+    });
+    out.assign(vertexCount * vertexFormatBytes(to), 0);
+    bool ok = true;
+    visitVertexFormat(to, [&](auto format) {
+        decltype(format)::forEachAttribute(vertexCount, [&](size_t, size_t stride, size_t start, VertexSemantic semantic,
+                                                            ComponentType type, int count, bool, size_t offset) {
+            const Source& s = sources[semantic];
+            if (!s.found || s.type != type || s.count != count) { ok = false; return; }
+            size_t bytes = (type == ComponentInt2101010Rev) ? 4 : componentBytes(type) * count;
+            for (size_t i = 0; i < vertexCount; i++)
+                memcpy(&out[start + i * stride + offset], src + s.start + i * s.stride + s.offset, bytes);
+        });
+    });
+    return ok;
+}
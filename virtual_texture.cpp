@@ -0,0 +1,353 @@
+// virtual_texture.cpp
+
+#include "virtual_texture.h"
+
+#include "parallel.h"
+#include "texture_cache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+// -------------------- file layout --------------------
+// [header][tiles, level by level, row by row, tileBytes each, from a 16-byte aligned offset]
+struct VirtualTileLevel {
+    uint32_t width, height, tilesX, tilesY, firstTile, reserved;
+};
+
+struct VirtualTileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t width, height;
+    uint32_t tileSize, tileBorder;
+    uint32_t codec, srgb;
+    uint32_t levelCount, tileBytes;
+    VirtualTileLevel levels[kMaxVirtualLevels];
+};
+static const char kVirtualTileMagic[4] = { 'V', 'T', 'E', 'X' };
+
+static uint64_t align16(uint64_t v) { return (v + 15) & ~(uint64_t)15; }
+
+static const uint64_t kTileDataOffset = align16(sizeof(VirtualTileHeader));
+
+static int tilesFor(int texels) { return (texels + kVirtualTileSize - 1) / kVirtualTileSize; }
+
+// Level table of a width x height image: sizes halve rounding up until one tile holds the level.
+static int virtualLevels(int width, int height, VirtualLevel* levels) {
+    int count = 0;
+    uint32_t first = 0;
+    int w = width, h = height;
+    while (true) {
+        if (count == kMaxVirtualLevels) return 0;
+        VirtualLevel& l = levels[count++];
+        l.width = w;
+        l.height = h;
+        l.tilesX = tilesFor(w);
+        l.tilesY = tilesFor(h);
+        l.firstTile = first;
+        first += (uint32_t)(l.tilesX * l.tilesY);
+        if (w <= kVirtualTileSize && h <= kVirtualTileSize) return count;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+}
+
+const unsigned char* VirtualTextureFile::tile(uint32_t t) const {
+    int level = virtualTileLevel(t), x = virtualTileX(t), y = virtualTileY(t);
+    if (level >= levelCount || x >= levels[level].tilesX || y >= levels[level].tilesY) return nullptr;
+    size_t index = levels[level].firstTile + (size_t)y * levels[level].tilesX + x;
+    return (const unsigned char*)file.data() + kTileDataOffset + index * tileBytes;
+}
+
+string virtualTilesPath(const string& imagePath, TextureCodec codec) {
+    string name = textureCodecName(codec);
+    for (char& c : name) c = (char)tolower((unsigned char)c);
+    return imagePath + "." + name + ".vtiles";
+}
+
+uint64_t hashVirtualSource(const string& imagePath, TextureCodec codec, const MipOptions& mips, bool flip) {
+    uint64_t h = hashTextureSource(imagePath, codec, mips, flip);
+    if (!h) return 0;
+    uint32_t key[3] = { kVirtualTextureVersion, (uint32_t)kVirtualTileSize, (uint32_t)kVirtualTileBorder };
+    h = hashBytes(key, sizeof(key), h);
+    return h ? h : 1;
+}
+
+// -------------------- write / open --------------------
+// Tiles of one level into out (tileBytes each, row by row); texels past the level's edges repeat
+// its edge texels.
+static void encodeLevelTiles(const unsigned char* rgba, const VirtualLevel& l, TextureCodec codec, size_t tileBytes,
+                             unsigned char* out, unsigned threads) {
+    parallelFor((size_t)l.tilesX * l.tilesY, threads, [&](size_t begin, size_t end) {
+        vector<unsigned char> texels((size_t)kVirtualTileStride * kVirtualTileStride * 4);
+        for (size_t i = begin; i < end; i++) {
+            int x0 = (int)(i % l.tilesX) * kVirtualTileSize - kVirtualTileBorder;
+            int y0 = (int)(i / l.tilesX) * kVirtualTileSize - kVirtualTileBorder;
+            for (int j = 0; j < kVirtualTileStride; j++) {
+                int y = min(max(y0 + j, 0), l.height - 1);
+                for (int k = 0; k < kVirtualTileStride; k++) {
+                    int x = min(max(x0 + k, 0), l.width - 1);
+                    memcpy(&texels[((size_t)j * kVirtualTileStride + k) * 4], &rgba[((size_t)y * l.width + x) * 4], 4);
+                }
+            }
+            compressImage(texels.data(), kVirtualTileStride, kVirtualTileStride, codec, out + i * tileBytes, 1);
+        }
+    }, 4);
+}
+
+bool writeVirtualTiles(const string& tilesPath, const unsigned char* rgba, int width, int height, TextureCodec codec,
+                       const MipOptions& mips, uint64_t sourceHash, unsigned threads) {
+    if (codec != TextureBC1 && codec != TextureBC7 && codec != TextureRGBA8) return false;
+    VirtualLevel levels[kMaxVirtualLevels];
+    int levelCount = virtualLevels(width, height, levels);
+    if (!levelCount) { cerr << "Image too large for a virtual texture: " << width << "x" << height << "\n"; return false; }
+    VirtualTileHeader hdr;
+    memset((void*)&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, kVirtualTileMagic, 4);
+    hdr.version = kVirtualTextureVersion;
+    hdr.sourceHash = sourceHash;
+    hdr.width = (uint32_t)width;
+    hdr.height = (uint32_t)height;
+    hdr.tileSize = kVirtualTileSize;
+    hdr.tileBorder = kVirtualTileBorder;
+    hdr.codec = (uint32_t)codec;
+    hdr.srgb = mips.srgb ? 1 : 0;
+    hdr.levelCount = (uint32_t)levelCount;
+    hdr.tileBytes = (uint32_t)compressedLevelBytes(codec, kVirtualTileStride, kVirtualTileStride);
+    for (int i = 0; i < levelCount; i++) {
+        const VirtualLevel& l = levels[i];
+        VirtualTileLevel t = { (uint32_t)l.width, (uint32_t)l.height, (uint32_t)l.tilesX, (uint32_t)l.tilesY, l.firstTile, 0 };
+        hdr.levels[i] = t;
+    }
+
+    // write to a temp file and rename, so a crash never leaves a truncated cache behind
+    string tmp = tilesPath + ".tmp";
+    {
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out) { cerr << "Failed to write virtual texture tiles: " << tmp << "\n"; return false; }
+        const char zeros[16] = {};
+        out.write((const char*)&hdr, sizeof(hdr));
+        out.write(zeros, kTileDataOffset - sizeof(hdr));
+        // one level in memory at a time: the next is filtered from it, then it goes
+        MipLevel current, next;
+        const unsigned char* level = rgba;
+        vector<unsigned char> encoded;
+        for (int i = 0; i < levelCount && out; i++) {
+            const VirtualLevel& l = levels[i];
+            encoded.resize((size_t)l.tilesX * l.tilesY * hdr.tileBytes);
+            encodeLevelTiles(level, l, codec, hdr.tileBytes, encoded.data(), threads);
+            out.write((const char*)encoded.data(), (streamsize)encoded.size());
+            if (i + 1 == levelCount) break;
+            downsampleLevel(level, l.width, l.height, mips, next, threads);
+            current.rgba.swap(next.rgba);
+            level = current.rgba.data();
+        }
+        if (!out) { cerr << "Failed to write virtual texture tiles: " << tmp << "\n"; return false; }
+    }
+    remove(tilesPath.c_str());
+    if (rename(tmp.c_str(), tilesPath.c_str()) != 0) {
+        cerr << "Failed to rename virtual texture tiles: " << tmp << "\n";
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool openVirtualTiles(const string& tilesPath, uint64_t sourceHash, VirtualTextureFile& out) {
+    MappedFile file;
+    if (!file.open(tilesPath)) return false;
+    if (file.size() < kTileDataOffset) return false;
+    VirtualTileHeader hdr;
+    memcpy(&hdr, file.data(), sizeof(hdr));
+    if (memcmp(hdr.magic, kVirtualTileMagic, 4) != 0 || hdr.version != kVirtualTextureVersion) return false;
+    if (hdr.sourceHash != sourceHash) return false;
+    if (hdr.tileSize != kVirtualTileSize || hdr.tileBorder != kVirtualTileBorder) return false;
+    TextureCodec codec = (TextureCodec)hdr.codec;
+    if (codec != TextureBC1 && codec != TextureBC7 && codec != TextureRGBA8) return false;
+    if (hdr.tileBytes != compressedLevelBytes(codec, kVirtualTileStride, kVirtualTileStride)) return false;
+    if (hdr.width == 0 || hdr.height == 0) return false;
+    // the level table must be the one these sizes give
+    VirtualLevel levels[kMaxVirtualLevels];
+    int levelCount = virtualLevels((int)hdr.width, (int)hdr.height, levels);
+    if (!levelCount || (uint32_t)levelCount != hdr.levelCount) return false;
+    for (int i = 0; i < levelCount; i++) {
+        const VirtualTileLevel& t = hdr.levels[i];
+        const VirtualLevel& l = levels[i];
+        if (t.width != (uint32_t)l.width || t.height != (uint32_t)l.height || t.tilesX != (uint32_t)l.tilesX ||
+            t.tilesY != (uint32_t)l.tilesY || t.firstTile != l.firstTile) return false;
+    }
+    const VirtualLevel& last = levels[levelCount - 1];
+    uint64_t tileCount = last.firstTile + (uint64_t)last.tilesX * last.tilesY;
+    if (kTileDataOffset + tileCount * hdr.tileBytes > file.size()) return false;
+
+    out.width = (int)hdr.width;
+    out.height = (int)hdr.height;
+    out.levelCount = levelCount;
+    out.size = kVirtualTileSize << (levelCount - 1);
+    out.codec = codec;
+    out.srgb = hdr.srgb != 0;
+    out.tileBytes = hdr.tileBytes;
+    for (int i = 0; i < levelCount; i++) out.levels[i] = levels[i];
+    out.file = std::move(file);
+    return true;
+}
+
+// -------------------- feedback --------------------
+void collectFeedback(const unsigned char* rgba, size_t texelCount, vector<uint64_t>& tiles) {
+    tiles.clear();
+    uint32_t previous = 0;
+    for (size_t i = 0; i < texelCount; i++) {
+        const unsigned char* t = rgba + i * 4;
+        uint32_t texel;
+        memcpy(&texel, t, 4);
+        // neighbouring pixels mostly name the same tile
+        if (!t[3] || texel == previous) continue;
+        previous = texel;
+        tiles.push_back(virtualTextureTile(t[3], virtualTile(t[2], t[0], t[1])));
+    }
+    sort(tiles.begin(), tiles.end());
+    tiles.erase(unique(tiles.begin(), tiles.end()), tiles.end());
+}
+
+// -------------------- page table --------------------
+static uint32_t pageTexel(int slotX, int slotY, int level) {
+    return (uint32_t)slotX | (uint32_t)slotY << 8 | (uint32_t)level << 16 | 0xFF000000u;
+}
+
+void VirtualPageTable::init(int levelCount) {
+    levels = levelCount;
+    offsets.resize(levelCount);
+    size_t total = 0;
+    for (int l = 0; l < levelCount; l++) {
+        offsets[l] = total;
+        total += (size_t)levelSize(l) * levelSize(l);
+    }
+    own.assign(total, 0);
+    resolved.assign(total, 0);
+    dirty = true;
+}
+
+void VirtualPageTable::map(uint32_t tile, int slotX, int slotY) {
+    int level = virtualTileLevel(tile);
+    own[offsets[level] + (size_t)virtualTileY(tile) * levelSize(level) + virtualTileX(tile)] = pageTexel(slotX, slotY, level);
+    dirty = true;
+}
+
+void VirtualPageTable::unmap(uint32_t tile) {
+    int level = virtualTileLevel(tile);
+    own[offsets[level] + (size_t)virtualTileY(tile) * levelSize(level) + virtualTileX(tile)] = 0;
+    dirty = true;
+}
+
+// coarse to fine, so each parent is final before its children read it
+bool VirtualPageTable::update() {
+    if (!dirty) return false;
+    dirty = false;
+    bool changed = false;
+    for (int l = levels - 1; l >= 0; l--) {
+        int n = levelSize(l);
+        for (int y = 0; y < n; y++)
+            for (int x = 0; x < n; x++) {
+                size_t i = offsets[l] + (size_t)y * n + x;
+                uint32_t t = own[i];
+                if (!t && l + 1 < levels) t = resolved[offsets[l + 1] + (size_t)(y / 2) * (n / 2) + x / 2];
+                changed |= (resolved[i] != t);
+                resolved[i] = t;
+            }
+    }
+    return changed;
+}
+
+// -------------------- residency --------------------
+void VirtualTextureResidency::init(int slotsPerSide) {
+    side = min(max(slotsPerSide, 1), 256);
+    slots.assign((size_t)side * side, Slot());
+    slotOf.clear();
+    loading.clear();
+    pages.clear();
+}
+
+void VirtualTextureResidency::addTexture(int texture, int levelCount, vector<uint64_t>& load) {
+    pages[texture].init(levelCount);
+    uint64_t top = virtualTextureTile(texture, virtualTile(levelCount - 1, 0, 0));
+    if (loading.insert(top).second) load.push_back(top);
+}
+
+void VirtualTextureResidency::removeTexture(int texture) {
+    pages.erase(texture);
+    for (size_t i = 0; i < slots.size(); i++)
+        if (slots[i].tile && (int)(slots[i].tile >> 32) == texture) {
+            slotOf.erase(slots[i].tile);
+            slots[i] = Slot();
+        }
+}
+
+VirtualPageTable* VirtualTextureResidency::pageTable(int texture) {
+    auto it = pages.find(texture);
+    return it == pages.end() ? nullptr : &it->second;
+}
+
+void VirtualTextureResidency::request(const vector<uint64_t>& seen, uint32_t frame, size_t maxLoading, vector<uint64_t>& load) {
+    // the ancestors keep the fallbacks of what is visible resident, and come in first
+    set<uint64_t> wanted;
+    for (uint64_t t : seen) {
+        int texture = (int)(t >> 32);
+        auto page = pages.find(texture);
+        if (page == pages.end()) continue;
+        uint32_t tile = (uint32_t)t;
+        int level = virtualTileLevel(tile), x = virtualTileX(tile), y = virtualTileY(tile);
+        const VirtualPageTable& table = page->second;
+        if (level >= table.levelCount() || x >= table.levelSize(level) || y >= table.levelSize(level)) continue;
+        for (int l = level; l < table.levelCount(); l++, x /= 2, y /= 2)
+            if (!wanted.insert(virtualTextureTile(texture, virtualTile(l, x, y))).second) break;
+    }
+    vector<uint64_t> missing;
+    for (uint64_t t : wanted) {
+        auto it = slotOf.find(t);
+        if (it != slotOf.end()) slots[it->second].lastSeen = frame;
+        else if (!loading.count(t)) missing.push_back(t);
+    }
+    stable_sort(missing.begin(), missing.end(), [](uint64_t a, uint64_t b) {
+        return virtualTileLevel((uint32_t)a) > virtualTileLevel((uint32_t)b);
+    });
+    for (uint64_t t : missing) {
+        if (loading.size() >= maxLoading) break;
+        loading.insert(t);
+        load.push_back(t);
+    }
+}
+
+int VirtualTextureResidency::place(uint64_t t, uint32_t frame) {
+    if (!loading.erase(t)) return -1;
+    int texture = (int)(t >> 32);
+    auto page = pages.find(texture);
+    if (page == pages.end() || slotOf.count(t)) return -1;
+    // a free slot, else the one seen longest ago; never one seen this frame or pinned
+    int best = -1;
+    for (int i = 0; i < (int)slots.size(); i++) {
+        const Slot& s = slots[i];
+        if (!s.tile) { best = i; break; }
+        if (s.pinned || s.lastSeen >= frame) continue;
+        if (best < 0 || s.lastSeen < slots[best].lastSeen) best = i;
+    }
+    if (best < 0) return -1;
+    Slot& s = slots[best];
+    if (s.tile) {
+        VirtualPageTable* old = pageTable((int)(s.tile >> 32));
+        if (old) old->unmap((uint32_t)s.tile);
+        slotOf.erase(s.tile);
+    }
+    uint32_t tile = (uint32_t)t;
+    s.tile = t;
+    s.lastSeen = frame;
+    s.pinned = (virtualTileLevel(tile) == page->second.levelCount() - 1);
+    slotOf[t] = best;
+    page->second.map(tile, best % side, best / side);
+    return best;
+}
@@ -0,0 +1,140 @@
+// virtual_texture.h
+// Sparse virtual texturing for images too large to upload whole (scanned albedo maps of 16k and
+// more). The image and its mips are cut once into fixed-size tiles with a border and stored in a
+// tile cache file next to it; at run time a low-resolution feedback pass reports which tiles the
+// screen samples, only those are streamed into a fixed atlas of physical slots, and a page table
+// (one texel per tile per level) tells the shader where each tile went. Nothing here touches GL.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "texture_compress.h"
+
+// bump whenever the tile file layout or the tiling changes
+const uint32_t kVirtualTextureVersion = 1;
+
+const int kVirtualTileSize = 128;   // texels of content per side
+const int kVirtualTileBorder = 4;   // texels repeated from the neighbours on each side, for filtering (keeps BC blocks aligned)
+const int kVirtualTileStride = kVirtualTileSize + 2 * kVirtualTileBorder;   // texels per side of a stored tile / atlas slot
+const int kMaxVirtualLevels = 9;    // 32768 texels per side: the feedback stores tile coordinates in 8 bits
+
+// Tile of one level, packed as level << 24 | y << 12 | x; feedback and residency add the texture
+// in the upper 32 bits.
+inline uint32_t virtualTile(int level, int x, int y) { return (uint32_t)level << 24 | (uint32_t)y << 12 | (uint32_t)x; }
+inline int virtualTileLevel(uint32_t tile) { return (int)(tile >> 24); }
+inline int virtualTileX(uint32_t tile) { return (int)(tile & 0xFFF); }
+inline int virtualTileY(uint32_t tile) { return (int)(tile >> 12 & 0xFFF); }
+inline uint64_t virtualTextureTile(int texture, uint32_t tile) { return (uint64_t)texture << 32 | tile; }
+
+// -------------------- tile cache file --------------------
+// Levels halve rounding up (downsampleLevel), so level L texel x covers level 0 texels
+// [x << L, (x + 1) << L) and one uv scale addresses every level. The address space is the square of
+// whole tiles that fits level 0, kVirtualTileSize << (levelCount - 1) texels per side; the coarsest
+// level is a single tile. Tiles are stored only where the image is.
+struct VirtualLevel {
+    int width = 0, height = 0;    // texels of image
+    int tilesX = 0, tilesY = 0;   // stored tiles
+    uint32_t firstTile = 0;       // index of tile (0, 0) in the file
+};
+
+struct VirtualTextureFile {
+    int width = 0, height = 0;   // level 0
+    int size = 0;                // side of the virtual address space at level 0
+    int levelCount = 0;
+    TextureCodec codec = TextureRGBA8;
+    bool srgb = false;
+    size_t tileBytes = 0;        // kVirtualTileStride squared, encoded
+    VirtualLevel levels[kMaxVirtualLevels];
+    MappedFile file;
+
+    // Encoded tile, border included; nullptr outside the stored tiles.
+    const unsigned char* tile(uint32_t tile) const;
+};
+
+// Tile file used for an image ("albedo.png", BC7 -> "albedo.png.bc7.vtiles").
+std::string virtualTilesPath(const std::string& imagePath, TextureCodec codec);
+
+// hashTextureSource with the tile layout folded in.
+uint64_t hashVirtualSource(const std::string& imagePath, TextureCodec codec, const MipOptions& mips, bool flip);
+
+// Mips an RGBA8 image band by band and writes every level's tiles, encoded with codec (BC1, BC7 or
+// RGBA8), tiles spread over threads. Fails for images past kMaxVirtualLevels.
+bool writeVirtualTiles(const std::string& tilesPath, const unsigned char* rgba, int width, int height, TextureCodec codec,
+                       const MipOptions& mips, uint64_t sourceHash, unsigned threads = 0);
+
+// Maps the tile file, validating magic, source hash, tile layout and level table.
+bool openVirtualTiles(const std::string& tilesPath, uint64_t sourceHash, VirtualTextureFile& out);
+
+// -------------------- feedback --------------------
+// Feedback texels (RGBA8: tile x, tile y, level, texture; texture 0 = no virtual texture there) to
+// the distinct tiles they name.
+void collectFeedback(const unsigned char* rgba, size_t texelCount, std::vector<uint64_t>& tiles);
+
+// -------------------- residency --------------------
+// Page table of one virtual texture, laid out like the mip chain of a square RGBA8 texture (level L
+// has size >> L texels per side, one per tile): slot x, slot y and level of the tile itself when it
+// is resident, else of its nearest resident ancestor; alpha is 0 while neither is. Texels are the
+// bytes r, g, b, a in memory.
+struct VirtualPageTable {
+    void init(int levelCount);
+    int levelCount() const { return levels; }
+    int levelSize(int level) const { return 1 << (levels - 1 - level); }
+    const uint32_t* texels(int level) const { return &resolved[offsets[level]]; }
+
+    void map(uint32_t tile, int slotX, int slotY);
+    void unmap(uint32_t tile);
+    // Resolves the fallbacks after map / unmap; true when the texels changed since the last call.
+    bool update();
+
+private:
+    int levels = 0;
+    std::vector<size_t> offsets;
+    std::vector<uint32_t> own, resolved;   // own: resident tiles only
+    bool dirty = false;
+};
+
+// Which tiles of which virtual textures sit in the slots of one shared physical atlas. Slots are
+// recycled least recently seen first; the coarsest tile of every texture is pinned, so every page
+// table entry has a fallback once it has arrived.
+struct VirtualTextureResidency {
+    // slotsPerSide squared slots, at most 256 per side (page table texels hold slot coordinates in bytes)
+    void init(int slotsPerSide);
+    int slotsPerSide() const { return side; }
+
+    // Starts tracking texture (1 to 255, its feedback id); load receives its pinned tile.
+    void addTexture(int texture, int levelCount, std::vector<uint64_t>& load);
+    // Frees its slots; its tiles still loading are dropped by place().
+    void removeTexture(int texture);
+    VirtualPageTable* pageTable(int texture);
+
+    // Tiles the feedback saw in frame, and their ancestors, are kept resident; those neither resident
+    // nor loading go to load, coarsest first, until maxLoading tiles are under way.
+    void request(const std::vector<uint64_t>& seen, uint32_t frame, size_t maxLoading, std::vector<uint64_t>& load);
+    // Slot for a loaded tile, its page table updated; -1 when the tile is dropped instead (texture
+    // gone, or every slot seen this frame). The caller uploads the tile into the slot.
+    int place(uint64_t tile, uint32_t frame);
+    // A load that came back empty.
+    void cancel(uint64_t tile) { loading.erase(tile); }
+
+    size_t loadingCount() const { return loading.size(); }
+    size_t residentCount() const { return slotOf.size(); }
+
+private:
+    struct Slot {
+        uint64_t tile = 0;   // 0 = free
+        uint32_t lastSeen = 0;
+        bool pinned = false;
+    };
+    int side = 0;
+    std::vector<Slot> slots;
+    std::map<uint64_t, int> slotOf;
+    std::set<uint64_t> loading;
+    std::map<int, VirtualPageTable> pages;
+};